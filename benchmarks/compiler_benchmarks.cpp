@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "graph_generators.h"
+#include "optimizations/analysis/rpo.h"
+#include "optimizations/analysis/domtree.h"
+#include "optimizations/analysis/loop_analysis.h"
+#include "optimizations/analysis/linear_order.h"
+#include "optimizations/analysis/liveness_analyzer.h"
+#include "optimizations/gcm.h"
+#include "optimizations/gvn.h"
+#include "optimizations/sccp.h"
+#include "optimizations/linear_scan.h"
+#include "optimizations/graph_coloring.h"
+#include "optimizations/ssa_deconstruction.h"
+#include "optimizations/peepholes.h"
+#include "optimizations/inlining.h"
+#include "optimizations/checks_elimination.h"
+
+/*
+ * Compile-time benchmarks of passes:
+ *   compiler_benchmarks [--filter=<substring>] [--repetitions=<N>] [--output=<file>]
+ * Every pass is timed alone: graph is built and analyses, which pass needs, are run
+ * before the timer is started. Pass itself is created and run under the timer.
+ * Result is printed as JSON, so that results of different commits can be compared.
+ */
+
+namespace compiler {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Prepare is run before the timer, its results are cached in PassManager of graph.
+ * GraphBuild has no run, it is time of building the graph.
+ */
+#define BENCHMARK_PASS_LIST(ACTION)                                                              \
+    ACTION( GraphBuild                      , PrepareNothing        , nullptr                  ) \
+    ACTION( RpoInsts                        , PrepareNothing        , Run<RpoInsts>            ) \
+    ACTION( DomTree                         , PrepareRpo            , Run<DomTree>             ) \
+    ACTION( LoopAnalysis                    , PrepareDomTree        , Run<LoopAnalysis>        ) \
+    ACTION( SCCP                            , PrepareNothing        , RunSccp                  ) \
+    ACTION( GVN                             , PrepareRpoInsts       , RunGvn                   ) \
+    ACTION( GCM                             , PrepareLoops          , RunGcm                   ) \
+    ACTION( GCMAfterGVN                     , PrepareGvn            , RunGcm                   ) \
+    ACTION( LinearOrder                     , PrepareGcm            , Run<LinearOrder>         ) \
+    ACTION( LivenessAnalyzer                , PrepareLinearOrder    , Run<LivenessAnalyzer>    ) \
+    ACTION( LinearScanRegAlloc              , PrepareLiveness       , RunLinearScan            ) \
+    ACTION( GraphColoringRegAlloc           , PrepareLiveness       , RunGraphColoring         ) \
+    ACTION( SsaDeconstruction               , PrepareLinearScan     , RunSsaDeconstruction     ) \
+    ACTION( GraphColoringSsaDeconstruction  , PrepareGraphColoring  , RunSsaDeconstruction     ) \
+    ACTION( Peepholes                       , PrepareRpoInsts       , RunPeepholes             ) \
+    ACTION( PeepholesHashConsing            , PrepareHashConsing    , RunPeepholes             ) \
+    ACTION( Inlining                        , PrepareNothing        , RunInlining              ) \
+    ACTION( ChecksElimination               , PrepareChecks         , Run<ChecksElimination>   )
+
+struct ShapeSizes {
+    GraphShape shape;
+    std::vector<uint32_t> sizes;
+};
+
+const std::vector<ShapeSizes> SHAPE_SIZES {
+    {GraphShape::CHAIN,        {100, 1000}},
+    {GraphShape::DIAMONDS,     {100, 1000}},
+    {GraphShape::NESTED_LOOPS, {8, 64}},
+    {GraphShape::IRREDUCIBLE,  {10, 100}},
+    {GraphShape::CONSTANTS,    {100, 1000}},
+};
+
+struct Options {
+    std::string filter;
+    uint32_t repetitions = 5;
+    std::string output;
+};
+
+struct Context {
+    Graph *graph;
+    // Methods for inlining
+    std::vector<Graph *> callees;
+    // Result of allocation for passes after it
+    std::vector<RegMap> regs_map;
+    // Quality of result of pass, which doesn't depend on time, e.g. number of spills
+    std::vector<std::pair<const char *, uint64_t>> counters;
+};
+
+void PrepareNothing(Context &) {}
+
+void PrepareRpo(Context &ctx) {
+    ctx.graph->GetPassManager()->GetAnalysis<RpoRegions>();
+}
+
+void PrepareRpoInsts(Context &ctx) {
+    ctx.graph->GetPassManager()->GetAnalysis<RpoInsts>();
+}
+
+void PrepareDomTree(Context &ctx) {
+    ctx.graph->GetPassManager()->GetAnalysis<DomTree>();
+}
+
+void PrepareLoops(Context &ctx) {
+    ctx.graph->GetPassManager()->GetAnalysis<LoopAnalysis>();
+}
+
+void PrepareChecks(Context &ctx) {
+    PrepareDomTree(ctx);
+    PrepareRpoInsts(ctx);
+}
+
+// Existing instructions are added to the table of graph here
+void PrepareHashConsing(Context &ctx) {
+    PrepareRpoInsts(ctx);
+    ctx.graph->SetHashConsing(true);
+}
+
+void PrepareGvn(Context &ctx) {
+    auto pm = ctx.graph->GetPassManager();
+    pm->RunPass<GVN>();
+    pm->GetAnalysis<LoopAnalysis>();
+}
+
+void PrepareGcm(Context &ctx) {
+    auto pm = ctx.graph->GetPassManager();
+    pm->RunPass<GCM>();
+    pm->GetAnalysis<LoopAnalysis>();
+}
+
+void PrepareLinearOrder(Context &ctx) {
+    PrepareGcm(ctx);
+    ctx.graph->GetPassManager()->GetAnalysis<LinearOrder>();
+}
+
+void PrepareLiveness(Context &ctx) {
+    PrepareGcm(ctx);
+    ctx.graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+}
+
+void PrepareLinearScan(Context &ctx) {
+    PrepareLiveness(ctx);
+    auto &liveness = ctx.graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+    LinearScanRegAlloc regalloc(liveness, Target::X86_64SysV());
+    regalloc.Run();
+    ctx.regs_map = std::move(regalloc.GetRegsMap());
+}
+
+void PrepareGraphColoring(Context &ctx) {
+    PrepareLiveness(ctx);
+    auto &liveness = ctx.graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+    GraphColoringRegAlloc regalloc(liveness, Target::X86_64SysV());
+    regalloc.Run();
+    ctx.regs_map = std::move(regalloc.GetRegsMap());
+}
+
+// Analyses and passes, which are created from graph only
+template <typename T>
+void Run(Context &ctx) {
+    T(ctx.graph).Run();
+}
+
+void RunSccp(Context &ctx) {
+    SCCP sccp(ctx.graph);
+    sccp.Run();
+    ctx.counters = {
+        {"folded_insts", sccp.GetNumFoldedInsts()},
+        {"folded_branches", sccp.GetNumFoldedBranches()},
+        {"removed_regions", sccp.GetNumRemovedRegions()},
+    };
+}
+
+void RunGvn(Context &ctx) {
+    GVN gvn(ctx.graph);
+    gvn.Run();
+    ctx.counters = {{"removed_insts", gvn.GetNumRemovedInsts()}};
+}
+
+// Instructions, which are left in graph, compare with GCMAfterGVN
+void RunGcm(Context &ctx) {
+    GCM gcm(ctx.graph);
+    gcm.Run();
+    ctx.counters = {{"placed_insts", gcm.GetNumPlacedInsts()}};
+}
+
+void RunLinearScan(Context &ctx) {
+    auto &liveness = ctx.graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+    LinearScanRegAlloc regalloc(liveness, Target::X86_64SysV());
+    regalloc.Run();
+    ctx.counters = {
+        {"spills", regalloc.GetNumSpills()},
+        {"splits", regalloc.GetNumSplits()},
+        {"stack_locations", regalloc.GetNumStackLocations()},
+        {"max_pressure", regalloc.GetMaxRegisterPressure()},
+        {"hint_misses", regalloc.GetNumHintMisses()},
+        {"spill_stores", regalloc.GetNumSpillStores()},
+        {"reloads", regalloc.GetNumReloads()},
+        {"stack_uses", regalloc.GetNumStackUses()},
+        {"rematerializations", regalloc.GetNumRematerializations()},
+        {"spill_cost", regalloc.GetSpillCost()},
+    };
+}
+
+// Spills and spill cost are counted as in linear scan, so results of allocators can be compared
+void RunGraphColoring(Context &ctx) {
+    auto &liveness = ctx.graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+    GraphColoringRegAlloc regalloc(liveness, Target::X86_64SysV());
+    regalloc.Run();
+    ctx.counters = {
+        {"spills", regalloc.GetNumSpills()},
+        {"stack_locations", regalloc.GetNumStackLocations()},
+        {"interferences", regalloc.GetNumInterferences()},
+        {"coalesced_moves", regalloc.GetNumCoalescedMoves()},
+        {"stack_uses", regalloc.GetNumStackUses()},
+        {"rematerializations", regalloc.GetNumRematerializations()},
+        {"spill_cost", regalloc.GetSpillCost()},
+    };
+}
+
+void RunSsaDeconstruction(Context &ctx) {
+    auto &liveness = ctx.graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+    SsaDeconstruction ssa_deconstruction(ctx.graph, liveness, ctx.regs_map, Target::X86_64SysV());
+    ssa_deconstruction.Run();
+    ctx.counters = {
+        {"moves", ssa_deconstruction.GetNumMoves()},
+        {"swaps", ssa_deconstruction.GetNumSwaps()},
+        {"scratch_moves", ssa_deconstruction.GetNumScratchMoves()},
+        {"split_edges", ssa_deconstruction.GetNumSplitEdges()},
+    };
+}
+
+// Constants of folding, which are found in graph, aren't created
+void RunPeepholes(Context &ctx) {
+    auto num_insts = ctx.graph->GetNumInsts();
+    Peepholes(ctx.graph).Run();
+    ctx.counters = {{"created_insts", ctx.graph->GetNumInsts() - num_insts}};
+}
+
+void RunInlining(Context &ctx) {
+    Inlining(ctx.graph, ctx.callees).Run();
+}
+
+struct PassBenchmark {
+    const char *name;
+    void (*prepare)(Context &);
+    void (*run)(Context &);
+};
+
+const PassBenchmark PASS_BENCHMARKS[] = {
+
+#define CREATE_PASS_BENCHMARK(NAME, PREPARE, RUN) \
+    {#NAME, PREPARE, RUN},
+
+    BENCHMARK_PASS_LIST(CREATE_PASS_BENCHMARK)
+
+#undef CREATE_PASS_BENCHMARK
+};
+
+struct Result {
+    std::string name;
+    const char *pass;
+    const char *shape;
+    uint32_t size;
+    // All repetitions build the same graph
+    size_t num_insts;
+    size_t arena_allocations;
+    size_t arena_bytes;
+    size_t arena_chunks;
+    std::vector<std::pair<const char *, uint64_t>> counters;
+    std::vector<uint64_t> times_ns;
+};
+
+std::string BenchmarkName(const PassBenchmark &bench, GraphShape shape, uint32_t size) {
+    return std::string(bench.name) + "/" + GraphShapeName(shape) + "/" + std::to_string(size);
+}
+
+uint64_t ElapsedNs(Clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+}
+
+Result RunBenchmark(const PassBenchmark &bench, GraphShape shape, uint32_t size,
+                    const Options &options, ArenaChunkPool *pool, Graph *callee) {
+    Result result {};
+    result.pass = bench.name;
+    result.shape = GraphShapeName(shape);
+    result.size = size;
+    result.name = BenchmarkName(bench, shape, size);
+
+    for (uint32_t i = 0; i < options.repetitions; i++) {
+        // Chunks of previous graph are reused, as it is in compilation of many methods
+        Graph graph(pool);
+        Context ctx {&graph, {callee}, {}, {}};
+
+        auto build_begin = Clock::now();
+        BuildGraph(&graph, shape, size);
+        auto build_time = ElapsedNs(build_begin);
+
+        result.num_insts = graph.GetNumInsts();
+        result.arena_allocations = graph.GetAllocator()->GetNumAllocations();
+        result.arena_bytes = graph.GetAllocator()->GetAllocatedBytes();
+        result.arena_chunks = graph.GetAllocator()->GetNumChunks();
+
+        if (bench.run == nullptr) {
+            result.times_ns.push_back(build_time);
+            continue;
+        }
+        bench.prepare(ctx);
+        auto begin = Clock::now();
+        bench.run(ctx);
+        result.times_ns.push_back(ElapsedNs(begin));
+        result.counters = ctx.counters;
+    }
+    return result;
+}
+
+void PrintResult(const Result &result, std::ostream &out) {
+    auto times = result.times_ns;
+    std::sort(times.begin(), times.end());
+    uint64_t sum = 0;
+    for (auto time : times) {
+        sum += time;
+    }
+    out << "    {\n";
+    out << "      \"name\": \"" << result.name << "\",\n";
+    out << "      \"pass\": \"" << result.pass << "\",\n";
+    out << "      \"shape\": \"" << result.shape << "\",\n";
+    out << "      \"size\": " << result.size << ",\n";
+    out << "      \"num_insts\": " << result.num_insts << ",\n";
+    out << "      \"repetitions\": " << times.size() << ",\n";
+    out << "      \"min_ns\": " << times.front() << ",\n";
+    out << "      \"median_ns\": " << times[times.size() / 2] << ",\n";
+    out << "      \"mean_ns\": " << sum / times.size() << ",\n";
+    out << "      \"max_ns\": " << times.back() << ",\n";
+    out << "      \"arena\": {\"allocations\": " << result.arena_allocations
+        << ", \"bytes\": " << result.arena_bytes
+        << ", \"chunks\": " << result.arena_chunks << "}";
+    if (!result.counters.empty()) {
+        out << ",\n      \"counters\": {";
+        for (size_t i = 0; i < result.counters.size(); i++) {
+            out << (i == 0 ? "" : ", ") << "\"" << result.counters[i].first << "\": " << result.counters[i].second;
+        }
+        out << "}";
+    }
+    out << "\n";
+    out << "    }";
+}
+
+bool ParseOptions(int argc, char **argv, Options *options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = arg.substr(arg.find('=') + 1);
+        if (arg.rfind("--filter=", 0) == 0) {
+            options->filter = value;
+        } else if (arg.rfind("--repetitions=", 0) == 0) {
+            options->repetitions = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg.rfind("--output=", 0) == 0) {
+            options->output = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n"
+                      << "Usage: " << argv[0] << " [--filter=<substring>] [--repetitions=<N>] [--output=<file>]\n";
+            return false;
+        }
+    }
+    if (options->repetitions == 0) {
+        std::cerr << "Number of repetitions should be positive\n";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int RunBenchmarks(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        return 1;
+    }
+
+    ArenaChunkPool pool;
+    Graph callee;
+    BuildCallee(&callee);
+
+    std::vector<Result> results;
+    for (auto &shape_sizes : SHAPE_SIZES) {
+        for (auto size : shape_sizes.sizes) {
+            for (auto &bench : PASS_BENCHMARKS) {
+                if (BenchmarkName(bench, shape_sizes.shape, size).find(options.filter) == std::string::npos) {
+                    continue;
+                }
+                results.push_back(RunBenchmark(bench, shape_sizes.shape, size, options, &pool, &callee));
+            }
+        }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Can't open " << options.output << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = options.output.empty() ? std::cout : file;
+    out << "{\n";
+    out << "  \"context\": {\"repetitions\": " << options.repetitions << "},\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        PrintResult(results[i], out);
+        out << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return 0;
+}
+
+}
+
+int main(int argc, char **argv) {
+    return compiler::RunBenchmarks(argc, argv);
+}
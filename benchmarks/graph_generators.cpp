@@ -0,0 +1,336 @@
+#include <vector>
+
+#include "graph_generators.h"
+
+namespace compiler {
+
+namespace {
+
+// Every CALL_PERIOD-th region of chain calls CALLEE_NAME
+constexpr uint32_t CALL_PERIOD = 16;
+
+/*
+ * Builds control chain of current region, data instructions are created
+ * without region, they are placed by GCM.
+ */
+class GraphBuilder
+{
+public:
+    explicit GraphBuilder(Graph *graph):
+        graph_(graph)
+    {
+        ASSERT(graph_->GetNumInsts() == 0);
+        auto start = graph_->CreateStartInst();
+        end_ = graph_->CreateEndInst();
+        last_ = start;
+
+        param_ = graph_->CreateParameterInst();
+        param_->SetIndexParam(0);
+        graph_->SetNumParams(1);
+        zero_ = graph_->CreateConstantInst(0);
+        one_ = graph_->CreateConstantInst(1);
+    }
+
+    Inst *GetParam() {
+        return param_;
+    }
+
+    Inst *GetZero() {
+        return zero_;
+    }
+
+    Inst *GetOne() {
+        return one_;
+    }
+
+    Inst *CreateConstant(ImmType value) {
+        return graph_->CreateConstantInst(value);
+    }
+
+    RegionInst *CreateRegion() {
+        return graph_->CreateRegionInst();
+    }
+
+    void StartRegion(RegionInst *region) {
+        last_ = region;
+    }
+
+    // Inst is added in the end of control chain
+    Inst *Append(Inst *inst) {
+        inst->SetControlInput(last_);
+        last_ = inst;
+        return inst;
+    }
+
+#define CREATE_BINARY(OPCODE)                           \
+    Inst *Create##OPCODE(Inst *left, Inst *right) {     \
+        auto inst = graph_->Create##OPCODE##Inst();     \
+        inst->SetType(Type::INT64);                     \
+        inst->SetDataInput(0, left);                    \
+        inst->SetDataInput(1, right);                   \
+        return inst;                                    \
+    }
+
+    CREATE_BINARY(Add)
+    CREATE_BINARY(Sub)
+    CREATE_BINARY(Mul)
+    CREATE_BINARY(Or)
+
+#undef CREATE_BINARY
+
+    Inst *CreateCompare(ConditionCode cc, Inst *left, Inst *right) {
+        auto inst = graph_->CreateCompareInst();
+        inst->SetCC(cc);
+        inst->SetDataInput(0, left);
+        inst->SetDataInput(1, right);
+        return inst;
+    }
+
+    Inst *CreateNullCheck(Inst *object) {
+        auto inst = Append(graph_->CreateNullCheckInst());
+        inst->SetDataInput(0, object);
+        return inst;
+    }
+
+    Inst *CreateCall(const char *name, Inst *arg) {
+        auto inst = graph_->CreateCallInst();
+        inst->SetNameFunc(name);
+        Append(inst);
+        inst->SetDataInput(0, arg);
+        return inst;
+    }
+
+    // First data input is for the first predecessor of current region
+    Inst *CreatePhi() {
+        auto inst = Append(graph_->CreatePhiInst());
+        inst->SetType(Type::INT64);
+        return inst;
+    }
+
+    void JumpTo(RegionInst *region) {
+        auto jump = graph_->CreateJumpInst();
+        jump->SetControlInput(last_);
+        jump->SetJmpTo(region);
+        last_ = nullptr;
+    }
+
+    void Branch(Inst *cond, RegionInst *true_branch, RegionInst *false_branch) {
+        auto inst = graph_->CreateIfInst();
+        inst->SetControlInput(last_);
+        inst->SetDataInput(0, cond);
+        inst->SetTrueBranch(true_branch);
+        inst->SetFalseBranch(false_branch);
+        last_ = nullptr;
+    }
+
+    void Return(Inst *value) {
+        auto ret = Append(graph_->CreateReturnInst());
+        ret->SetDataInput(0, value);
+        auto jump = graph_->CreateJumpInst();
+        jump->SetControlInput(ret);
+        jump->SetJmpTo(end_);
+        last_ = nullptr;
+    }
+
+private:
+    Graph *graph_;
+    Inst *end_;
+    Inst *last_;
+    ParameterInst *param_;
+    Inst *zero_;
+    Inst *one_;
+};
+
+void BuildChain(GraphBuilder &builder, uint32_t size) {
+    auto value = builder.GetParam();
+    for (uint32_t i = 0; i < size; i++) {
+        auto region = builder.CreateRegion();
+        builder.JumpTo(region);
+        builder.StartRegion(region);
+
+        auto checked = builder.CreateNullCheck(builder.GetParam());
+        value = builder.CreateAdd(value, checked);
+        // "x - 0" and "x | 0" are removed by peepholes
+        value = builder.CreateSub(value, builder.GetZero());
+        value = builder.CreateOr(value, builder.GetZero());
+        if (i % CALL_PERIOD == 0) {
+            value = builder.CreateCall(CALLEE_NAME, value);
+        }
+    }
+    builder.Return(value);
+}
+
+void BuildDiamonds(GraphBuilder &builder, uint32_t size) {
+    auto value = builder.GetParam();
+    for (uint32_t i = 0; i < size; i++) {
+        auto true_region = builder.CreateRegion();
+        auto false_region = builder.CreateRegion();
+        auto merge = builder.CreateRegion();
+
+        auto cond = builder.CreateCompare(ConditionCode::EQ, value, builder.GetZero());
+        builder.Branch(cond, true_region, false_region);
+
+        builder.StartRegion(true_region);
+        auto true_value = builder.CreateAdd(value, builder.GetOne());
+        builder.JumpTo(merge);
+
+        // "value + 1" is computed in both branches, GVN leaves one before the If
+        builder.StartRegion(false_region);
+        auto false_value = builder.CreateMul(builder.CreateAdd(builder.GetOne(), value), value);
+        builder.JumpTo(merge);
+
+        builder.StartRegion(merge);
+        value = builder.CreatePhi();
+        value->SetDataInput(0, true_value);
+        value->SetDataInput(1, false_value);
+    }
+    builder.Return(value);
+}
+
+/*
+ * for (i0 = 0; i0 < param; i0++)
+ *     for (i1 = 0; i1 < param; i1++)
+ *         ...
+ *     return i0 + param
+ */
+void BuildNestedLoops(GraphBuilder &builder, uint32_t size) {
+    struct Level {
+        RegionInst *header;
+        RegionInst *exit;
+        Inst *counter;
+        Inst *next;
+    };
+    ASSERT(size > 0);
+    std::vector<Level> levels;
+    levels.reserve(size);
+
+    auto preheader = builder.CreateRegion();
+    builder.JumpTo(preheader);
+    builder.StartRegion(preheader);
+    for (uint32_t i = 0; i < size; i++) {
+        Level level;
+        level.header = builder.CreateRegion();
+        auto body = builder.CreateRegion();
+        level.exit = builder.CreateRegion();
+
+        // Preheader is the first predecessor of header, backedge is the second one
+        builder.JumpTo(level.header);
+        builder.StartRegion(level.header);
+        level.counter = builder.CreatePhi();
+        level.counter->SetDataInput(0, builder.GetZero());
+        auto cond = builder.CreateCompare(ConditionCode::LT, level.counter, builder.GetParam());
+        builder.Branch(cond, body, level.exit);
+
+        builder.StartRegion(body);
+        level.next = builder.CreateAdd(level.counter, builder.GetOne());
+        levels.push_back(level);
+    }
+
+    // The innermost body
+    builder.CreateNullCheck(builder.GetParam());
+
+    for (auto it = levels.rbegin(); it != levels.rend(); it++) {
+        builder.JumpTo(it->header);
+        it->counter->SetDataInput(1, it->next);
+        builder.StartRegion(it->exit);
+    }
+    builder.Return(builder.CreateAdd(levels.front().counter, builder.GetParam()));
+}
+
+/*
+ * Cycle "first <-> second" can be entered through both regions:
+ *   entry -> first, entry -> second, first -> second, second -> first, second -> exit
+ */
+void BuildIrreducible(GraphBuilder &builder, uint32_t size) {
+    auto value = builder.GetParam();
+    for (uint32_t i = 0; i < size; i++) {
+        auto first = builder.CreateRegion();
+        auto second = builder.CreateRegion();
+        auto exit = builder.CreateRegion();
+
+        auto cond = builder.CreateCompare(ConditionCode::GT, value, builder.GetZero());
+        builder.Branch(cond, first, second);
+
+        builder.StartRegion(first);
+        builder.CreateNullCheck(builder.GetParam());
+        builder.JumpTo(second);
+
+        builder.StartRegion(second);
+        auto exit_cond = builder.CreateCompare(ConditionCode::LT, value, builder.GetParam());
+        builder.Branch(exit_cond, first, exit);
+
+        builder.StartRegion(exit);
+        value = builder.CreateAdd(value, builder.GetOne());
+    }
+    builder.Return(value);
+}
+
+void BuildConstants(GraphBuilder &builder, uint32_t size) {
+    auto value = builder.GetParam();
+    std::vector<Inst *> constants;
+    for (uint32_t i = 0; i < size; i++) {
+        auto region = builder.CreateRegion();
+        builder.JumpTo(region);
+        builder.StartRegion(region);
+
+        // Constants 0 and 1 are created by builder
+        constants.push_back(builder.CreateConstant(i + 2));
+        value = builder.CreateAdd(value, constants.back());
+        if (i % CALL_PERIOD == 0) {
+            value = builder.CreateCall(CALLEE_NAME, value);
+        }
+    }
+    // GCM places constant in the region of its first use, the second use keeps it live to the end
+    for (auto constant : constants) {
+        value = builder.CreateAdd(value, constant);
+    }
+    builder.Return(value);
+}
+
+}  // namespace
+
+const char *GraphShapeName(GraphShape shape) {
+    switch (shape) {
+
+#define SHAPE_NAME(SHAPE, NAME, ...) \
+        case GraphShape::SHAPE:      \
+            return NAME;
+
+        GRAPH_SHAPE_LIST(SHAPE_NAME)
+
+#undef SHAPE_NAME
+
+        default:
+            UNREACHABLE();
+    }
+    return nullptr;
+}
+
+void BuildGraph(Graph *graph, GraphShape shape, uint32_t size) {
+    GraphBuilder builder(graph);
+    switch (shape) {
+
+#define SHAPE_BUILD(SHAPE, NAME, BUILDER) \
+        case GraphShape::SHAPE:           \
+            BUILDER(builder, size);       \
+            break;
+
+        GRAPH_SHAPE_LIST(SHAPE_BUILD)
+
+#undef SHAPE_BUILD
+
+        default:
+            UNREACHABLE();
+    }
+}
+
+void BuildCallee(Graph *graph) {
+    GraphBuilder builder(graph);
+    graph->SetMethodName(CALLEE_NAME);
+    auto region = builder.CreateRegion();
+    builder.JumpTo(region);
+    builder.StartRegion(region);
+    builder.Return(builder.CreateAdd(builder.GetParam(), builder.GetOne()));
+}
+
+}
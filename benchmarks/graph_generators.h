@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "graph.h"
+
+namespace compiler {
+
+/*
+ * Synthetic graphs for compile-time benchmarks. Every shape is a valid method with one
+ * parameter and one Return, "size" sets number of repeated parts:
+ *   chain        - regions in a line, each with NullCheck, arithmetic and sometimes Call
+ *   diamonds     - If/Phi diamonds one after another, both branches compute the same sum
+ *   nested_loops - loop nest with "size" levels, every header has counter Phi
+ *   irreducible  - cycles with two entries one after another
+ *   constants    - chain of regions, each adds its own constant and sometimes calls,
+ *                  all constants are added again before Return, so they are live together
+ */
+#define GRAPH_SHAPE_LIST(ACTION)                                \
+    ACTION( CHAIN        , "chain"        , BuildChain        ) \
+    ACTION( DIAMONDS     , "diamonds"     , BuildDiamonds     ) \
+    ACTION( NESTED_LOOPS , "nested_loops" , BuildNestedLoops  ) \
+    ACTION( IRREDUCIBLE  , "irreducible"  , BuildIrreducible  ) \
+    ACTION( CONSTANTS    , "constants"    , BuildConstants    )
+
+enum class GraphShape {
+
+#define CREATE_SHAPE(SHAPE, ...) \
+    SHAPE,
+
+    GRAPH_SHAPE_LIST(CREATE_SHAPE)
+
+#undef CREATE_SHAPE
+
+    NUM_SHAPES
+};
+
+const char *GraphShapeName(GraphShape shape);
+
+// Graph must be empty
+void BuildGraph(Graph *graph, GraphShape shape, uint32_t size);
+
+// Method, which is called from "chain" graphs
+constexpr const char *CALLEE_NAME = "Callee";
+void BuildCallee(Graph *graph);
+
+}
@@ -40,12 +40,21 @@ uint32_t Graph::GetNumParams() {
     return num_params_;
 }
 
+Graph::~Graph() = default;
+
+PassManager *Graph::GetPassManager() {
+    if (pass_manager_ == nullptr) {
+        pass_manager_ = std::make_unique<PassManager>(this);
+    }
+    return pass_manager_.get();
+}
+
 Inst *Graph::CreateClearInstByOpcode(Opcode opc) {
     switch(opc) {
 
-#define CREATER_BY_OPCODE(OPCODE, BASE)                                                         \
+#define CREATER_BY_OPCODE(OPCODE, BASE, ...)                                                       \
         case Opcode::OPCODE: {                                                                  \
-            auto *inst = new BASE();                                                            \
+            auto *inst = NewInst<BASE>();                                                       \
             ASSERT(inst->GetOpcode() == Opcode::OPCODE || inst->GetOpcode() == Opcode::NONE);   \
             inst->SetOpcode(Opcode::OPCODE);                                                    \
             return inst;                                                                        \
@@ -55,9 +64,9 @@ INST_OPCODE_LIST(CREATER_BY_OPCODE)
 
 #undef CREATER_BY_OPCODE
 
-#define CREATER_REGION_BY_OPCODE(OPCODE, BASE)                                                  \
+#define CREATER_REGION_BY_OPCODE(OPCODE, BASE, ...)                                                \
         case Opcode::OPCODE: {                                                                  \
-            auto *inst = new BASE();                                                            \
+            auto *inst = NewInst<BASE>();                                                       \
             ASSERT(inst->GetOpcode() == Opcode::OPCODE || inst->GetOpcode() == Opcode::NONE);   \
             inst->SetOpcode(Opcode::OPCODE);                                                    \
             all_regions_.push_back(inst);                                                       \
@@ -123,6 +132,35 @@ void Graph::DumpPlacedInsts(std::ostream &out) const {
     }
 }
 
+void Graph::SetHashConsing(bool enable) {
+    if (hash_consing_ == enable) {
+        return;
+    }
+    hash_consing_ = enable;
+    value_table_ = ValueTable();
+    if (!enable) {
+        return;
+    }
+    // Duplicates, which are created before, stay in graph
+    for (auto inst : all_inst_) {
+        if (inst != nullptr) {
+            FindEqualInst(inst);
+        }
+    }
+}
+
+Inst *Graph::FindEqualInst(Inst *inst) {
+    // Instruction, which can trap, is computed only under its own guards
+    if (!hash_consing_ || !inst->IsPure() || inst->CanTrap() || insts_placed_) {
+        return nullptr;
+    }
+    auto inputs = inst->GetDataInputs();
+    if (std::find(inputs.begin(), inputs.end(), nullptr) != inputs.end()) {
+        return nullptr;
+    }
+    return value_table_.FindOrInsert(inst);
+}
+
 void Graph::AddInst(Inst *inst) {
     all_inst_.push_back(inst);
 }
@@ -131,21 +169,31 @@ void Graph::DeleteInst(Inst *inst) {
     // Delete all inputs
     for (id_t i = 0; i < inst->NumAllInputs(); i++) {
         if (inst->GetRawInput(i) != nullptr) {
-            inst->GetRawInput(i)->DeleteRawUser(inst);
+            inst->GetRawInput(i)->DeleteRawUser(inst, i);
         }
     }
     // Delete all users
-    if (inst->NumDataUsers() > 0) {
-        for (auto it = inst->GetRawUsers().begin(); it != inst->GetRawUsers().end(); it = (*it == nullptr) ? ++it : inst->GetRawUsers().begin()) {
-            if (*it != nullptr) {
-                (*it)->DeleteInput(inst);
-                inst->DeleteRawUser(*it);
-            }
+    for (auto &user : inst->GetControlUsers()) {
+        if (user != nullptr) {
+            user->DeleteInput(inst);
+            user = nullptr;
         }
     }
-    auto del = std::find(all_inst_.begin(), all_inst_.end(), inst);
-    *del = nullptr;
-    deleted_insts_.push_back(inst);
+    while (inst->HasDataUsers()) {
+        // Removes all inputs of the user, which are equal to inst
+        (*inst->GetDataUsers().begin())->DeleteInput(inst);
+    }
+    if (hash_consing_ && inst->IsPure()) {
+        value_table_.Erase(inst);
+    }
+    if (inst->IsRegion()) {
+        auto it = std::find(all_regions_.begin(), all_regions_.end(), inst);
+        ASSERT(it != all_regions_.end());
+        all_regions_.erase(it);
+    }
+    // Memory of instruction is released together with arena, id is its index
+    ASSERT(all_inst_.at(inst->GetId()) == inst);
+    all_inst_[inst->GetId()] = nullptr;
 }
 
 }
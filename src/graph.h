@@ -1,6 +1,12 @@
 #pragma once
 
+#include <limits>
+#include <type_traits>
+
 #include "inst.h"
+#include "pass_manager.h"
+#include "utils/arena_allocator.h"
+#include "value_table.h"
 
 namespace compiler {
 
@@ -9,23 +15,20 @@ class LiveInterval;
 class Graph
 {
 public:
-    Graph() {}
+    // Chunks of the arena are returned to "pool" after destruction of graph (if it is set)
+    Graph(ArenaChunkPool *pool = nullptr):
+        allocator_(pool) {}
 
-    ~Graph() {
-        for (auto inst : all_inst_) {
-            if (inst == nullptr) {
-                continue;
-            }
-            delete inst;
-        }
-        for (auto inst : deleted_insts_) {
-            if (inst == nullptr) {
-                continue;
-            }
-            delete inst;
-        }
+    // All instructions and loops are owned by the arena
+    ~Graph();
+
+    ArenaAllocator *GetAllocator() {
+        return &allocator_;
     }
 
+    // Is created on the first request
+    PassManager *GetPassManager();
+
     void SetMethodName(const std::string& name);
     std::string GetMethodName() const;
 
@@ -37,14 +40,22 @@ public:
     void AddInst(Inst *inst);
     void DeleteInst(Inst *inst);
 
-#define CREATE_CREATORS(OPCODE, BASE)                                                       \
+#define CREATE_CREATORS(OPCODE, BASE, ...)                                                     \
     template <typename... Args>                                                             \
     auto *Create##OPCODE##Inst(Args&&... args) {                                            \
-        auto inst = new BASE(std::forward<Args>(args)...);                                  \
+        static_assert(BASE::NUM_INPUTS == GetOpcodeProps(Opcode::OPCODE).num_inputs,          \
+                      "Storage of inputs doesn't match OPCODE_PROPS");                      \
+        auto inst = NewInst<BASE>(std::forward<Args>(args)...);                             \
         /* TODO - Bad API, perhaps there is a better way */                                 \
         ASSERT(inst->GetOpcode() == Opcode::OPCODE || inst->GetOpcode() == Opcode::NONE);   \
         inst->SetOpcode(Opcode::OPCODE);                                                    \
         inst->SetId(all_inst_.size());                                                      \
+        if constexpr (sizeof...(Args) != 0) {                                               \
+            /* Memory of "inst" stays in the arena unused */                                \
+            if (auto equal = FindEqualInst(inst); equal != nullptr) {                       \
+                return static_cast<BASE *>(equal);                                          \
+            }                                                                               \
+        }                                                                                   \
         all_inst_.push_back(inst);                                                          \
         return inst;                                                                        \
     }
@@ -54,10 +65,12 @@ public:
 #undef CREATE_CREATORS
 
 // TODO: fix copying of define
-#define CREATE_CREATORS_REGIONS(OPCODE, BASE)                                               \
+#define CREATE_CREATORS_REGIONS(OPCODE, BASE, ...)                                             \
     template <typename... Args>                                                             \
     auto *Create##OPCODE##Inst(Args&&... args) {                                            \
-        auto inst = new BASE(std::forward<Args>(args)...);                                  \
+        static_assert(BASE::NUM_INPUTS == GetOpcodeProps(Opcode::OPCODE).num_inputs,          \
+                      "Storage of inputs doesn't match OPCODE_PROPS");                      \
+        auto inst = NewInst<BASE>(std::forward<Args>(args)...);                             \
         /* TODO - Bad API, perhaps there is a better way */                                 \
         ASSERT(inst->GetOpcode() == Opcode::OPCODE || inst->GetOpcode() == Opcode::NONE);   \
         inst->SetOpcode(Opcode::OPCODE);                                                    \
@@ -124,6 +137,12 @@ public:
         return root_loop_;
     }
 
+    // Old loops stay in arena, but aren't reachable
+    void ClearLoops() {
+        root_loop_ = nullptr;
+        num_loops_ = 0;
+    }
+
     void SetRootLoop(Loop *loop) {
         root_loop_ = loop;
     }
@@ -142,16 +161,71 @@ public:
         return insts_placed_;
     }
 
+    /*
+     * Creators of PURE instructions with all inputs (and constants with immediate) return
+     * existing equal instruction instead of the new one. Instructions, which get inputs
+     * after creation or can trap, aren't merged. Works only before placement of instructions.
+     * Existing instructions are added to the table, when it is enabled.
+     */
+    void SetHashConsing(bool enable);
+
+    bool IsHashConsing() const {
+        return hash_consing_;
+    }
+
+    // Returns false if all marker slots of instructions are busy
+    bool AcquireMarkerSlot(uint32_t *slot) {
+        for (uint32_t i = 0; i < NUM_MARKER_SLOTS; i++) {
+            if ((busy_marker_slots_ & (1U << i)) == 0) {
+                busy_marker_slots_ |= 1U << i;
+                *slot = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ReleaseMarkerSlot(uint32_t slot) {
+        ASSERT((busy_marker_slots_ & (1U << slot)) != 0);
+        busy_marker_slots_ &= ~(1U << slot);
+    }
+
+    // Marks with all previous stamps become invalid for the new one
+    MarkerStamp NewMarkerStamp() {
+        ASSERT(last_marker_stamp_ != std::numeric_limits<MarkerStamp>::max());
+        return ++last_marker_stamp_;
+    }
+
+private:
+    // Returns nullptr if "inst" is new and can be created
+    Inst *FindEqualInst(Inst *inst);
+
+    template <typename T, typename... Args>
+    T *NewInst(Args&&... args) {
+        auto inst = allocator_.New<T>(std::forward<Args>(args)...);
+        if constexpr (std::is_base_of_v<DynamicInputs, T>) {
+            inst->SetAllocator(&allocator_);
+        }
+        return inst;
+    }
+
 private:
+    // Should be destroyed last, after all containers with pointers to instructions
+    ArenaAllocator allocator_;
     bool unit_test_mode_ = false;
     bool insts_placed_ = false;
+    bool hash_consing_ = false;
     uint32_t num_loops_ = 0;
     uint32_t num_params_ = 0;
+    uint32_t busy_marker_slots_ = 0;
+    MarkerStamp last_marker_stamp_ = 0;
     Loop *root_loop_ = nullptr;
     std::string name_method_;
     std::vector<Inst *> all_inst_;
     std::vector<RegionInst *> all_regions_;
-    std::vector<Inst *> deleted_insts_;
+    ValueTable value_table_;
+    // Cached analyses point to instructions, so it is destroyed before arena
+    std::unique_ptr<PassManager> pass_manager_;
 };
 
 }
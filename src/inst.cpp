@@ -1,8 +1,10 @@
 #include "inst.h"
+#include "inst_map.h"
 #include "opcodes.h"
 #include <string>
 #include <iomanip>
 
+#include "utils/arena_allocator.h"
 #include "optimizations/analysis/loop_analysis.h"
 
 namespace compiler {
@@ -10,6 +12,10 @@ namespace compiler {
 void Inst::SetControlInput(Inst *inst) {
     ASSERT(inst != nullptr);
     ASSERT(HasControlProp());
+    if (NumAllInputs() != 0 && GetRawInput(0) != nullptr && GetRawInput(0) != inst) {
+        // Old control input doesn't point to this inst anymore
+        GetRawInput(0)->DeleteRawUser(this, 0);
+    }
     SetRawInput(0, inst);
     inst->SetControlUser(this);
 }
@@ -21,17 +27,12 @@ Inst *Inst::GetControlInput() {
 
 void Inst::SetControlUser(Inst *inst) {
     ASSERT(HasControlProp());
-    if (GetRawUsers().size() == 0) {
-        GetRawUsers().push_back(inst);
-        return;
-    }
-    *GetRawUsers().begin() = inst;
+    control_users_[0] = inst;
 }
 
 Inst *Inst::GetControlUser() {
     ASSERT(HasControlProp());
-    ASSERT(GetRawUsers().size() > 0);
-    return *GetRawUsers().begin();
+    return control_users_[0];
 }
 
 void Inst::SetDataInput(id_t index, Inst *inst) {
@@ -42,10 +43,13 @@ void Inst::SetDataInput(id_t index, Inst *inst) {
     }
     // For dynamic inputs
     if (index != NumAllInputs() && GetRawInput(index) != nullptr) {
-        GetRawInput(index)->DeleteDataUser(this);
+        auto use = GetUse(index);
+        if (use->IsLinked()) {
+            GetRawInput(index)->RemoveUse(use);
+        }
     }
     SetRawInput(index, inst);
-    inst->AddDataUser(this);
+    inst->AddUse(GetUse(index));
 }
 
 Inst *Inst::GetDataInput(id_t index) {
@@ -57,57 +61,109 @@ Inst *Inst::GetDataInput(id_t index) {
     return GetRawInput(index);
 }
 
-const std::list<Inst *> Inst::GetDataUsers() {
-    return std::list<Inst *>(StartIteratorDataUsers(), GetRawUsers().end());
+void Inst::AddUse(Use *use) {
+    ASSERT(!use->IsLinked());
+    use->linked_ = true;
+    use->prev_ = last_use_;
+    use->next_ = nullptr;
+    if (last_use_ == nullptr) {
+        first_use_ = use;
+    } else {
+        last_use_->next_ = use;
+    }
+    last_use_ = use;
+    num_uses_++;
 }
 
-void Inst::AddDataUser(Inst *inst) {
-    if (HasControlProp() && GetRawUsers().size() == 0) {
-        GetRawUsers().push_back(nullptr);
+void Inst::RemoveUse(Use *use) {
+    ASSERT(use->IsLinked());
+    if (use->prev_ == nullptr) {
+        first_use_ = use->next_;
+    } else {
+        use->prev_->next_ = use->next_;
     }
-    auto it = std::find(StartIteratorDataUsers(), GetRawUsers().end(), inst);
-    if (it != GetRawUsers().end()) {
-        return;
+    if (use->next_ == nullptr) {
+        last_use_ = use->prev_;
+    } else {
+        use->next_->prev_ = use->prev_;
     }
-    GetRawUsers().push_back(inst);
+    use->linked_ = false;
+    use->prev_ = nullptr;
+    use->next_ = nullptr;
+    num_uses_--;
 }
 
-void Inst::DeleteDataUser(Inst *inst) {
-    auto it = std::find(StartIteratorDataUsers(), GetRawUsers().end(), inst);
-    ASSERT(it != GetRawUsers().end());
-    users_.erase(it);
+void Inst::RelinkUse(Use *from, Use *to) {
+    ASSERT(from->IsLinked());
+    to->linked_ = true;
+    to->prev_ = from->prev_;
+    to->next_ = from->next_;
+    if (to->prev_ == nullptr) {
+        first_use_ = to;
+    } else {
+        to->prev_->next_ = to;
+    }
+    if (to->next_ == nullptr) {
+        last_use_ = to;
+    } else {
+        to->next_->prev_ = to;
+    }
+    from->linked_ = false;
+    from->prev_ = nullptr;
+    from->next_ = nullptr;
 }
 
-void Inst::DeleteRawUser(Inst *inst) {
-    auto it = std::find(GetRawUsers().begin(), GetRawUsers().end(), inst);
-    if (it != GetRawUsers().end()) {
-        users_.erase(it);
+void Inst::DeleteRawUser(Inst *user, id_t index) {
+    ASSERT(user->GetRawInput(index) == this);
+    auto use = user->GetUse(index);
+    if (use->IsLinked()) {
+        RemoveUse(use);
+        return;
+    }
+    // Control edge
+    for (auto &control_user : control_users_) {
+        if (control_user == user) {
+            control_user = nullptr;
+        }
     }
 }
 
-uint32_t Inst::NumDataUsers() {
-    return HasControlProp() ? GetRawUsers().size() - 1 : GetRawUsers().size();
+bool Inst::HasSingleDataUser() {
+    if (first_use_ == nullptr) {
+        return false;
+    }
+    for (auto use : GetDataUses()) {
+        if (use->GetUser() != first_use_->GetUser()) {
+            return false;
+        }
+    }
+    return true;
 }
 
-void DynamicInputs::SetRawInput(id_t index, Inst *inst) {
-    ASSERT(index <= NumAllInputs());
-    if (index == NumAllInputs()) {
-        inputs_.push_back(inst);
-        return;
-    }
-    auto it = inputs_.begin();
-    for (id_t i = 0; i < index; i++) {
-        it++;
+void Inst::AppendRawInput(Inst *inst) {
+    ASSERT(GetOpcodeProps(GetOpcode()).num_inputs == DYNAMIC_INPUTS);
+    static_cast<DynamicInputs *>(this)->AddInput(inst);
+}
+
+void DynamicInputs::Grow() {
+    ASSERT(allocator_ != nullptr);
+    uint32_t new_capacity = capacity_ * 2;
+    auto new_inputs = allocator_->AllocArray<Inst *>(new_capacity);
+    auto new_uses = allocator_->AllocArray<Use>(new_capacity);
+    for (id_t i = 0; i < num_inputs_; i++) {
+        new_inputs[i] = inputs_data_[i];
+        MoveUse(i, new (&new_uses[i]) Use(), i);
     }
-    *it = inst;
+    inputs_data_ = new_inputs;
+    uses_data_ = new_uses;
+    capacity_ = new_capacity;
 }
 
-Inst *DynamicInputs::GetRawInput(id_t index) {
-    auto it = inputs_.begin();
-    for (id_t i = 0; i < index; i++) {
-        it++;
+void DynamicInputs::MoveUse(id_t from, Use *to, id_t new_index) {
+    to->Init(this, new_index);
+    if (uses_data_[from].IsLinked()) {
+        inputs_data_[from]->RelinkUse(&uses_data_[from], to);
     }
-    return *it;
 }
 
 void Inst::Dump(std::ostream& out) {
@@ -152,28 +208,37 @@ void RegionInst::DumpOpcode(std::ostream& out) {
 }
 
 void Inst::DumpUsers(std::ostream& out) {
-    if (GetRawUsers().size() == 0) {
+    bool has_control_user = HasControlProp() && GetControlUser() != nullptr;
+    if (!has_control_user && !HasDataUsers()) {
         return;
     }
     out << std::string(" -> ");
     bool first = true;
-    for (auto inst : GetRawUsers()) {
-        out << std::string(first ? "" : ", ");
-        if (inst == nullptr) {
-            out << std::string("NOT_SET");
-            first = false;
+    if (HasControlProp()) {
+        out << (has_control_user ? std::string("v") + std::to_string(GetControlUser()->GetId()) : std::string("NOT_SET"));
+        first = false;
+    }
+    for (auto use : GetDataUses()) {
+        // User with several same inputs is printed once
+        bool printed = false;
+        for (auto prev = first_use_; prev != use; prev = prev->GetNext()) {
+            if (prev->GetUser() == use->GetUser()) {
+                printed = true;
+                break;
+            }
+        }
+        if (printed) {
             continue;
         }
-        out << std::string("v") << std::to_string(inst->GetId());
+        out << std::string(first ? "" : ", ") << std::string("v") << std::to_string(use->GetUser()->GetId());
         first = false;
     }
 }
 
 void IfInst::DumpUsers(std::ostream &out) {
-    ASSERT(GetRawUsers().size() == 2);
     out << std::string(" -> ");
     bool first = true;
-    for (auto inst : GetRawUsers()) {
+    for (auto inst : GetControlUsers()) {
         out << std::string(first ? "" : ", ");
         if (inst == nullptr) {
             out << std::string("NOT_SET");
@@ -186,7 +251,12 @@ void IfInst::DumpUsers(std::ostream &out) {
 }
 
 void PhiInst::DumpInputs(std::ostream &out) {
-    auto region = static_cast<RegionInst *>(GetControlInput());
+    // Phis of region are chained by control edges after the region
+    auto control = GetControlInput();
+    while (!control->IsRegion()) {
+        control = control->GetControlInput();
+    }
+    auto region = static_cast<RegionInst *>(control);
     if (NumDataInputs() != region->NumAllInputs()) {
         std::cerr << "Num inputs in PHI and regions not equal!\n";
         std::exit(1);
@@ -223,12 +293,6 @@ std::string CcToString(ConditionCode cc) {
     return CC_NAME.at(static_cast<size_t>(cc));
 }
 
-RegionInst::~RegionInst() {
-    if (loop_ != nullptr) {
-        delete loop_;
-    }
-}
-
 bool RegionInst::IsLoopHeader() {
     return GetLoop()->GetHeader() == this;
 }
@@ -293,19 +357,79 @@ JumpInst *Inst::CastToJump() {
     return static_cast<JumpInst *>(this);
 }
 
-void Inst::ReplaceDataUsers(Inst *from) {
-    for (auto it = from->StartIteratorDataUsers(); it != from->GetRawUsers().end(); it = from->StartIteratorDataUsers()) {
-        auto user = *it;
-        if (user == nullptr) {
-            continue;
-        }
-        for (id_t i = 0; i < user->NumDataInputs(); i++) {
-            if (user->GetDataInput(i) == from) {
-                user->SetDataInput(i, this);
+CompareInst *Inst::CastToCompare() {
+    ASSERT(GetOpcode() == Opcode::Compare);
+    return static_cast<CompareInst *>(this);
+}
+
+namespace {
+
+size_t CombineHash(size_t hash, size_t value) {
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6U) + (hash >> 2U));
+}
+
+}  // namespace
+
+size_t Inst::GetValueHash() {
+    ASSERT(IsPure());
+    auto hash = CombineHash(static_cast<size_t>(GetOpcode()), static_cast<size_t>(GetType()));
+    switch (GetOpcode()) {
+        case Opcode::Constant:
+            hash = CombineHash(hash, static_cast<size_t>(CastToConstant()->GetImm()));
+            break;
+        case Opcode::Compare:
+            hash = CombineHash(hash, static_cast<size_t>(CastToCompare()->GetCC()));
+            break;
+        default:
+            break;
+    }
+    auto inputs = GetDataInputs();
+    if (IsCommutative()) {
+        ASSERT(inputs.size() == 2);
+        auto left = inputs[0]->GetId();
+        auto right = inputs[1]->GetId();
+        return CombineHash(CombineHash(hash, std::min(left, right)), std::max(left, right));
+    }
+    for (auto input : inputs) {
+        hash = CombineHash(hash, input->GetId());
+    }
+    return hash;
+}
+
+bool Inst::IsValueEqual(Inst *other) {
+    ASSERT(IsPure() && other->IsPure());
+    if (GetOpcode() != other->GetOpcode() || GetType() != other->GetType()) {
+        return false;
+    }
+    switch (GetOpcode()) {
+        case Opcode::Constant:
+            return CastToConstant()->GetImm() == other->CastToConstant()->GetImm();
+        case Opcode::Compare:
+            if (CastToCompare()->GetCC() != other->CastToCompare()->GetCC()) {
+                return false;
             }
-        }
+            break;
+        default:
+            break;
+    }
+    auto inputs = GetDataInputs();
+    auto other_inputs = other->GetDataInputs();
+    if (inputs.size() != other_inputs.size()) {
+        return false;
+    }
+    if (std::equal(inputs.begin(), inputs.end(), other_inputs.begin())) {
+        return true;
+    }
+    return IsCommutative() && inputs[0] == other_inputs[1] && inputs[1] == other_inputs[0];
+}
+
+void Inst::ReplaceDataUsers(Inst *from) {
+    while (from->first_use_ != nullptr) {
+        auto use = from->first_use_;
+        from->RemoveUse(use);
+        use->GetUser()->SetRawInput(use->GetIndex(), this);
+        AddUse(use);
     }
-    from->GetRawUsers().erase(from->StartIteratorDataUsers(), from->GetRawUsers().end());
 }
 
 void CallInst::SetNameFunc(const std::string &name) {
@@ -316,7 +440,7 @@ std::string CallInst::GetNameFunc() const {
     return name_func_;
 }
 
-Inst *Inst::LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) {
+Inst *Inst::LiteClone(Graph *target_graph, InstMap<id_t> &connect) {
     auto new_inst = target_graph->CreateClearInstByOpcode(GetOpcode());
     new_inst->type_ = type_;
     new_inst->SetId(target_graph->GetNumInsts());
@@ -346,25 +470,25 @@ Inst *Inst::LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) {
     return new_inst;
 }
 
-Inst *ConstantInst::LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) {
+Inst *ConstantInst::LiteClone(Graph *target_graph, InstMap<id_t> &connect) {
     auto new_inst = static_cast<ConstantInst *>(Inst::LiteClone(target_graph, connect));
     new_inst->SetImm(GetImm());
     return new_inst;
 }
 
-Inst *CompareInst::LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) {
+Inst *CompareInst::LiteClone(Graph *target_graph, InstMap<id_t> &connect) {
     auto new_inst = static_cast<CompareInst *>(FixedInputs<2>::LiteClone(target_graph, connect));
     new_inst->SetCC(GetCC());
     return new_inst;
 }
 
-Inst *ParameterInst::LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) {
+Inst *ParameterInst::LiteClone(Graph *target_graph, InstMap<id_t> &connect) {
     auto new_inst = static_cast<ParameterInst *>(Inst::LiteClone(target_graph, connect));
     new_inst->SetIndexParam(GetIndexParam());
     return new_inst;
 }
 
-Inst *CallInst::LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) {
+Inst *CallInst::LiteClone(Graph *target_graph, InstMap<id_t> &connect) {
     auto new_inst = static_cast<CallInst *>(Inst::LiteClone(target_graph, connect));
     new_inst->SetNameFunc(GetNameFunc());
     return new_inst;
@@ -407,30 +531,45 @@ void Inst::ReplaceCtrUser(Inst *from) {
 }
 
 void DynamicInputs::DeleteInput(Inst *inst) {
-    auto it = std::find(inputs_.begin(), inputs_.end(), inst);
-    ASSERT(it != inputs_.end());
-    inputs_.erase(it);
+    id_t new_num = 0;
+    for (id_t i = 0; i < num_inputs_; i++) {
+        if (inputs_data_[i] == inst) {
+            if (uses_data_[i].IsLinked()) {
+                inst->RemoveUse(&uses_data_[i]);
+            }
+            continue;
+        }
+        // Following inputs are shifted
+        if (new_num != i) {
+            inputs_data_[new_num] = inputs_data_[i];
+            MoveUse(i, &uses_data_[new_num], new_num);
+        }
+        new_num++;
+    }
+    ASSERT(new_num != num_inputs_);
+    num_inputs_ = new_num;
 }
 
-RegionInst *FindRegion(Inst *inst) {
-    ASSERT(inst->HasControlProp());
-    while (!inst->IsRegion()) {
-        inst = inst->GetControlInput();
+void DynamicInputs::DeleteInputAt(id_t index) {
+    ASSERT(index < num_inputs_);
+    if (uses_data_[index].IsLinked()) {
+        inputs_data_[index]->RemoveUse(&uses_data_[index]);
     }
-    return inst->CastToRegion();
+    for (id_t i = index + 1; i < num_inputs_; i++) {
+        inputs_data_[i - 1] = inputs_data_[i];
+        MoveUse(i, &uses_data_[i - 1], i - 1);
+    }
+    num_inputs_--;
 }
 
 bool Inst::IsDominated(Inst *other) {
     ASSERT(HasControlProp() && other->HasControlProp());
-    auto *our_region = FindRegion(this);
-    auto *other_region = FindRegion(other);
+    auto *our_region = GetControlRegion();
+    auto *other_region = other->GetControlRegion();
+    ASSERT(our_region != nullptr && other_region != nullptr);
 
     if (our_region == other_region) {
-        auto *inst = other;
-        while (inst != other_region && inst != this) {
-            inst = inst->GetControlInput();
-        }
-        return inst == this;
+        return GetControlOrdinal() <= other->GetControlOrdinal();
     }
     // Insts in different regions
     return our_region->IsDominated(other_region);
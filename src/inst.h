@@ -1,15 +1,14 @@
 #pragma once
 
 #include <cstdint>
-#include <map>
 #include <vector>
-#include <list>
 #include <string>
 #include <iostream>
 #include <algorithm>
 
 #include "opcodes.h"
 #include "utils/utils.h"
+#include "utils/span.h"
 
 namespace compiler {
 
@@ -34,10 +33,16 @@ namespace compiler {
 */
 
 class Loop;
+class ArenaAllocator;
 
 using id_t = uint32_t;
 using LinearNumber = uint32_t;
 using LifeNumber = uint32_t;
+// Unique value of one Marker, zero is never used
+using MarkerStamp = uint32_t;
+
+// Several markers can be used at the same time without extra memory
+static constexpr uint32_t NUM_MARKER_SLOTS = 4;
 
 std::string OpcodeToString(Opcode opc);
 std::string CcToString(ConditionCode cc);
@@ -50,24 +55,134 @@ class JumpInst;
 class ConstantInst;
 class ParameterInst;
 class CallInst;
+class CompareInst;
+class Inst;
+
+template <typename T>
+class InstMap;
+
+/*
+ * Edge "input -> user" of data flow. Each input slot of an instruction has own record,
+ * which is linked in intrusive list of users of the input instruction.
+ * So edge is added or removed in O(1) and walking users doesn't allocate.
+ * Control edges don't use this records.
+ */
+class Use
+{
+public:
+    Inst *GetUser() const {
+        return user_;
+    }
+
+    // Index of the input in the user
+    id_t GetIndex() const {
+        return index_;
+    }
+
+    Use *GetNext() const {
+        return next_;
+    }
+
+    bool IsLinked() const {
+        return linked_;
+    }
+
+    void Init(Inst *user, id_t index) {
+        user_ = user;
+        index_ = index;
+    }
+
+private:
+    friend class Inst;
+    friend class DynamicInputs;
+
+    Inst *user_ = nullptr;
+    id_t index_ = 0;
+    bool linked_ = false;
+    Use *prev_ = nullptr;
+    Use *next_ = nullptr;
+};
+
+class UseIterator
+{
+public:
+    UseIterator(Use *use):
+        use_(use) {}
+
+    Use *operator*() const {
+        return use_;
+    }
+
+    UseIterator &operator++() {
+        use_ = use_->GetNext();
+        return *this;
+    }
+
+    bool operator!=(const UseIterator &other) const {
+        return use_ != other.use_;
+    }
+
+protected:
+    Use *use_;
+};
+
+class UserIterator : public UseIterator
+{
+public:
+    using UseIterator::UseIterator;
+
+    Inst *operator*() const {
+        return use_->GetUser();
+    }
+};
+
+template <typename Iterator>
+class IteratorRange
+{
+public:
+    IteratorRange(Iterator begin, Iterator end):
+        begin_(begin), end_(end) {}
+
+    Iterator begin() const {
+        return begin_;
+    }
+
+    Iterator end() const {
+        return end_;
+    }
+
+private:
+    Iterator begin_;
+    Iterator end_;
+};
+
+// Ranges must not be used if current element of iteration is removed
+using UsesRange = IteratorRange<UseIterator>;
+using UsersRange = IteratorRange<UserIterator>;
 
 class Inst
 {
 public:
     Inst():
         opc_(Opcode::NONE),
-        type_(Type::NONE) {};
+        type_(Type::NONE),
+        flags_(GetOpcodeProps(Opcode::NONE).flags) {};
 
     Inst(Opcode opc):
         opc_(opc),
-        type_(Type::NONE) {};
+        type_(Type::NONE),
+        flags_(GetOpcodeProps(opc).flags) {};
 
     Inst(Opcode opc, Type type):
         opc_(opc),
-        type_(type) {};
+        type_(type),
+        flags_(GetOpcodeProps(opc).flags) {};
     virtual ~Inst() = default;
 
-    virtual Inst *LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect);
+    // Is compared with OPCODE_PROPS by creators of Graph
+    static constexpr uint32_t NUM_INPUTS = 0;
+
+    virtual Inst *LiteClone(Graph *target_graph, InstMap<id_t> &connect);
 
     virtual void DeleteInput([[maybe_unused]] Inst *inst) {
         std::cerr << "Inst with opcode " << OPCODE_NAME[static_cast<size_t>(GetOpcode())] << " don't have inputs\n";
@@ -100,10 +215,40 @@ public:
 
     void SetOpcode(Opcode opc) {
         opc_ = opc;
+        flags_ = GetOpcodeProps(opc).flags;
+    }
+
+    // Properties are taken from OPCODE_PROPS, so checks don't need virtual calls
+    bool HasFlag(OpcodeFlag flag) const {
+        return (flags_ & flag) != 0;
+    }
+
+    bool HasControlProp() const {
+        return HasFlag(CONTROL_PROP);
+    }
+
+    bool IsPure() const {
+        return HasFlag(PURE);
+    }
+
+    bool IsCommutative() const {
+        return HasFlag(COMMUTATIVE);
+    }
+
+    bool IsTerminator() const {
+        return HasFlag(TERMINATOR);
     }
 
-    virtual uint32_t NumAllInputs() {
-        return 0;
+    bool IsRematerializable() const {
+        return HasFlag(REMATERIALIZABLE);
+    }
+
+    bool CanTrap() const {
+        return HasFlag(CAN_TRAP);
+    }
+
+    uint32_t NumAllInputs() const {
+        return num_inputs_;
     }
 
     uint32_t NumDataInputs() {
@@ -112,10 +257,6 @@ public:
         return HasControlProp() ? num_all - 1 : num_all;
     }
 
-    virtual bool HasControlProp() {
-        return false;
-    }
-
     // Next functions not virtual for better perfomance
     void SetControlInput(Inst *inst);
     Inst *GetControlInput();
@@ -123,46 +264,79 @@ public:
     void SetControlUser(Inst *inst);
     Inst *GetControlUser();
 
+    // Successors in control flow: true and false branches for If, control user for others
+    Span<Inst *> GetControlUsers() {
+        uint32_t num = GetOpcode() == Opcode::If ? 2 : (control_users_[0] != nullptr ? 1 : 0);
+        return Span<Inst *>(control_users_.data(), num);
+    }
+
     void SetDataInput(id_t index, Inst *inst);
     Inst *GetDataInput(id_t index);
 
-    void AddDataUser(Inst *inst);
-    void DeleteDataUser(Inst *inst);
-    void DeleteRawUser(Inst *inst);
+    // Remove edge to "user", which has this inst as input number "index"
+    void DeleteRawUser(Inst *user, id_t index);
 
-    bool HasSingleDataUser() {
-        return NumDataUsers() == 1;
-    }
+    // User, which uses this inst in several inputs, is counted once
+    bool HasSingleDataUser();
 
     Inst *GetSingleDataUser() {
         ASSERT(HasSingleDataUser());
-        return GetRawUsers().back();
+        return first_use_->GetUser();
     }
 
-    const std::list<Inst *> GetDataUsers();
+    bool HasDataUsers() const {
+        return first_use_ != nullptr;
+    }
+
+    // Number of used inputs of other instructions, user can be counted several times
+    uint32_t NumDataUses() const {
+        return num_uses_;
+    }
+
+    UsersRange GetDataUsers() {
+        return UsersRange(UserIterator(first_use_), UserIterator(nullptr));
+    }
+
+    UsesRange GetDataUses() {
+        return UsesRange(UseIterator(first_use_), UseIterator(nullptr));
+    }
 
     virtual void DumpInputs([[maybe_unused]] std::ostream &out) {};
     virtual void DumpUsers(std::ostream &out);
 
-    uint32_t NumDataUsers();
-    std::list<Inst *> & GetRawUsers() {
-        return users_;
+    // Inputs of all instructions are accessed through storage view in the base class,
+    // so FixedInputs and DynamicInputs don't need virtual accessors
+    Use *GetUse(id_t index) {
+        ASSERT(index < num_inputs_);
+        return &uses_data_[index];
     }
 
-    virtual Inst *GetRawInput([[maybe_unused]] id_t index) {
-        std::cerr << "Inst with opcode " << OPCODE_NAME[static_cast<size_t>(GetOpcode())] << " don't have inputs\n";
-        UNREACHABLE();
-        return nullptr;
+    Inst *GetRawInput(id_t index) {
+        ASSERT(index < num_inputs_);
+        return inputs_data_[index];
     }
 
-    virtual void SetRawInput([[maybe_unused]] id_t index, [[maybe_unused]] Inst *inst) {
-        std::cerr << "Inst with opcode " << OPCODE_NAME[static_cast<size_t>(GetOpcode())] << " don't have inputs\n";
-        UNREACHABLE();
-        return;
+    // Input with index equal to number of inputs is appended (only for DynamicInputs)
+    void SetRawInput(id_t index, Inst *inst) {
+        ASSERT(index <= num_inputs_);
+        if (index == num_inputs_) {
+            AppendRawInput(inst);
+            return;
+        }
+        inputs_data_[index] = inst;
+    }
+
+    Span<Inst *> GetAllInputs() {
+        return Span<Inst *>(inputs_data_, num_inputs_);
+    }
+
+    Span<Inst *> GetDataInputs() {
+        ASSERT(!IsRegion());
+        return HasControlProp() ? GetAllInputs().SubSpan(1) : GetAllInputs();
     }
 
     bool IsRegion() const {
-        return GetOpcode() == Opcode::Start || GetOpcode() == Opcode::Region || GetOpcode() == Opcode::End;
+        return HasFlag(REGION);
     }
 
     bool IsPhi() const {
@@ -199,6 +373,7 @@ public:
     ConstantInst *CastToConstant();
     ParameterInst *CastToParameter();
     CallInst *CastToCall();
+    CompareInst *CastToCompare();
 
     bool IsPlaced() const {
         return inst_placed_;
@@ -224,18 +399,63 @@ public:
         return life_number_;
     }
 
+    /*
+     * Value of PURE instruction is defined by opcode, type, data inputs and immediates,
+     * so equal instructions compute the same value. Inputs of COMMUTATIVE instruction
+     * are compared in any order, hash doesn't depend on it too.
+     */
+    size_t GetValueHash();
+    bool IsValueEqual(Inst *other);
+
     void ReplaceDataUsers(Inst *from);
     void ReplaceAllUsers(Inst *from);
     void ReplaceCtrUser(Inst *from);
     void UpdateCtrConnection(Inst *from);
 
+    // Both instructions must be in control chains, DomTree must be built
     bool IsDominated(Inst *other);
 
-private:
-    auto StartIteratorDataUsers() {
-        return HasControlProp() ? ++GetRawUsers().begin() : GetRawUsers().begin();
+    // Position in control chain of the region, is set by DomTree
+    void SetControlOrder(RegionInst *region, uint32_t ordinal) {
+        control_region_ = region;
+        control_ordinal_ = ordinal;
+    }
+
+    RegionInst *GetControlRegion() {
+        return control_region_;
+    }
+
+    uint32_t GetControlOrdinal() const {
+        return control_ordinal_;
+    }
+
+    // Only for Marker
+    MarkerStamp GetMarkerStamp(uint32_t slot) const {
+        ASSERT(slot < NUM_MARKER_SLOTS);
+        return markers_[slot];
+    }
+
+    void SetMarkerStamp(uint32_t slot, MarkerStamp stamp) {
+        ASSERT(slot < NUM_MARKER_SLOTS);
+        markers_[slot] = stamp;
+    }
+
+    // Low-level maintenance of the users list, input value in the slot of "use" isn't changed
+    void AddUse(Use *use);
+    void RemoveUse(Use *use);
+    // Use record was moved to other address
+    void RelinkUse(Use *from, Use *to);
+
+protected:
+    void SetInputsStorage(Inst **inputs, Use *uses, uint32_t num) {
+        inputs_data_ = inputs;
+        uses_data_ = uses;
+        num_inputs_ = num;
     }
 
+private:
+    void AppendRawInput(Inst *inst);
+
 private:
     bool inst_placed_ = false;
     id_t id_ {};
@@ -243,47 +463,73 @@ private:
     LifeNumber life_number_ {};
     Opcode opc_ {};
     Type type_ {};
+    uint32_t flags_ {};
+    std::array<MarkerStamp, NUM_MARKER_SLOTS> markers_ {};
+    RegionInst *control_region_ = nullptr;
+    uint32_t control_ordinal_ = 0;
 
 protected:
     Inst *prev_ = nullptr;
     Inst *next_ = nullptr;
+    // Storage of inputs is owned by derived class
+    Inst **inputs_data_ = nullptr;
+    Use *uses_data_ = nullptr;
+    uint32_t num_inputs_ = 0;
 
 private:
-    std::list<Inst *> users_;
+    std::array<Inst *, 2> control_users_ {};
+    Use *first_use_ = nullptr;
+    Use *last_use_ = nullptr;
+    uint32_t num_uses_ = 0;
 };
 
 template <uint32_t N>
 class FixedInputs: public Inst
 {
 public:
+    static constexpr uint32_t NUM_INPUTS = N;
+
     FixedInputs():
-        inputs_() {};
+        inputs_() {
+        InitUses();
+    };
 
     FixedInputs(Opcode opc):
         Inst(opc),
-        inputs_() {};
+        inputs_() {
+        InitUses();
+    };
 
     FixedInputs(Opcode opc, Type type):
         Inst(opc, type),
-        inputs_() {};
+        inputs_() {
+        InitUses();
+    };
 
+    // Inputs are set without users, as it was before
     FixedInputs(Opcode opc, Type type, std::array<Inst *, N> inputs) :
             Inst(opc, type),
             inputs_(inputs) {
         ASSERT(inputs.size() == N);
+        InitUses();
         for (size_t i = 0; i < N; i++) {
             inputs_.at(i) = inputs.at(i);
         }
     };
 
-    virtual uint32_t NumAllInputs() override {
-        return inputs_.size();
-    }
-
     virtual void DeleteInput(Inst *inst) override {
-        auto it = std::find(inputs_.begin(), inputs_.end(), inst);
-        ASSERT(it != inputs_.end());
-        *it = nullptr;
+        [[maybe_unused]] bool found = false;
+        for (id_t i = 0; i < N; i++) {
+            if (inputs_[i] != inst) {
+                continue;
+            }
+            if (uses_[i].IsLinked()) {
+                inst->RemoveUse(&uses_[i]);
+            }
+            inputs_[i] = nullptr;
+            found = true;
+        }
+        ASSERT(found);
     }
 
     virtual void DumpInputs(std::ostream &out) override {
@@ -297,78 +543,96 @@ public:
         }
     }
 
-    const std::array<Inst *, N> GetDataInputs() {
-        if (HasControlProp()) {
-            return std::array<Inst *, N>(++inputs_.begin(), inputs_.end());
-        }
-        return inputs_;
-    }
-
-    virtual Inst *GetRawInput(id_t index) override {
-        return inputs_.at(index);
-    }
-
-    virtual void SetRawInput(id_t index, Inst *inst) override {
-        ASSERT(index < N);
-        inputs_.at(index) = inst;
-    }
-
 private:
-    const std::array<Inst *, N> &GetAllInputs() {
-        return inputs_;
+    void InitUses() {
+        for (id_t i = 0; i < N; i++) {
+            uses_[i].Init(this, i);
+        }
+        SetInputsStorage(inputs_.data(), uses_.data(), N);
     }
 
 private:
     std::array<Inst *, N> inputs_;
+    std::array<Use, N> uses_;
 };
 
+/*
+ * Inputs are stored contiguously: first INLINE_CAPACITY of them inside of the instruction,
+ * bigger storage is taken from arena of the graph (old one isn't freed, arena does it).
+ */
 class DynamicInputs: public Inst
 {
 public:
+    static constexpr uint32_t INLINE_CAPACITY = 4;
+    static constexpr uint32_t NUM_INPUTS = DYNAMIC_INPUTS;
+
     DynamicInputs():
-        Inst(),
-        inputs_() {};
+        Inst() {
+        InitInlineStorage();
+    };
 
     DynamicInputs(Opcode opc):
-        Inst(opc),
-        inputs_() {};
+        Inst(opc) {
+        InitInlineStorage();
+    };
+
+    DynamicInputs(const DynamicInputs &) = delete;
+    DynamicInputs &operator=(const DynamicInputs &) = delete;
 
-    DynamicInputs(Opcode opc, const std::list<Inst *>& inputs):
-            Inst(opc),
-            inputs_(inputs) {};
+    // Graph sets it during creation of instruction
+    void SetAllocator(ArenaAllocator *allocator) {
+        allocator_ = allocator;
+    }
 
     void AddInput(Inst *inst) {
-        inputs_.push_back(inst);
+        if (num_inputs_ == capacity_) {
+            Grow();
+        }
+        inputs_data_[num_inputs_] = inst;
+        uses_data_[num_inputs_] = Use();
+        uses_data_[num_inputs_].Init(this, num_inputs_);
+        num_inputs_++;
     }
 
     virtual void DeleteInput(Inst *inst) override;
 
-    virtual uint32_t NumAllInputs() override {
-        return inputs_.size();
-    }
+    // Following inputs are shifted, e.g. input of Phi is removed with predecessor of region
+    void DeleteInputAt(id_t index);
 
     virtual void DumpInputs(std::ostream &out) override;
 
-    const std::list<Inst *> GetDataInputs() {
-        if (HasControlProp()) {
-            return std::list<Inst *>(++inputs_.begin(), inputs_.end());
-        }
-        return inputs_;
-    }
-
-    virtual void SetRawInput(id_t index, Inst *inst) override;
-    virtual Inst *GetRawInput(id_t index) override;
-
 private:
-    const std::list<Inst *>& GetAllInputs() {
-        return inputs_;
+    void InitInlineStorage() {
+        SetInputsStorage(inline_inputs_.data(), inline_uses_.data(), 0);
     }
 
+    void Grow();
+    // Move use record to new place, list of users of the input is updated
+    void MoveUse(id_t from, Use *to, id_t new_index);
+
 private:
-    std::list<Inst *> inputs_;
+    ArenaAllocator *allocator_ = nullptr;
+    // Use records are linked in users of inputs, so they are relinked after every move
+    uint32_t capacity_ = INLINE_CAPACITY;
+    std::array<Inst *, INLINE_CAPACITY> inline_inputs_ {};
+    std::array<Use, INLINE_CAPACITY> inline_uses_ {};
 };
 
 using ImmType = int64_t;
+
+// The only form of value of "type" in ImmType, so equal values have equal immediates
+inline ImmType NormalizeImm(Type type, ImmType value) {
+    switch (type) {
+        case Type::BOOL:
+            return value != 0 ? 1 : 0;
+        case Type::INT32:
+        case Type::UINT32:
+            return static_cast<int32_t>(value);
+        default:
+            return value;
+    }
+}
+
 class ImmidiateProperty
 {
 public:
@@ -399,18 +663,6 @@ public:
 
 };
 
-// Maybe better create bit flag and don't use virtual call
-template <typename T>
-class ControlProp : public T
-{
-public:
-    using T::T;
-
-    bool HasControlProp() override {
-        return true;
-    }
-};
-
 class UnaryOperation : public FixedInputs<1>
 {
 public:
@@ -450,22 +702,25 @@ public:
         Inst(Opcode::Constant, Type::INT64),
         ImmidiateProperty(value) {}
 
-    virtual Inst *LiteClone(Graph *target_graph, std::map<id_t, id_t> &connect) override;
+    // Value of 32-bit type (signed or not) is extended to ImmType by its sign, BOOL is 0 or 1
+    ConstantInst(Type type, ImmType value):
+        Inst(Opcode::Constant, type),
+        ImmidiateProperty(NormalizeImm(type, value)) {}
+
+    virtual Inst *LiteClone(Graph *target_graph, InstMap<id_t> &connect) override;
 
     virtual void DumpInputs(std::ostream &out) override {
         out << std::string("0x") << std::hex << GetImm() << std::dec;
     }
 };
 
-class RegionInst : public ControlProp<DynamicInputs>
+class RegionInst : public DynamicInputs
 {
 public:
-    using Base = ControlProp<DynamicInputs>;
+    using Base = DynamicInputs;
     RegionInst():
         Base(Opcode::Region) {}
 
-    virtual ~RegionInst() override;
-
     Inst *GetRegionInput(uint32_t index) {
         return GetRawInput(index);
     }
@@ -495,14 +750,40 @@ public:
         static_cast<RegionInst *>(inst)->SetDominator(this);
     }
 
+    // Immediately dominated regions
     std::vector<Inst *> &GetDominated() {
         return dominated_;
     }
 
+    void ClearDominators() {
+        dominator_ = nullptr;
+        dominated_.clear();
+        dom_pre_ = 0;
+        dom_post_ = 0;
+    }
+
+    // Numbers of region in pre- and post-order of DFS over dominator tree
+    void SetDomNumbers(uint32_t pre, uint32_t post) {
+        ASSERT(pre != 0 && post != 0);
+        dom_pre_ = pre;
+        dom_post_ = post;
+    }
+
+    uint32_t GetDomPreNumber() const {
+        return dom_pre_;
+    }
+
+    uint32_t GetDomPostNumber() const {
+        return dom_post_;
+    }
+
+    // Strict dominance: "region" is dominated by this region.
+    // Subtree of dominator tree takes continuous interval of DFS numbers
     bool IsDominated(Inst *region) {
         ASSERT(region->IsRegion());
-        auto res = std::find(dominated_.begin(), dominated_.end(), region);
-        return res != dominated_.end();
+        auto other = static_cast<RegionInst *>(region);
+        ASSERT(dom_pre_ != 0 && other->dom_pre_ != 0);
+        return this != other && dom_pre_ <= other->dom_pre_ && other->dom_post_ <= dom_post_;
     }
 
     Loop *GetLoop() {
@@ -547,6 +828,9 @@ private:
     Loop *loop_ {nullptr};
 
     Inst *dominator_ = nullptr;
+    // Zero if region isn't in dominator tree
+    uint32_t dom_pre_ = 0;
+    uint32_t dom_post_ = 0;
     // List off insts when they is placed after GCM
     // It allow to reuse already created variable
     Inst *&first_ = next_;
@@ -576,38 +860,33 @@ public:
 };
 
 
-class IfInst : public ControlProp<FixedInputs<2>>
+class IfInst : public FixedInputs<2>
 {
 public:
-    using Base = ControlProp<FixedInputs<2>>;
+    using Base = FixedInputs<2>;
     // First input is Region
     // Second input is Bool condition value
+    // True branch is user0, false branch is user1
     IfInst():
-        Base(Opcode::If)
-    {
-        // True branch (user0)
-        GetRawUsers().push_back(nullptr);
-        // False branch (user1)
-        GetRawUsers().push_back(nullptr);
-    }
+        Base(Opcode::If) {}
 
     RegionInst *GetTrueBranch() {
-        return (*(GetRawUsers().begin()))->CastToRegion();
+        return GetControlUsers()[0]->CastToRegion();
     }
 
     RegionInst *GetFalseBranch() {
-        return (*(++GetRawUsers().begin()))->CastToRegion();
+        return GetControlUsers()[1]->CastToRegion();
     }
 
     void SetTrueBranch(Inst *inst) {
         ASSERT(inst->GetOpcode() == Opcode::Region);
-        *(GetRawUsers().begin()) = inst;
+        GetControlUsers()[0] = inst;
         static_cast<RegionInst *>(inst)->SetRegionInput(inst->NumAllInputs(), this);
     }
 
     void SetFalseBranch(Inst *inst) {
         ASSERT(inst->GetOpcode() == Opcode::Region);
-        *(++GetRawUsers().begin()) = inst;
+        GetControlUsers()[1] = inst;
         static_cast<RegionInst *>(inst)->SetRegionInput(inst->NumAllInputs(), this);
     }
     // We can't copy a Jump, because can be jump on inst, whitch still haven't create
@@ -615,10 +894,10 @@ public:
     virtual void DumpUsers(std::ostream &out) override;
 };
 
-class JumpInst : public ControlProp<FixedInputs<1>>
+class JumpInst : public FixedInputs<1>
 {
 public:
-    using Base = ControlProp<FixedInputs<1>>;
+    using Base = FixedInputs<1>;
     JumpInst():
         Base(Opcode::Jump) {}
 
@@ -650,26 +929,26 @@ public:
     }
 
     virtual void DumpOpcode(std::ostream& out) override;
-    virtual Inst *LiteClone(Graph *target_graph,  std::map<id_t, id_t> &connect) override;
+    virtual Inst *LiteClone(Graph *target_graph, InstMap<id_t> &connect) override;
 
 private:
     ConditionCode cc_;
 };
 
-class PhiInst : public ControlProp<DynamicInputs>
+class PhiInst : public DynamicInputs
 {
 public:
-    using Base = ControlProp<DynamicInputs>;
+    using Base = DynamicInputs;
     PhiInst():
         Base(Opcode::Phi) {};
 
     virtual void DumpInputs(std::ostream &out) override;
 };
 
-class ReturnInst : public ControlProp<FixedInputs<2>>
+class ReturnInst : public FixedInputs<2>
 {
 public:
-    using Base = ControlProp<FixedInputs<2>>;
+    using Base = FixedInputs<2>;
     ReturnInst():
         Base(Opcode::Return) {};
 };
@@ -690,16 +969,16 @@ public:
 
     virtual void DumpInputs(std::ostream &out) override;
 
-    virtual Inst *LiteClone(Graph *target_graph,  std::map<id_t, id_t> &connect) override;
+    virtual Inst *LiteClone(Graph *target_graph, InstMap<id_t> &connect) override;
 
 private:
     id_t idx_param_;
 };
 
-class CallInst : public ControlProp<DynamicInputs>
+class CallInst : public DynamicInputs
 {
 public:
-    using Base = ControlProp<DynamicInputs>;
+    using Base = DynamicInputs;
     CallInst():
         Base(Opcode::Call),
         name_func_() {};
@@ -707,26 +986,26 @@ public:
     void SetNameFunc(const std::string &name);
     std::string GetNameFunc() const;
 
-    virtual Inst *LiteClone(Graph *target_graph,  std::map<id_t, id_t> &connect) override;
+    virtual Inst *LiteClone(Graph *target_graph, InstMap<id_t> &connect) override;
     virtual void DumpInputs(std::ostream &out) override;
 
 private:
     std::string name_func_;
 };
 
-class NullCheckInst : public ControlProp<FixedInputs<2>>
+class NullCheckInst : public FixedInputs<2>
 {
 public:
-    using Base = ControlProp<FixedInputs<2>>;
+    using Base = FixedInputs<2>;
     NullCheckInst():
         Base(Opcode::NullCheck) {};
     // Need to add check type of input
 };
 
-class BoundsCheckInst : public ControlProp<FixedInputs<3>>
+class BoundsCheckInst : public FixedInputs<3>
 {
 public:
-    using Base = ControlProp<FixedInputs<3>>;
+    using Base = FixedInputs<3>;
     BoundsCheckInst():
         Base(Opcode::BoundsCheck) {};
     // Need to add check type of input
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "inst.h"
+
+namespace compiler {
+
+/*
+ * Side table with value for every instruction of graph. Ids of instructions are dense,
+ * so value is found by index instead of search in tree like in std::map.
+ * Usually size is graph->GetNumInsts(), instructions created later need Resize.
+ */
+template <typename T>
+class InstMap
+{
+public:
+    InstMap() = default;
+
+    explicit InstMap(size_t size, const T &value = T()):
+        values_(size, value) {}
+
+    T &operator[](id_t id) {
+        ASSERT(id < values_.size());
+        return values_[id];
+    }
+
+    const T &operator[](id_t id) const {
+        ASSERT(id < values_.size());
+        return values_[id];
+    }
+
+    T &operator[](const Inst *inst) {
+        return (*this)[inst->GetId()];
+    }
+
+    const T &operator[](const Inst *inst) const {
+        return (*this)[inst->GetId()];
+    }
+
+    // New instructions get "value"
+    void Resize(size_t size, const T &value = T()) {
+        values_.resize(size, value);
+    }
+
+    size_t size() const {
+        return values_.size();
+    }
+
+private:
+    std::vector<T> values_;
+};
+
+}
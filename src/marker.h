@@ -2,52 +2,93 @@
 
 #include "inst.h"
 #include "graph.h"
+#include "utils/bit_vector.h"
 
 namespace compiler {
 
+/*
+ * Marker takes free slot in instructions and unique stamp: instruction is marked,
+ * if its slot holds the stamp. So creation and Clear are O(1) and don't allocate,
+ * marks of previous owners of the slot are just outdated.
+ * If all slots are busy, marks are kept in dense bitset.
+ */
 class Marker
 {
 public:
     Marker(Graph *graph):
-        array_(new bool [graph->GetNumInsts()]),
-        num_insts_(graph->GetNumInsts())
+        graph_(graph)
     {
-        Clear();
+        if (graph_->AcquireMarkerSlot(&slot_)) {
+            stamp_ = graph_->NewMarkerStamp();
+        } else {
+            slot_ = NO_SLOT;
+            bits_.Resize(graph_->GetNumInsts());
+        }
     }
 
     ~Marker() {
-        delete [] array_;
+        if (slot_ != NO_SLOT) {
+            graph_->ReleaseMarkerSlot(slot_);
+        }
     }
 
+    Marker(const Marker &) = delete;
+    Marker &operator=(const Marker &) = delete;
+
     void SetMarker(Inst *inst, bool value=true) {
         ASSERT(inst != nullptr);
-        array_[inst->GetId()] = value;
+        if (slot_ != NO_SLOT) {
+            inst->SetMarkerStamp(slot_, value ? stamp_ : 0);
+            return;
+        }
+        // Inst could be created after the marker
+        if (inst->GetId() >= bits_.size()) {
+            bits_.Resize(graph_->GetNumInsts());
+        }
+        if (value) {
+            bits_.SetBit(inst->GetId());
+        } else {
+            bits_.ClearBit(inst->GetId());
+        }
     }
 
     bool IsMarked(Inst *inst) {
         ASSERT(inst != nullptr);
-        return array_[inst->GetId()];
+        if (slot_ != NO_SLOT) {
+            return inst->GetMarkerStamp(slot_) == stamp_;
+        }
+        return inst->GetId() < bits_.size() && bits_.GetBit(inst->GetId());
     }
 
+    // Returns previous state of mark
     bool TrySetMarker(Inst *inst) {
-        ASSERT(inst != nullptr);
-        if (array_[inst->GetId()]) {
+        if (IsMarked(inst)) {
             return true;
         }
-        array_[inst->GetId()] = true;
+        SetMarker(inst);
         return false;
     }
 
     void Clear() {
-        for (size_t i = 0; i < num_insts_; i++) {
-            array_[i] = 0;
+        if (slot_ != NO_SLOT) {
+            stamp_ = graph_->NewMarkerStamp();
+            return;
         }
+        bits_.Reset();
+    }
+
+    bool UsesBitset() const {
+        return slot_ == NO_SLOT;
     }
 
 private:
-    // TODO: Change to bitset
-    bool *array_;
-    uint32_t num_insts_;
+    static constexpr uint32_t NO_SLOT = NUM_MARKER_SLOTS;
+
+    Graph *graph_;
+    uint32_t slot_ = NO_SLOT;
+    MarkerStamp stamp_ = 0;
+    // Fallback, if there is no free slot
+    BitVector bits_;
 };
 
 }
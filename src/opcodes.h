@@ -2,35 +2,62 @@
 
 #include <array>
 #include <cinttypes>
+#include <cstdint>
 
 namespace compiler {
 
 //===================================================================
 
-#define INST_OPCODE_LIST(ACTION)                          \
-    ACTION( Add         , BinaryOperation               ) \
-    ACTION( Sub         , BinaryOperation               ) \
-    ACTION( Mul         , BinaryOperation               ) \
-    ACTION( Div         , BinaryOperation               ) \
-    ACTION( Shl         , BinaryOperation               ) \
-    ACTION( Shr         , BinaryOperation               ) \
-    ACTION( And         , BinaryOperation               ) \
-    ACTION( Or          , BinaryOperation               ) \
-    ACTION( Constant    , ConstantInst                  ) \
-    ACTION( If          , IfInst                        ) \
-    ACTION( Jump        , JumpInst                      ) \
-    ACTION( Compare     , CompareInst                   ) \
-    ACTION( Phi         , PhiInst                       ) \
-    ACTION( Return      , ReturnInst                    ) \
-    ACTION( Parameter   , ParameterInst                 ) \
-    ACTION( NullCheck   , NullCheckInst                 ) \
-    ACTION( BoundsCheck , BoundsCheckInst               ) \
-    ACTION( Call        , CallInst                      )
-
-#define REGIONS_OPCODE_LIST(ACTION)                       \
-    ACTION( Region      , RegionInst                    ) \
-    ACTION( Start       , StartInst                     ) \
-    ACTION( End         , EndInst                       )
+// Properties of opcodes, every instruction has combination of them
+enum OpcodeFlag : uint32_t {
+    NO_FLAGS     = 0U,
+    // Instruction is a part of control chain: input 0 is control input
+    CONTROL_PROP = 1U << 0U,
+    // Order of two data inputs doesn't matter
+    COMMUTATIVE  = 1U << 1U,
+    // Result depends only on inputs and there are no side effects,
+    // so equal instructions can be merged and moved freely
+    PURE         = 1U << 2U,
+    // Last instruction of region, which transfers control to other regions
+    TERMINATOR   = 1U << 3U,
+    REGION       = 1U << 4U,
+    // Value is computed without inputs, so register allocator computes it again
+    // before use instead of storing on stack
+    REMATERIALIZABLE = 1U << 5U,
+    // Instruction may trap for some inputs (e.g. division by zero), so it isn't computed
+    // on paths, where it wasn't computed before: it isn't merged with equal one and
+    // isn't hoisted above LCA of its users
+    CAN_TRAP     = 1U << 6U,
+};
+
+// Number of inputs of instructions with inputs in DynamicInputs
+constexpr uint32_t DYNAMIC_INPUTS = UINT32_MAX;
+
+// Inputs are counted together with control input
+#define INST_OPCODE_LIST(ACTION)                                                                        \
+    ACTION( Add         , BinaryOperation   , 2              , PURE | COMMUTATIVE                    ) \
+    ACTION( Sub         , BinaryOperation   , 2              , PURE                                  ) \
+    ACTION( Mul         , BinaryOperation   , 2              , PURE | COMMUTATIVE                    ) \
+    ACTION( Div         , BinaryOperation   , 2              , PURE | CAN_TRAP                       ) \
+    ACTION( Shl         , BinaryOperation   , 2              , PURE                                  ) \
+    ACTION( Shr         , BinaryOperation   , 2              , PURE                                  ) \
+    ACTION( And         , BinaryOperation   , 2              , PURE | COMMUTATIVE                    ) \
+    ACTION( Or          , BinaryOperation   , 2              , PURE | COMMUTATIVE                    ) \
+    ACTION( Constant    , ConstantInst      , 0              , PURE | REMATERIALIZABLE               ) \
+    ACTION( If          , IfInst            , 2              , CONTROL_PROP | TERMINATOR             ) \
+    ACTION( Jump        , JumpInst          , 1              , CONTROL_PROP | TERMINATOR             ) \
+    ACTION( Compare     , CompareInst       , 2              , PURE                                  ) \
+    ACTION( Phi         , PhiInst           , DYNAMIC_INPUTS , CONTROL_PROP                          ) \
+    ACTION( Return      , ReturnInst        , 2              , CONTROL_PROP                          ) \
+    ACTION( Parameter   , ParameterInst     , 0              , NO_FLAGS                              ) \
+    ACTION( NullCheck   , NullCheckInst     , 2              , CONTROL_PROP                          ) \
+    ACTION( BoundsCheck , BoundsCheckInst   , 3              , CONTROL_PROP                          ) \
+    ACTION( Call        , CallInst          , DYNAMIC_INPUTS , CONTROL_PROP                          )
+
+#define REGIONS_OPCODE_LIST(ACTION)                                                                     \
+    ACTION( Region      , RegionInst        , DYNAMIC_INPUTS , CONTROL_PROP | REGION                 ) \
+    ACTION( Start       , StartInst         , DYNAMIC_INPUTS , CONTROL_PROP | REGION                 ) \
+    ACTION( End         , EndInst           , DYNAMIC_INPUTS , CONTROL_PROP | REGION                 )
 
 
 #define ALL_OPCODE_LIST(ACTION) \
@@ -61,6 +88,30 @@ constexpr std::array<const char *const, static_cast<size_t>(Opcode::NUM_OPCODES)
 #undef CREATE_NAMES
 };
 
+struct OpcodeProps {
+    uint32_t num_inputs;
+    uint32_t flags;
+};
+
+constexpr std::array<OpcodeProps, static_cast<size_t>(Opcode::NUM_OPCODES)> OPCODE_PROPS {{
+    {0, NO_FLAGS},
+
+#define CREATE_PROPS(OPCODE, BASE, NUM_INPUTS, FLAGS) \
+    {NUM_INPUTS, FLAGS},
+
+    ALL_OPCODE_LIST(CREATE_PROPS)
+
+#undef CREATE_PROPS
+}};
+
+constexpr const OpcodeProps &GetOpcodeProps(Opcode opc) {
+    return OPCODE_PROPS[static_cast<size_t>(opc)];
+}
+
+constexpr bool HasOpcodeFlag(Opcode opc, OpcodeFlag flag) {
+    return (GetOpcodeProps(opc).flags & flag) != 0;
+}
+
 //===================================================================
 
 #define CC_LIST(ACTION) \
@@ -21,5 +21,12 @@ RegionInst *GetRegionByInputRegion(Inst *inst) {
     return static_cast<RegionInst *>(inst);
 }
 
+RegionInst *GetRegionOfPredecessor(Inst *inst) {
+    if (inst->IsRegion()) {
+        return inst->CastToRegion();
+    }
+    return GetRegionByInputRegion(inst);
+}
+
 
 }
@@ -7,6 +7,8 @@ class RegionInst;
 
 Inst *SkipBodyOfRegion(Inst *inst);
 RegionInst *GetRegionByInputRegion(Inst *inst);
+// Region, which ends with "inst" from inputs of other region
+RegionInst *GetRegionOfPredecessor(Inst *inst);
 
 
 }
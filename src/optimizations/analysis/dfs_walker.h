@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+
+#include "inst.h"
+#include "analysis.h"
+
+namespace compiler {
+
+/*
+ * Kinds of edges for DfsWalker. Edges of node are Get(node), node on the other side of edge
+ * is Resolve(edge). REVERSE means walking edges from the last one.
+ */
+// Successors of region in control flow: true branch before false branch
+struct RegionSuccessors {
+    static constexpr bool REVERSE = false;
+
+    static Span<Inst *> Get(Inst *region) {
+        auto last = SkipBodyOfRegion(region);
+        return last->IsTerminator() ? last->GetControlUsers() : Span<Inst *>();
+    }
+
+    static Inst *Resolve(Inst *inst) {
+        return inst;
+    }
+};
+
+// Predecessors of region in control flow
+struct RegionPredecessors {
+    static constexpr bool REVERSE = false;
+
+    static Span<Inst *> Get(Inst *region) {
+        return region->GetAllInputs();
+    }
+
+    static Inst *Resolve(Inst *inst) {
+        return GetRegionOfPredecessor(inst);
+    }
+};
+
+// Control and data inputs of instruction
+struct InputEdges {
+    static constexpr bool REVERSE = false;
+
+    static Span<Inst *> Get(Inst *inst) {
+        return inst->GetAllInputs();
+    }
+
+    static Inst *Resolve(Inst *inst) {
+        return inst;
+    }
+};
+
+struct DataInputEdges {
+    static constexpr bool REVERSE = false;
+
+    static Span<Inst *> Get(Inst *inst) {
+        return inst->GetDataInputs();
+    }
+
+    static Inst *Resolve(Inst *inst) {
+        return inst;
+    }
+};
+
+/*
+ * Depth-first search with explicit stack, so depth of graph isn't limited by stack of thread.
+ * Callbacks are called in the same order as in recursive DFS:
+ *   enter(node, from) - node is reached by edge from "from" (nullptr for root),
+ *                       false means, that edges of node aren't walked
+ *   leave(node)       - all edges of node are walked, is called only if enter returned true
+ * Nodes aren't marked by walker, "enter" decides to visit node again or not.
+ * Stack is kept between walks, so walker can be reused without allocations.
+ * Edges of graph must not be changed during walk.
+ */
+template <typename Edges>
+class DfsWalker
+{
+public:
+    template <typename EnterFn, typename LeaveFn>
+    void Walk(Inst *root, EnterFn &&enter, LeaveFn &&leave) {
+        ASSERT(stack_.empty());
+        if (!enter(root, nullptr)) {
+            return;
+        }
+        stack_.push_back({root, Edges::Get(root), 0});
+        while (!stack_.empty()) {
+            auto &frame = stack_.back();
+            if (frame.next == frame.edges.size()) {
+                auto node = frame.node;
+                stack_.pop_back();
+                leave(node);
+                continue;
+            }
+            auto index = Edges::REVERSE ? frame.edges.size() - 1 - frame.next : frame.next;
+            frame.next++;
+            auto from = frame.node;
+            auto node = Edges::Resolve(frame.edges[index]);
+            // "frame" can be invalidated here
+            if (enter(node, from)) {
+                stack_.push_back({node, Edges::Get(node), 0});
+            }
+        }
+    }
+
+    template <typename EnterFn>
+    void Walk(Inst *root, EnterFn &&enter) {
+        Walk(root, std::forward<EnterFn>(enter), [](Inst *) {});
+    }
+
+private:
+    struct Frame {
+        Inst *node;
+        Span<Inst *> edges;
+        size_t next;
+    };
+
+    std::vector<Frame> stack_;
+};
+
+}
@@ -3,50 +3,94 @@
 
 namespace compiler {
 
-void DomTreeSlow::DFSRegions(Inst *region, std::vector<Inst *> &found, Marker &marker) {
-    if (marker.IsMarked(region)) {
-        return;
+void DomTree::Run() {
+    auto &rpo_regions = graph_->GetPassManager()->GetAnalysis<RpoRegions>().GetVector();
+
+    rpo_number_.assign(graph_->GetNumInsts(), NOT_VISITED);
+    for (uint32_t i = 0; i < rpo_regions.size(); i++) {
+        rpo_number_[rpo_regions[i]->GetId()] = i;
+        rpo_regions[i]->ClearDominators();
+    }
+
+    // Start region is temporarily dominated by itself, it stops intersections
+    auto start_region = rpo_regions.front();
+    idom_.assign(rpo_regions.size(), NOT_VISITED);
+    idom_[0] = 0;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 1; i < rpo_regions.size(); i++) {
+            auto region = rpo_regions[i];
+            auto new_idom = NOT_VISITED;
+            for (id_t j = 0; j < region->NumRegionInputs(); j++) {
+                auto pred = rpo_number_[GetRegionOfPredecessor(region->GetRegionInput(j))->GetId()];
+                // Unreachable or still unprocessed predecessor
+                if (pred == NOT_VISITED || idom_[pred] == NOT_VISITED) {
+                    continue;
+                }
+                new_idom = new_idom == NOT_VISITED ? pred : Intersect(pred, new_idom);
+            }
+            ASSERT(new_idom != NOT_VISITED);
+            if (idom_[i] != new_idom) {
+                idom_[i] = new_idom;
+                changed = true;
+            }
+        }
     }
-    marker.SetMarker(region);
-    found.push_back(region);
 
-    auto branch = SkipBodyOfRegion(region);
-    for (auto way : branch->GetRawUsers()) {
-        DFSRegions(way, found, marker);
+    for (uint32_t i = 1; i < rpo_regions.size(); i++) {
+        rpo_regions[idom_[i]]->AddDominated(rpo_regions[i]);
+    }
+
+    NumberTree(start_region);
+    for (auto region : rpo_regions) {
+        NumberControlChain(region);
     }
 }
 
-void DomTreeSlow::Run() {
-    std::vector<Inst *> full_dfs;
-    Marker marker(graph_);
-    // TODO: Add "GetStartRegion", "GetEndRegion"
-    DFSRegions(graph_->GetInstByIndex(0), full_dfs, marker);
-    std::sort(full_dfs.begin(), full_dfs.end());
-
-    std::vector<Inst *> part_dfs;
-    std::vector<Inst *> diff;
-    auto rpo = RpoRegions(graph_);
-    rpo.Run();
-
-    for (auto investigated : rpo.GetVector()) {
-        diff.clear();
-        part_dfs.clear();
-        marker.Clear();
-        marker.SetMarker(investigated);
-
-        DFSRegions(graph_->GetInstByIndex(0), part_dfs, marker);
-        std::sort(part_dfs.begin(), part_dfs.end());
-
-        std::set_difference(full_dfs.begin(), full_dfs.end(), part_dfs.begin(), part_dfs.end(),
-            std::inserter(diff, diff.begin()));
-
-        for (auto it : diff) {
-            if (it == investigated) {
-                continue;
-            }
-            static_cast<RegionInst *>(investigated)->AddDominated(it);
+void DomTree::NumberTree(RegionInst *root) {
+    // Pairs of region and index of next dominated region to visit
+    std::vector<std::pair<RegionInst *, size_t>> stack;
+    uint32_t pre = 1;
+    uint32_t post = 1;
+    // Pre-number is saved now, post-number is set after visit of subtree
+    root->SetDomNumbers(pre++, UINT32_MAX);
+    stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+        auto &[region, next] = stack.back();
+        auto &dominated = region->GetDominated();
+        if (next == dominated.size()) {
+            region->SetDomNumbers(region->GetDomPreNumber(), post++);
+            stack.pop_back();
+            continue;
+        }
+        auto child = dominated[next++]->CastToRegion();
+        child->SetDomNumbers(pre++, UINT32_MAX);
+        stack.emplace_back(child, 0);
+    }
+}
+
+void DomTree::NumberControlChain(RegionInst *region) {
+    uint32_t ordinal = 0;
+    for (Inst *inst = region; inst != nullptr; inst = inst->GetControlUser()) {
+        inst->SetControlOrder(region, ordinal++);
+        if (inst->IsTerminator()) {
+            break;
+        }
+    }
+}
+
+uint32_t DomTree::Intersect(uint32_t first, uint32_t second) {
+    while (first != second) {
+        while (first > second) {
+            first = idom_[first];
+        }
+        while (second > first) {
+            second = idom_[second];
         }
     }
+    return first;
 }
 
 }
@@ -1,21 +1,38 @@
 #pragma once
 
 #include "graph.h"
-#include "marker.h"
 #include "analysis.h"
 
 namespace compiler {
 
-class DomTreeSlow
+/*
+ * Dominator tree by Cooper, Harvey, Kennedy "A Simple, Fast Dominance Algorithm".
+ * Immediate dominators are found by iterations over RPO of regions,
+ * every region gets only immediately dominated regions in order of RPO.
+ */
+class DomTree
 {
 public:
-    DomTreeSlow(Graph *graph):
+    DomTree(Graph *graph):
         graph_(graph) {};
     void Run();
 
 private:
-    void DFSRegions(Inst *region, std::vector<Inst *> &found, Marker &marker);
+    // Arguments and result are numbers in RPO
+    uint32_t Intersect(uint32_t first, uint32_t second);
+    // Pre- and post-order numbers for O(1) check of dominance between regions
+    void NumberTree(RegionInst *root);
+    // Ordinals of instructions for O(1) check of order inside of region
+    void NumberControlChain(RegionInst *region);
+
+private:
+    static constexpr uint32_t NOT_VISITED = UINT32_MAX;
+
     Graph *graph_;
+    // Number of region in RPO, indexed by id of region
+    std::vector<uint32_t> rpo_number_;
+    // Immediate dominator of region, indexed and valued by numbers in RPO
+    std::vector<uint32_t> idom_;
 };
 
 }
@@ -2,57 +2,70 @@
 #include "rpo.h"
 #include "analysis.h"
 #include "loop_analysis.h"
+#include "dfs_walker.h"
 
 namespace compiler {
 
+// Successors by last placed instruction of region, false branch is the first
+struct PlacedRegionSuccessors {
+    // TODO Change condition in IfInst, if false is jump back (region is already visited)
+    static constexpr bool REVERSE = true;
+
+    static Span<Inst *> Get(Inst *region) {
+        if (region->GetOpcode() == Opcode::End) {
+            return Span<Inst *>();
+        }
+        auto last_inst = region->CastToRegion()->GetLast();
+        ASSERT(last_inst->GetOpcode() == Opcode::Jump || last_inst->GetOpcode() == Opcode::If);
+        return last_inst->GetControlUsers();
+    }
+
+    static Inst *Resolve(Inst *inst) {
+        return inst;
+    }
+};
+
 void LinearOrder::Run() {
     if (!graph_->IsInstsPlaced()) {
         UNREACHABLE();
     }
 
-    LoopAnalysis(graph_).Run();
-    RecursiveOrder(graph_->GetStartRegion());
+    graph_->GetPassManager()->GetAnalysis<LoopAnalysis>();
+    Marker marker(graph_);
+    marker_ = &marker;
+    BuildOrder(graph_->GetStartRegion());
+    marker_ = nullptr;
 }
 
 std::vector<RegionInst *> &LinearOrder::GetVector() {
     return linear_order_;
 }
 
-void LinearOrder::RecursiveOrder(RegionInst *region) {
-    if (marker_.IsMarked(region)) {
-        return;
-    }
-    // If Region is loop header
-    if (region->IsLoopHeader() && !region->GetLoop()->IsIrreducible()) {
-        // Two case in this if:
-        // 1. If loop is reduceble, check preheaders is visited
-        // 2. If loop is irreduceble, don't check something
-        if (!region->GetLoop()->IsIrreducible() && !AllPreheadersIsVisited(region)) {
-            return;
+void LinearOrder::BuildOrder(RegionInst *start) {
+    auto enter = [this](Inst *inst, Inst *) {
+        auto region = inst->CastToRegion();
+        if (marker_->IsMarked(region)) {
+            return false;
         }
-    } else {
-        if (!AllPrevIsVisited(region)) {
-            return;
+        // If Region is loop header
+        if (region->IsLoopHeader() && !region->GetLoop()->IsIrreducible()) {
+            // Two case in this if:
+            // 1. If loop is reduceble, check preheaders is visited
+            // 2. If loop is irreduceble, don't check something
+            if (!region->GetLoop()->IsIrreducible() && !AllPreheadersIsVisited(region)) {
+                return false;
+            }
+        } else {
+            if (!AllPrevIsVisited(region)) {
+                return false;
+            }
         }
-    }
-
-    linear_order_.push_back(region);
-    marker_.SetMarker(region);
 
-    if (region->GetOpcode() == Opcode::End) {
-        return;
-    }
-
-    auto last_inst = region->GetLast();
-    if (last_inst->GetOpcode() == Opcode::Jump) {
-        RecursiveOrder(last_inst->GetControlUser()->CastToRegion());
-        return;
-    }
-    ASSERT(last_inst->GetOpcode() == Opcode::If);
-    // TODO Change condition in IfInst, if false is jump back (region is already visited)
-    auto if_inst = last_inst->CastToIf();
-    RecursiveOrder(if_inst->GetFalseBranch());
-    RecursiveOrder(if_inst->GetTrueBranch());
+        linear_order_.push_back(region);
+        marker_->SetMarker(region);
+        return true;
+    };
+    DfsWalker<PlacedRegionSuccessors>().Walk(start, enter);
 }
 
 void LinearOrder::AddRegionToOrder(RegionInst *region) {
@@ -62,7 +75,7 @@ void LinearOrder::AddRegionToOrder(RegionInst *region) {
 bool LinearOrder::AllPrevIsVisited(RegionInst *region) {
     for (id_t i = 0; i < region->NumAllInputs(); i++) {
         auto prev_region = GetRegionByInputRegion(region->GetRegionInput(i));
-        if (!marker_.IsMarked(prev_region)) {
+        if (!marker_->IsMarked(prev_region)) {
             return false;
         }
     }
@@ -76,7 +89,7 @@ bool LinearOrder::AllPreheadersIsVisited(RegionInst *region) {
         if (std::find(backedges.begin(), backedges.end(), prev_region) != backedges.end()) {
             continue;
         }
-        if (!marker_.IsMarked(prev_region)) {
+        if (!marker_->IsMarked(prev_region)) {
             return false;
         }
     }
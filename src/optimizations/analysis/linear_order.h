@@ -10,22 +10,22 @@ class Graph;
 class LinearOrder {
 public:
     LinearOrder(Graph *graph):
-        graph_(graph),
-        marker_(graph) {};
+        graph_(graph) {};
 
     void Run();
 
     std::vector<RegionInst *> &GetVector();
 
 private:
-    void RecursiveOrder(RegionInst *region);
+    void BuildOrder(RegionInst *start);
     void AddRegionToOrder(RegionInst *region);
     bool AllPrevIsVisited(RegionInst *region);
     bool AllPreheadersIsVisited(RegionInst *region);
 
 private:
     Graph *graph_;
-    Marker marker_;
+    // Exists only during Run
+    Marker *marker_ = nullptr;
     std::vector<RegionInst *> linear_order_;
 };
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "liveness_analyzer.h"
 #include "linear_order.h"
 #include "graph.h"
@@ -5,22 +7,153 @@
 
 namespace compiler {
 
+/*
+ * Reverse iterators of ranges_ and use_positions_ go from the first range and use,
+ * so search is done with them.
+ */
+void LiveInterval::AddRange(LifeNumber begin, LifeNumber end) {
+    ASSERT(begin <= end);
+    if (begin == end) {
+        return;
+    }
+    // The first range, which isn't strictly before the new one
+    auto first = std::lower_bound(ranges_.rbegin(), ranges_.rend(), begin,
+        [](const LiveRange &range, LifeNumber position) { return range.GetEnd() < position; });
+    auto last = first;
+    while (last != ranges_.rend() && last->GetBegin() <= end) {
+        begin = std::min(begin, last->GetBegin());
+        end = std::max(end, last->GetEnd());
+        last++;
+    }
+    if (first == last) {
+        ranges_.insert(first.base(), LiveRange(begin, end));
+        return;
+    }
+    *first = LiveRange(begin, end);
+    // Ranges after "first" up to "last" are merged into it
+    ranges_.erase(last.base(), std::prev(first.base()));
+}
+
+void LiveInterval::TrimBegin(LifeNumber begin) {
+    if (ranges_.empty()) {
+        ranges_.emplace_back(begin, begin + 1);
+        return;
+    }
+    auto &first = ranges_.back();
+    ASSERT(begin >= first.GetBegin() && begin < first.GetEnd());
+    first = LiveRange(begin, first.GetEnd());
+}
+
+void LiveInterval::AddUsePosition(LifeNumber position) {
+    auto it = std::upper_bound(use_positions_.rbegin(), use_positions_.rend(), position);
+    use_positions_.insert(it.base(), position);
+}
+
+bool LiveInterval::Covers(LifeNumber position) const {
+    auto it = std::upper_bound(ranges_.rbegin(), ranges_.rend(), position,
+        [](LifeNumber pos, const LiveRange &range) { return pos < range.GetEnd(); });
+    return it != ranges_.rend() && it->GetBegin() <= position;
+}
+
+LifeNumber LiveInterval::NextRangeBound(LifeNumber position) const {
+    auto it = std::upper_bound(ranges_.rbegin(), ranges_.rend(), position,
+        [](LifeNumber pos, const LiveRange &range) { return pos < range.GetEnd(); });
+    if (it == ranges_.rend()) {
+        return INVALID_LIFE_NUMBER;
+    }
+    return it->GetBegin() <= position ? it->GetEnd() : it->GetBegin();
+}
+
+LifeNumber LiveInterval::FindIntersection(const LiveInterval &other) const {
+    if (IsEmpty() || other.IsEmpty()) {
+        return INVALID_LIFE_NUMBER;
+    }
+    // Ranges, which end before begin of other interval, are skipped by binary search
+    auto ends_before = [](const LiveRange &range, LifeNumber position) { return range.GetEnd() <= position; };
+    auto it = std::lower_bound(ranges_.rbegin(), ranges_.rend(), other.GetBegin(), ends_before);
+    auto other_it = std::lower_bound(other.ranges_.rbegin(), other.ranges_.rend(), GetBegin(), ends_before);
+    while (it != ranges_.rend() && other_it != other.ranges_.rend()) {
+        if (it->GetEnd() <= other_it->GetBegin()) {
+            it++;
+        } else if (other_it->GetEnd() <= it->GetBegin()) {
+            other_it++;
+        } else {
+            return std::max(it->GetBegin(), other_it->GetBegin());
+        }
+    }
+    return INVALID_LIFE_NUMBER;
+}
+
+LifeNumber LiveInterval::NextUsePosition(LifeNumber position) const {
+    auto it = std::lower_bound(use_positions_.rbegin(), use_positions_.rend(), position);
+    return it == use_positions_.rend() ? INVALID_LIFE_NUMBER : *it;
+}
+
+LifeNumber LiveInterval::PrevUsePosition(LifeNumber position) const {
+    auto it = std::lower_bound(use_positions_.rbegin(), use_positions_.rend(), position);
+    return it == use_positions_.rbegin() ? INVALID_LIFE_NUMBER : *(it - 1);
+}
+
+// Cost is proportional to size of the first part, the rest is moved to child
+LiveInterval LiveInterval::SplitAt(LifeNumber position) {
+    ASSERT(position > GetBegin() && position < GetEnd());
+    LiveInterval child;
+    child.SetLinearNumber(my_linear_number_);
+
+    // The first range, which ends after position
+    auto range = std::upper_bound(ranges_.rbegin(), ranges_.rend(), position,
+        [](LifeNumber pos, const LiveRange &r) { return pos < r.GetEnd(); });
+    auto num_head_ranges = range - ranges_.rbegin();
+    std::vector<LiveRange> head(ranges_.end() - num_head_ranges, ranges_.end());
+    ranges_.erase(ranges_.end() - num_head_ranges, ranges_.end());
+    auto &cut = ranges_.back();
+    if (cut.GetBegin() < position) {
+        head.insert(head.begin(), LiveRange(cut.GetBegin(), position));
+        cut = LiveRange(position, cut.GetEnd());
+    }
+    child.ranges_ = std::move(ranges_);
+    ranges_ = std::move(head);
+
+    auto use = std::lower_bound(use_positions_.rbegin(), use_positions_.rend(), position);
+    auto num_head_uses = use - use_positions_.rbegin();
+    std::vector<LifeNumber> head_uses(use_positions_.end() - num_head_uses, use_positions_.end());
+    use_positions_.erase(use_positions_.end() - num_head_uses, use_positions_.end());
+    child.use_positions_ = std::move(use_positions_);
+    use_positions_ = std::move(head_uses);
+    return child;
+}
+
+void LiveInterval::Dump(std::ostream &out) const {
+    for (auto it = ranges_.rbegin(); it != ranges_.rend(); it++) {
+        out << "[" << it->GetBegin() << ", " << it->GetEnd() << ") ";
+    }
+    out << "uses:";
+    for (auto it = use_positions_.rbegin(); it != use_positions_.rend(); it++) {
+        out << " " << *it;
+    }
+    out << std::endl;
+}
+
 void LivenessAnalyzer::Run() {
     ASSERT(graph_->IsInstsPlaced());
     PrepareData();
     BuildLifeNumbers();
+    BuildLoopEnds();
+    BuildBlockBounds();
     BuildIntervals();
 }
 
 void LivenessAnalyzer::PrepareData() {
-    // TODO RunPass to eluminate redundant analysis
-    auto lo = LinearOrder(graph_);
-    lo.Run();
     // Here is copying of vector
-    linear_regions_ = lo.GetVector();
+    linear_regions_ = graph_->GetPassManager()->GetAnalysis<LinearOrder>().GetVector();
 
     auto size = linear_regions_.size();
     inst_life_numbers_.reserve(size);
+    block_bounds_.clear();
+    block_bounds_.reserve(size);
+
+    region_live_ranges_ = InstMap<LiveRange>(graph_->GetNumInsts());
+    region_block_livesets_ = InstMap<RegionBlockLiveSet *>(graph_->GetNumInsts(), nullptr);
 }
 
 void LivenessAnalyzer::BuildLifeNumbers() {
@@ -33,6 +166,76 @@ void LivenessAnalyzer::BuildLifeNumbers() {
     num_linear_inst_ = linear_number;
 }
 
+/*
+ * Regions of loop can be not contiguous in linear order, so loop depth of region is
+ * number of loops, which live ranges (see GetLoopLiveRange) contain the region.
+ */
+void LivenessAnalyzer::BuildBlockBounds() {
+    for (auto region : linear_regions_) {
+        if (region->GetOpcode() != Opcode::End) {
+            block_bounds_.push_back({region->GetLifeNumber(), 0, NO_BLOCK});
+        }
+    }
+    // +1 in the first region of loop range, -1 after the last one
+    std::vector<int32_t> depth_diff(block_bounds_.size() + 1, 0);
+    auto find_bound = [this](LifeNumber position) {
+        return std::lower_bound(block_bounds_.begin(), block_bounds_.end(), position,
+            [](const BlockBound &bound, LifeNumber pos) { return bound.begin < pos; }) - block_bounds_.begin();
+    };
+    for (auto region : linear_regions_) {
+        if (region->GetOpcode() == Opcode::End || !region->IsLoopHeader()) {
+            continue;
+        }
+        auto range = GetLoopLiveRange(region);
+        depth_diff[find_bound(range.GetBegin())]++;
+        depth_diff[find_bound(range.GetEnd())]--;
+    }
+    int32_t depth = 0;
+    // Blocks, which have no shallower block after them, depth is increased from the bottom
+    std::vector<uint32_t> shallower;
+    for (uint32_t i = 0; i < block_bounds_.size(); i++) {
+        depth += depth_diff[i];
+        block_bounds_[i].loop_depth = depth;
+        while (!shallower.empty() && block_bounds_[shallower.back()].loop_depth >= block_bounds_[i].loop_depth) {
+            shallower.pop_back();
+        }
+        block_bounds_[i].prev_shallower = shallower.empty() ? NO_BLOCK : shallower.back();
+        shallower.push_back(i);
+    }
+}
+
+LiveRange LivenessAnalyzer::GetLoopLiveRange(RegionInst *header) {
+    return LiveRange(header->GetLifeNumber(), loop_ends_[header] + 2);
+}
+
+/*
+ * Regions of inner loops are in body of their own loops, so end of loop is the latest
+ * end of its body and of its inner loops. Inner loops are deeper, they are counted first.
+ */
+void LivenessAnalyzer::BuildLoopEnds() {
+    loop_ends_ = InstMap<LifeNumber>(graph_->GetNumInsts(), 0);
+    std::vector<Loop *> loops;
+    for (auto region : linear_regions_) {
+        if (region->GetOpcode() != Opcode::End && region->IsLoopHeader()) {
+            loops.push_back(region->GetLoop());
+        }
+    }
+    std::stable_sort(loops.begin(), loops.end(), [](Loop *left, Loop *right) {
+        return left->GetDepth() > right->GetDepth();
+    });
+    for (auto loop : loops) {
+        auto header = loop->GetHeader();
+        LifeNumber end = header->GetLifeNumber();
+        for (auto body_region : loop->GetBody()) {
+            end = std::max(end, body_region->GetLifeNumberEndOfRegion());
+        }
+        for (auto inner_loop : loop->GetInnerLoops()) {
+            end = std::max(end, loop_ends_[inner_loop->GetHeader()]);
+        }
+        loop_ends_[header] = end;
+    }
+}
+
 void LivenessAnalyzer::FillLifeNumbersInRegionBlock(RegionInst *region, LifeNumber &life_number, LinearNumber &linear_number) {
     LifeNumber start_block = life_number;
     region->SetLifeNumber(start_block);
@@ -64,10 +267,12 @@ void LivenessAnalyzer::BuildIntervals() {
         live_intervals_[i].SetLinearNumber(i);
     }
 
+    // Pointers to live sets are kept, so vector isn't reallocated
+    live_sets_.clear();
+    live_sets_.reserve(linear_regions_.size());
     for (auto it = linear_regions_.rbegin(); it != linear_regions_.rend(); it++) {
         auto region = *it;
-        auto live_set = new RegionBlockLiveSet(num_linear_inst_);
-        region_block_livesets_[region->GetId()] = live_set;
+        region_block_livesets_[region->GetId()] = &live_sets_.emplace_back(num_linear_inst_);
 
         // It should be first iteration
         if (region->GetOpcode() == Opcode::End) {
@@ -83,34 +288,33 @@ void LivenessAnalyzer::ProcessHeaderRegion(RegionInst *region) {
     if (!region->IsLoopHeader()) {
         return;
     }
-    auto loop = region->GetLoop();
-    LifeNumber min_lifenumber = region->GetLifeNumber();
-    LifeNumber max_lifenumber = region->GetLifeNumber();
-    for (auto body_loop : loop->GetBody()) {
-        max_lifenumber = std::max(max_lifenumber, body_loop->GetLifeNumberEndOfRegion());
-    }
-    UpdateLiveIntervalAllLiveSet(region_block_livesets_[region->GetId()], min_lifenumber, max_lifenumber + 2);
+    auto range = GetLoopLiveRange(region);
+    UpdateLiveIntervalAllLiveSet(region_block_livesets_[region->GetId()], range.GetBegin(), range.GetEnd());
 }
 
 void LivenessAnalyzer::CalcIniteialLiveSet(RegionInst *region) {
-    for (auto succ_region : region->GetLast()->GetRawUsers()) {
-        if (region_block_livesets_[succ_region->GetId()] == nullptr) {
-            continue;
+    for (auto succ_region : region->GetLast()->GetControlUsers()) {
+        // Live out of region is union of live in of successors. Live in of loop header
+        // isn't known on back edge, it is added by ProcessHeaderRegion, but inputs of Phi are
+        if (region_block_livesets_[succ_region->GetId()] != nullptr) {
+            region_block_livesets_[region->GetId()]->Union(region_block_livesets_[succ_region->GetId()]);
         }
 
-        region_block_livesets_[region->GetId()]->Copy(region_block_livesets_[succ_region->GetId()]);
-        // TODO Check work with many phi
-
         if (succ_region->GetOpcode() == Opcode::End) {
             continue;
         }
         for (Inst *i = succ_region->GetControlUser(); i->GetOpcode() == Opcode::Phi; i = i->GetNext()) {
             PhiInst *phi_inst = static_cast<PhiInst *>(i);
             uint32_t index_pred = succ_region->CastToRegion()->GetIndexPredecessor(region->GetLast());
-            region_block_livesets_[region->GetId()]->Set(phi_inst->GetDataInput(index_pred)->GetLinearNumber());
+            auto input = phi_inst->GetDataInput(index_pred);
+            region_block_livesets_[region->GetId()]->Set(input->GetLinearNumber());
+            // Move to Phi is at the end of predecessor
+            live_intervals_[input->GetLinearNumber()].AddUsePosition(region->GetLast()->GetLifeNumber());
         }
     }
-    UpdateLiveIntervalAllLiveSet(region_block_livesets_[region->GetId()], region->GetLifeNumber(), region->GetLast()->GetLifeNumber());
+    // Live out values are live until the begin of the next region
+    auto &range = region_live_ranges_[region->GetId()];
+    UpdateLiveIntervalAllLiveSet(region_block_livesets_[region->GetId()], range.GetBegin(), range.GetEnd());
 }
 
 void LivenessAnalyzer::ReverseIterateRegionBlock(RegionInst *region) {
@@ -128,13 +332,15 @@ void LivenessAnalyzer::ReverseIterateRegionBlock(RegionInst *region) {
         live_set->Clear(inst_linear_number);
 
         // Are looking inputs
-        if (inst->GetOpcode() == Opcode::Constant || inst->GetOpcode() == Opcode::Parameter) {
+        // Inputs of Phi are live out of predecessors, they are added in CalcIniteialLiveSet
+        if (inst->GetOpcode() == Opcode::Constant || inst->GetOpcode() == Opcode::Parameter || inst->IsPhi()) {
             continue;
         }
         auto num_inputs = inst->NumDataInputs();
         for (id_t i = 0; i < num_inputs; i++) {
             auto new_inst = inst->GetDataInput(i);
-            live_intervals_[new_inst->GetLinearNumber()].Append(region->GetLifeNumber(), inst->GetLifeNumber());
+            live_intervals_[new_inst->GetLinearNumber()].AddRange(region->GetLifeNumber(), inst->GetLifeNumber());
+            live_intervals_[new_inst->GetLinearNumber()].AddUsePosition(inst->GetLifeNumber());
             live_set->Set(new_inst->GetLinearNumber());
         }
     }
@@ -191,17 +397,16 @@ void LivenessAnalyzer::BuildLifeIfJump(RegionInst *region, LinearNumber &linear_
 }
 
 void LivenessAnalyzer::UpdateLiveIntervalAllLiveSet(RegionBlockLiveSet* live_set, LifeNumber begin, LifeNumber end) {
-    for (LinearNumber i = 0; i < live_set->Size(); i++) {
-        if (live_set->IsSet(i)) {
-            live_intervals_[i].Append(begin, end);
-        }
-    }
+    live_set->ForEachLive([this, begin, end](LinearNumber i) {
+        live_intervals_[i].AddRange(begin, end);
+    });
 }
 
 void LivenessAnalyzer::DumpIntervals() {
     for (LinearNumber i = 0; i < num_linear_inst_; i++) {
-        auto live_interval = live_intervals_[i];
-        std::cout << "Interval:" << i << " [" << live_interval.GetBegin() << ", " << live_interval.GetEnd() << ")" << std::endl;
+        auto &live_interval = live_intervals_[i];
+        std::cout << "Interval:" << i << " ";
+        live_interval.Dump(std::cout);
     }
 }
 
@@ -1,7 +1,10 @@
 #pragma once
 
-#include <map>
+#include <limits>
+
 #include "inst.h"
+#include "inst_map.h"
+#include "utils/bit_vector.h"
 
 namespace compiler {
 
@@ -29,81 +32,91 @@ protected:
     LifeNumber end_;
 };
 
-class LiveInterval : public LiveRange {
+// Position, which isn't covered by any interval
+constexpr LifeNumber INVALID_LIFE_NUMBER = std::numeric_limits<LifeNumber>::max();
+
+/*
+ * Live interval of value with lifetime holes: sorted list of disjoint ranges
+ * and sorted positions of uses (Wimmer, "Linear Scan Register Allocation on SSA Form").
+ * Ranges and uses are stored from the last one: intervals are built from the last region
+ * to the first one, and allocator splits off the begin of interval, so both are changes
+ * in the end of vectors.
+ */
+class LiveInterval {
 public:
-    LiveInterval():
-        LiveRange() {};
-
-    LiveInterval(LifeNumber begin, LifeNumber end):
-        LiveRange(begin, end) {};
-
-    void Append(LifeNumber begin, LifeNumber end) {
-        if (is_first_) {
-            begin_ = begin;
-            end_ = end;
-            is_first_ = false;
-            return;
-        }
+    LiveInterval() = default;
 
-        //                 OldBegin     OldEnd
-        //                   ||-----------||
-        //   ||-----------------||
-        // begin                end
-        // ==============RESULT==============
-        //   ||---------------------------||
-        //  NewBegin                    NewEnd
-        if (begin < begin_ && end < end_) {
-            begin_ = begin;
-            return;
+    // Interval with one range, empty if begin == end
+    LiveInterval(LifeNumber begin, LifeNumber end) {
+        if (begin != end) {
+            ranges_.emplace_back(begin, end);
         }
+    }
 
-        //          OldBegin     OldEnd
-        //            ||-----------||
-        //   ||--------------------------||
-        // begin                         end
-        // ==============RESULT==============
-        //   ||--------------------------||
-        //  NewBegin                    NewEnd
-        if (begin < begin_ && end > end_) {
-            begin_ = begin;
-            end_ = end;
-            return;
-        }
+    // Begin of the first range, 0 for empty interval
+    LifeNumber GetBegin() const {
+        return ranges_.empty() ? 0 : ranges_.back().GetBegin();
+    }
 
-        // OldBegin                     OldEnd
-        //   ||--------------------------||
-        //            ||-----------||
-        //           begin         end
-        // ==============RESULT==============
-        //   ||--------------------------||
-        //  NewBegin                    NewEnd
-        if (begin > begin_ && end < end_) {
-            return;
-        }
+    // End of the last range, 0 for empty interval
+    LifeNumber GetEnd() const {
+        return ranges_.empty() ? 0 : ranges_.front().GetEnd();
+    }
 
-        // OldBegin    OldEnd
-        //   ||---------||
-        //             ||-----------||
-        //            begin         end
-        // ==============RESULT==============
-        //   ||---------------------||
-        //  NewBegin               NewEnd
-        if (begin > begin_ && end > end_) {
-            return;
-        }
+    bool IsEmpty() const {
+        return ranges_.empty();
+    }
+
+    size_t NumRanges() const {
+        return ranges_.size();
+    }
 
-        UNREACHABLE();
+    // Ranges are numbered from the first one
+    const LiveRange &GetRange(size_t index) const {
+        ASSERT(index < ranges_.size());
+        return ranges_[ranges_.size() - 1 - index];
     }
 
-    void TrimBegin(LifeNumber begin) {
-        ASSERT(begin >= begin_);
-        begin_ = begin;
+    size_t NumUsePositions() const {
+        return use_positions_.size();
     }
 
-    void Dump() {
-        std::cerr << "[" << begin_ << ", " << end_ << ")" << std::endl;
+    // Uses are numbered from the first one
+    LifeNumber GetUsePosition(size_t index) const {
+        ASSERT(index < use_positions_.size());
+        return use_positions_[use_positions_.size() - 1 - index];
     }
 
+    // Overlapping and adjacent ranges are merged
+    void AddRange(LifeNumber begin, LifeNumber end);
+
+    // Definition is the begin of the first range. Value without uses lives only in "begin"
+    void TrimBegin(LifeNumber begin);
+
+    void AddUsePosition(LifeNumber position);
+
+    bool Covers(LifeNumber position) const;
+
+    // End of range, which covers position, or begin of the next range, or INVALID_LIFE_NUMBER
+    LifeNumber NextRangeBound(LifeNumber position) const;
+
+    // The first position, which is covered by both intervals, or INVALID_LIFE_NUMBER
+    LifeNumber FindIntersection(const LiveInterval &other) const;
+
+    // The first use at "position" or after it, or INVALID_LIFE_NUMBER
+    LifeNumber NextUsePosition(LifeNumber position) const;
+
+    // The last use before "position", or INVALID_LIFE_NUMBER
+    LifeNumber PrevUsePosition(LifeNumber position) const;
+
+    /*
+     * Ranges and uses from "position" are moved to the returned interval of the same value.
+     * Position is inside of interval, it can be in lifetime hole.
+     */
+    LiveInterval SplitAt(LifeNumber position);
+
+    void Dump(std::ostream &out = std::cerr) const;
+
     void SetLinearNumber(LinearNumber number) {
         my_linear_number_ = number;
     }
@@ -113,67 +126,80 @@ public:
     }
 
 private:
-    bool is_first_ = true;
-    LinearNumber my_linear_number_;
+    // From the last one
+    std::vector<LiveRange> ranges_;
+    std::vector<LifeNumber> use_positions_;
+    LinearNumber my_linear_number_ = 0;
 };
 
 class RegionBlockLiveSet {
 public:
     RegionBlockLiveSet(LifeNumber size):
-        live_inst_(size, false),
-        size_(size) {}
+        live_inst_(size) {}
 
     RegionBlockLiveSet() = delete;
 
     void Set(LinearNumber index) {
-        ASSERT(index < live_inst_.size());
-        live_inst_[index] = true;
+        live_inst_.SetBit(index);
     }
 
     void Clear(LinearNumber index) {
-        ASSERT(index < live_inst_.size());
-        live_inst_[index] = false;
+        live_inst_.ClearBit(index);
     }
 
     bool IsSet(LinearNumber index) {
-        ASSERT(index < live_inst_.size());
-        return live_inst_[index];
+        return live_inst_.GetBit(index);
     }
 
-    void Copy(RegionBlockLiveSet *live_set) {
-        ASSERT(live_set->size_ == size_);
-        for (LinearNumber i = 0; i < size_; i++) {
-            live_inst_[i] = live_set->live_inst_[i];
-        }
+    void Union(RegionBlockLiveSet *live_set) {
+        live_inst_.Union(live_set->live_inst_);
+    }
+
+    // Only live instructions are visited
+    template <typename Fn>
+    void ForEachLive(Fn &&fn) {
+        live_inst_.ForEachSetBit([&fn](size_t index) { fn(static_cast<LinearNumber>(index)); });
     }
 
     LinearNumber Size() {
-        return size_;
+        return live_inst_.size();
     }
 
 private:
-    // std::vector<bool> possible have optimal realisation for bool
-    std::vector<bool> live_inst_;
-    LinearNumber size_ = 0;
+    // Bit per linear number of instruction
+    BitVector live_inst_;
 };
 
+// Begin of region in linear order, is used to move split positions out of loops
+struct BlockBound {
+    LifeNumber begin;
+    uint32_t loop_depth;
+    // Index of the latest block before this one with smaller loop depth
+    uint32_t prev_shallower;
+};
+
+constexpr uint32_t NO_BLOCK = std::numeric_limits<uint32_t>::max();
+
 class LivenessAnalyzer {
 public:
     LivenessAnalyzer(Graph *graph):
         graph_(graph) {};
 
-    ~LivenessAnalyzer() {
-        for (auto liveset : region_block_livesets_) {
-            delete liveset.second;
-        }
-    }
-
     void Run();
     void DumpLifeLinearData(std::ostream &out);
     std::vector<LiveInterval>& GetLiveIntervals() {
         return live_intervals_;
     }
 
+    const std::vector<RegionInst *> &GetLinearRegions() const {
+        return linear_regions_;
+    }
+
+    // Sorted by begin
+    const std::vector<BlockBound> &GetBlockBounds() const {
+        return block_bounds_;
+    }
+
 private:
     void PrepareData();
     void BuildLifeNumbers();
@@ -182,6 +208,11 @@ private:
     void PrintLifeLinearData(Inst *inst, std::ostream &out);
     void BuildLifeIfJump(RegionInst *region, LinearNumber &linear_number, LifeNumber &life_number);
 
+    void BuildLoopEnds();
+    void BuildBlockBounds();
+    // Values, which are live in header, are live in all regions of loop and its inner loops
+    LiveRange GetLoopLiveRange(RegionInst *header);
+
     void BuildIntervals();
     void CalcIniteialLiveSet(RegionInst *region);
     void UpdateLiveIntervalAllLiveSet(RegionBlockLiveSet* live_set, LifeNumber begin, LifeNumber end);
@@ -207,10 +238,15 @@ private:
     std::vector<RegionInst *> linear_regions_;
     std::vector<LifeNumber> inst_life_numbers_;
     std::vector<LiveInterval> live_intervals_;
-
-    // Unfortunately, I had to use a "map", since in Sea Of Nodes the region indices are not in order
-    std::map<id_t, LiveRange> region_live_ranges_;
-    std::map<id_t, RegionBlockLiveSet *> region_block_livesets_;
+    std::vector<BlockBound> block_bounds_;
+
+    // Indexed by id of region, values for other instructions aren't used
+    InstMap<LiveRange> region_live_ranges_;
+    // The latest end of region of loop by id of header
+    InstMap<LifeNumber> loop_ends_;
+    InstMap<RegionBlockLiveSet *> region_block_livesets_;
+    // Storage of live sets, one per region of linear order
+    std::vector<RegionBlockLiveSet> live_sets_;
 };
 
 }
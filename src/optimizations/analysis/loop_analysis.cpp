@@ -10,38 +10,51 @@ namespace compiler {
 void LoopAnalysis::Run() {
     auto start = static_cast<RegionInst *>(graph_->GetInstByIndex(0));
 
-    DomTreeSlow(graph_).Run();
-    DFSRegion(start, nullptr);
+    graph_->GetPassManager()->GetAnalysis<DomTree>();
+    ResetLoops();
+    Marker visited(graph_);
+    Marker trace(graph_);
+    m_visited_ = &visited;
+    m_trace_ = &trace;
+
+    DFSRegion(start);
     CreateRootLoop();
     CompliteLoops();
     SetLoopProperties(graph_->GetRootLoop(), 0);
-}
 
-void LoopAnalysis::DFSRegion(RegionInst *region, RegionInst *prev_region) {
-    // Process inst if already visited it on owr way from root
-    if (m_trace_.TrySetMarker(region)) {
-        ProcessNewBackEdge(region, prev_region);
-    }
+    m_visited_ = nullptr;
+    m_trace_ = nullptr;
+}
 
-    if (m_visited_.TrySetMarker(region)) {
-        m_trace_.SetMarker(region, false);
-        return;
+void LoopAnalysis::ResetLoops() {
+    for (auto region : graph_->GetPassManager()->GetAnalysis<RpoRegions>().GetVector()) {
+        region->SetLoop(nullptr);
     }
+    graph_->ClearLoops();
+}
 
-    auto control = SkipBodyOfRegion(region);
-    for (auto new_region : control->GetRawUsers()) {
-        ASSERT(new_region->IsRegion());
-        DFSRegion(static_cast<RegionInst *>(new_region), region);
-    }
+void LoopAnalysis::DFSRegion(RegionInst *start) {
+    auto enter = [this](Inst *region, Inst *prev_region) {
+        ASSERT(region->IsRegion());
+        // Process inst if already visited it on owr way from root
+        if (m_trace_->TrySetMarker(region)) {
+            ProcessNewBackEdge(region->CastToRegion(), prev_region->CastToRegion());
+        }
 
-    m_trace_.SetMarker(region, false);
+        if (m_visited_->TrySetMarker(region)) {
+            m_trace_->SetMarker(region, false);
+            return false;
+        }
+        return true;
+    };
+    auto leave = [this](Inst *region) { m_trace_->SetMarker(region, false); };
+    DfsWalker<RegionSuccessors>().Walk(start, enter, leave);
 }
 
 Loop *LoopAnalysis::CreateLoop(RegionInst *region) {
     ASSERT(region->GetOpcode() == Opcode::Region);
-    auto loop = new Loop;
+    auto loop = graph_->GetAllocator()->New<Loop>();
     graph_->IncNumLoops();
-    region->SetLoop(loop);
     loop->SetId(graph_->GetNumLoops());
     loop->SetHeader(region);
     loop->AddRegion(region);
@@ -61,9 +74,7 @@ void LoopAnalysis::ProcessNewBackEdge(RegionInst *header, RegionInst *backedge)
 }
 
 void LoopAnalysis::CompliteLoops() {
-    auto rpo = RpoRegions(graph_);
-    rpo.Run();
-    auto &rpo_regions = rpo.GetVector();
+    auto &rpo_regions = graph_->GetPassManager()->GetAnalysis<RpoRegions>().GetVector();
 
     for (auto it = rpo_regions.rbegin(); it != rpo_regions.rend(); it++) {
         auto region = *it;
@@ -78,8 +89,8 @@ void LoopAnalysis::CompliteLoops() {
                 }
             }
         } else {
-            m_visited_.Clear();
-            m_visited_.SetMarker(region);
+            m_visited_->Clear();
+            m_visited_->SetMarker(region);
 
             for (auto backedge : loop->GetBackedges()) {
                 FillLoop(loop, backedge);
@@ -101,38 +112,41 @@ void LoopAnalysis::CompliteLoops() {
     }
 }
 
-void LoopAnalysis::FillLoop(Loop *loop, RegionInst *region) {
-    if (m_visited_.TrySetMarker(region)) {
-        return;
-    }
-    if (region->GetLoop() == nullptr) {
-        loop->AddRegion(region);
-    } else if (region->GetLoop()->GetHeader() != loop->GetHeader()) {
-        if (region->GetLoop()->GetOuterLoop() == nullptr) {
-            region->GetLoop()->SetOuterLoop(loop);
-            loop->AppendInnerLoop(region->GetLoop());
+void LoopAnalysis::FillLoop(Loop *loop, RegionInst *backedge) {
+    walker_.Walk(backedge, [this, loop](Inst *inst, Inst *) {
+        if (m_visited_->TrySetMarker(inst)) {
+            return false;
         }
-    }
-
-    auto num_inputs = region->NumAllInputs();
-    for (uint32_t i = 0; i < num_inputs; i++) {
-        FillLoop(loop, GetRegionByInputRegion(region->GetRegionInput(i)));
-    }
+        auto region = inst->CastToRegion();
+        if (region->GetLoop() == nullptr) {
+            loop->AddRegion(region);
+        } else if (region->GetLoop()->GetHeader() != loop->GetHeader()) {
+            if (region->GetLoop()->GetOuterLoop() == nullptr) {
+                region->GetLoop()->SetOuterLoop(loop);
+                loop->AppendInnerLoop(region->GetLoop());
+            }
+        }
+        return true;
+    });
 }
 
 void LoopAnalysis::CreateRootLoop() {
     ASSERT(graph_->GetRootLoop() == nullptr);
-    auto root_loop = new Loop;
+    auto root_loop = graph_->GetAllocator()->New<Loop>();
     root_loop->SetId(0);
     graph_->SetRootLoop(root_loop);
 }
 
-void LoopAnalysis::SetLoopProperties(Loop *loop, uint32_t depth) {
+void LoopAnalysis::SetLoopProperties(Loop *root, uint32_t depth) {
     // TODO Add check infinity loop
-    loop->SetDepth(depth);
-    depth++;
-    for (auto inner_loop : loop->GetInnerLoops()) {
-        SetLoopProperties(inner_loop, depth);
+    std::vector<std::pair<Loop *, uint32_t>> stack {{root, depth}};
+    while (!stack.empty()) {
+        auto [loop, loop_depth] = stack.back();
+        stack.pop_back();
+        loop->SetDepth(loop_depth);
+        for (auto inner_loop : loop->GetInnerLoops()) {
+            stack.emplace_back(inner_loop, loop_depth + 1);
+        }
     }
 }
 
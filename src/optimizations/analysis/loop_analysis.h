@@ -2,19 +2,14 @@
 
 #include "graph.h"
 #include "marker.h"
+#include "dfs_walker.h"
 
 namespace compiler {
 
+// Loops are allocated in arena of the graph
 class Loop
 {
 public:
-
-    ~Loop() {
-        for (auto region : body_) {
-            region->SetLoop(nullptr);
-        }
-    }
-
     RegionInst *GetHeader() {
         return header_;
     }
@@ -53,7 +48,8 @@ public:
     }
 
     void AddRegion(RegionInst *region) {
-        ASSERT(!LoopContaine(region));
+        // Region belongs to the only loop, so search in body isn't needed
+        ASSERT(region->GetLoop() != this);
         region->SetLoop(this);
         body_.push_back(region);
     }
@@ -102,24 +98,28 @@ class LoopAnalysis
 {
 public:
     LoopAnalysis(Graph *graph):
-        graph_(graph),
-        m_visited_(graph),
-        m_trace_(graph) {}
+        graph_(graph) {}
 
     void Run();
-    void DFSRegion(RegionInst *region, RegionInst *prev_region);
+    // Finds back edges
+    void DFSRegion(RegionInst *start);
     Loop *CreateLoop(RegionInst *region);
     void ProcessNewBackEdge(RegionInst *header, RegionInst *backedge);
     void SetLoopProperties(Loop *loop, uint32_t depth);
 
     void CompliteLoops();
-    void FillLoop(Loop *loop, RegionInst *region);
+    // Adds regions from "backedge" up to header of loop
+    void FillLoop(Loop *loop, RegionInst *backedge);
     void CreateRootLoop();
+    // Analysis can be run again after changes of graph
+    void ResetLoops();
 
 private:
     Graph *graph_;
-    Marker m_visited_;
-    Marker m_trace_;
+    // Markers exist only during Run, so cached analysis doesn't hold slots of markers
+    Marker *m_visited_ = nullptr;
+    Marker *m_trace_ = nullptr;
+    DfsWalker<RegionPredecessors> walker_;
 };
 
 }
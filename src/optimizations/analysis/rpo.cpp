@@ -1,5 +1,6 @@
 #include "rpo.h"
 #include "analysis.h"
+#include "dfs_walker.h"
 
 namespace compiler {
 
@@ -13,24 +14,10 @@ void RpoRegions::Run() {
     std::reverse(rpo_regions_.begin(), rpo_regions_.end());
 }
 
-void RpoRegions::DFSRegions(Inst *init_region, [[maybe_unused]] Marker &marker) {
-    if (marker.IsMarked(init_region)) {
-        return;
-    }
-
-    marker.SetMarker(init_region);
-
-    auto inst = SkipBodyOfRegion(init_region);
-    if (inst->GetOpcode() == Opcode::Jump) {
-        DFSRegions(inst->GetControlUser(), marker);
-    }
-
-    if (inst->GetOpcode() == Opcode::If) {
-        DFSRegions(static_cast<IfInst *>(inst)->GetTrueBranch(), marker);
-        DFSRegions(static_cast<IfInst *>(inst)->GetFalseBranch(), marker);
-    }
-
-    AddInstInVector(init_region);
+void RpoRegions::DFSRegions(Inst *init_region, Marker &marker) {
+    DfsWalker<RegionSuccessors>().Walk(init_region,
+        [&marker](Inst *region, Inst *) { return !marker.TrySetMarker(region); },
+        [this](Inst *region) { AddInstInVector(region); });
 }
 
 std::vector<RegionInst *> &RpoRegions::GetVector() {
@@ -53,16 +40,9 @@ RpoInsts* RpoInsts::Run() {
 }
 
 void RpoInsts::DFSInsts(Inst *inst, Marker &marker) {
-    if (marker.IsMarked(inst)) {
-        return;
-    }
-    marker.SetMarker(inst);
-
-    for (id_t i = 0; i < inst->NumAllInputs(); i++) {
-        DFSInsts(inst->GetRawInput(i), marker);
-    }
-
-    AddInstInVector(inst);
+    DfsWalker<InputEdges>().Walk(inst,
+        [&marker](Inst *node, Inst *) { return !marker.TrySetMarker(node); },
+        [this](Inst *node) { AddInstInVector(node); });
 }
 
 std::vector<Inst *> &RpoInsts::GetVector() {
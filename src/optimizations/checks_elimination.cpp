@@ -5,8 +5,10 @@
 namespace compiler {
 
 void ChecksElimination::Run() {
-    DomTreeSlow(graph_).Run();
-    auto rpo_vector = RpoInsts(graph_).Run()->GetVector();
+    auto pm = graph_->GetPassManager();
+    pm->GetAnalysis<DomTree>();
+    // Copy, because graph is changed during iteration
+    auto rpo_vector = pm->GetAnalysis<RpoInsts>().GetVector();
 
     VisitChecks(rpo_vector);
 }
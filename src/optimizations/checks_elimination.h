@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vector"
+#include "pass_manager.h"
 
 namespace compiler {
 
@@ -15,6 +16,9 @@ public:
 
     void Run();
 
+    // Checks are removed from control chains, but regions aren't changed
+    static constexpr AnalysisSet PRESERVED_ANALYSES = CFG_ANALYSES;
+
 private:
     void VisitChecks(std::vector<Inst *> &rpo);
     void VisitNullCheck(Inst *inst);
@@ -1,33 +1,176 @@
+#include <type_traits>
+
 #include "constant_folding.h"
 #include "graph.h"
 
 namespace compiler {
 
-bool ConstFoldingBinaryOp(Graph *graph, Inst *inst) {
+namespace {
+
+template <typename T>
+bool EvaluateTyped(Opcode opc, T left, T right, T *result) {
+    if constexpr (std::is_same_v<T, bool>) {
+        switch (opc) {
+            case Opcode::And:
+                *result = left && right;
+                return true;
+            case Opcode::Or:
+                *result = left || right;
+                return true;
+            default:
+                return false;
+        }
+    } else {
+        // Signed overflow is undefined in C++, so wraparound is computed in unsigned type
+        using Unsigned = std::make_unsigned_t<T>;
+        constexpr Unsigned SHIFT_MASK = sizeof(T) * 8 - 1;
+        auto uleft = static_cast<Unsigned>(left);
+        auto uright = static_cast<Unsigned>(right);
+        switch (opc) {
+            case Opcode::Add:
+                *result = static_cast<T>(uleft + uright);
+                return true;
+            case Opcode::Sub:
+                *result = static_cast<T>(uleft - uright);
+                return true;
+            case Opcode::Mul:
+                // Operands are promoted to int for 32-bit types, it may overflow too
+                *result = static_cast<T>(static_cast<uint64_t>(uleft) * static_cast<uint64_t>(uright));
+                return true;
+            case Opcode::Div:
+                if (right == 0) {
+                    return false;
+                }
+                if constexpr (std::is_signed_v<T>) {
+                    // The minimal value divided by -1 overflows
+                    if (right == -1) {
+                        *result = static_cast<T>(Unsigned(0) - uleft);
+                        return true;
+                    }
+                }
+                *result = left / right;
+                return true;
+            case Opcode::Shl:
+                *result = static_cast<T>(uleft << (uright & SHIFT_MASK));
+                return true;
+            case Opcode::Shr:
+                *result = static_cast<T>(left >> (uright & SHIFT_MASK));
+                return true;
+            case Opcode::And:
+                *result = left & right;
+                return true;
+            case Opcode::Or:
+                *result = left | right;
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
+template <typename T>
+bool CompareTyped(ConditionCode cc, T left, T right) {
+    switch (cc) {
+        case ConditionCode::EQ:
+            return left == right;
+        case ConditionCode::NE:
+            return left != right;
+        case ConditionCode::GE:
+            return left >= right;
+        case ConditionCode::GT:
+            return left > right;
+        case ConditionCode::LE:
+            return left <= right;
+        case ConditionCode::LT:
+            return left < right;
+        default:
+            UNREACHABLE();
+    }
+}
+
+template <typename T>
+bool EvaluateBinaryOp(Opcode opc, Type type, ImmType left, ImmType right, ImmType *result) {
+    T value;
+    if (!EvaluateTyped<T>(opc, static_cast<T>(left), static_cast<T>(right), &value)) {
+        return false;
+    }
+    // NormalizeImm keeps the only form of 32-bit values, extended by sign
+    *result = NormalizeImm(type, static_cast<ImmType>(value));
+    return true;
+}
+
+}  // namespace
+
+bool EvaluateBinaryOp(Opcode opc, Type type, ImmType left, ImmType right, ImmType *result) {
+    switch (type) {
+        case Type::BOOL:
+            return EvaluateBinaryOp<bool>(opc, type, left, right, result);
+        case Type::INT32:
+            return EvaluateBinaryOp<int32_t>(opc, type, left, right, result);
+        case Type::UINT32:
+            return EvaluateBinaryOp<uint32_t>(opc, type, left, right, result);
+        case Type::NONE:
+        case Type::INT64:
+            return EvaluateBinaryOp<int64_t>(opc, type, left, right, result);
+        case Type::UINT64:
+            return EvaluateBinaryOp<uint64_t>(opc, type, left, right, result);
+        default:
+            return false;
+    }
+}
+
+bool EvaluateCompare(ConditionCode cc, Type type, ImmType left, ImmType right, ImmType *result) {
+    switch (type) {
+        case Type::BOOL:
+            *result = CompareTyped<bool>(cc, left != 0, right != 0);
+            return true;
+        case Type::INT32:
+            *result = CompareTyped(cc, static_cast<int32_t>(left), static_cast<int32_t>(right));
+            return true;
+        case Type::UINT32:
+            *result = CompareTyped(cc, static_cast<uint32_t>(left), static_cast<uint32_t>(right));
+            return true;
+        case Type::NONE:
+        case Type::INT64:
+            *result = CompareTyped(cc, left, right);
+            return true;
+        case Type::UINT64:
+            *result = CompareTyped(cc, static_cast<uint64_t>(left), static_cast<uint64_t>(right));
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool EvaluateInst(Inst *inst, ImmType *result) {
+    if (inst->GetOpcode() == Opcode::Constant) {
+        *result = inst->CastToConstant()->GetImm();
+        return true;
+    }
+    if (!inst->IsPure() || inst->NumDataInputs() != 2) {
+        return false;
+    }
     auto input0 = inst->GetDataInput(0);
     auto input1 = inst->GetDataInput(1);
-
     if (!input0->IsConst() || !input1->IsConst()) {
         return false;
     }
-
-    Inst *new_const = nullptr;
     auto imm0 = input0->CastToConstant()->GetImm();
     auto imm1 = input1->CastToConstant()->GetImm();
+    if (inst->GetOpcode() == Opcode::Compare) {
+        return EvaluateCompare(inst->CastToCompare()->GetCC(), input0->GetType(), imm0, imm1, result);
+    }
+    return EvaluateBinaryOp(inst->GetOpcode(), inst->GetType(), imm0, imm1, result);
+}
 
-    switch (inst->GetOpcode()) {
-        case Opcode::Sub:
-            new_const = graph->CreateConstantInst(imm0 - imm1);
-            break;
-        case Opcode::Shl:
-            new_const = graph->CreateConstantInst(imm0 << imm1);
-            break;
-        case Opcode::Or:
-            new_const = graph->CreateConstantInst(imm0 | imm1);
-            break;
-        default:
-            UNREACHABLE();
+bool ConstFoldingBinaryOp(Graph *graph, Inst *inst) {
+    ASSERT(inst->GetOpcode() != Opcode::Constant);
+    ImmType imm = 0;
+    if (!EvaluateInst(inst, &imm)) {
+        return false;
     }
+    auto type = inst->GetType() == Type::NONE ? Type::INT64 : inst->GetType();
+    auto new_const = graph->CreateConstantInst(type, imm);
     new_const->ReplaceDataUsers(inst);
     return true;
 }
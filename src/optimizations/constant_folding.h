@@ -1,10 +1,28 @@
 #pragma once
 
+#include "inst.h"
+
 namespace compiler {
 
-class Inst;
 class Graph;
 
+/*
+ * Evaluation of operations on constants, it is shared by peepholes and SCCP.
+ * Value of type is stored in ImmType as ConstantInst keeps it (NormalizeImm): 32-bit values,
+ * UINT32 too, are extended by their sign, UINT64 keeps bits, BOOL is 0 or 1. Type NONE is INT64.
+ * Arithmetic wraps around, shift is masked by width of type, Shr is arithmetic
+ * for signed types. BOOL supports only And, Or and compare.
+ * Returns false if operation can't be folded, e.g. division by zero or REFERENCE.
+ */
+bool EvaluateBinaryOp(Opcode opc, Type type, ImmType left, ImmType right, ImmType *result);
+
+// "type" is of compared values, result is BOOL
+bool EvaluateCompare(ConditionCode cc, Type type, ImmType left, ImmType right, ImmType *result);
+
+// Returns false if inputs aren't constants or operation can't be folded
+bool EvaluateInst(Inst *inst, ImmType *result);
+
+// Users of "inst" are moved to the new constant of its type
 bool ConstFoldingBinaryOp(Graph *graph, Inst *inst);
 
 }
@@ -1,66 +1,216 @@
+#include <algorithm>
+
 #include "gcm.h"
 #include "analysis/rpo.h"
+#include "analysis/loop_analysis.h"
 
 namespace compiler {
 
-/*
- * TODO: Now write not optimal and not effective algorithm, because that is not main task
-*/
 void GCM::Run() {
-    auto rpo = RpoRegions(graph_);
-    rpo.Run();
-    for (auto region : rpo.GetVector()) {
+    auto pm = graph_->GetPassManager();
+    auto &rpo_regions = pm->GetAnalysis<RpoRegions>().GetVector();
+    // Builds dominator tree too
+    pm->GetAnalysis<LoopAnalysis>();
+
+    auto num_insts = graph_->GetNumInsts();
+    blocks_ = InstMap<RegionInst *>(num_insts, nullptr);
+    dom_depths_ = InstMap<uint32_t>(num_insts, 0);
+    region_insts_ = InstMap<std::vector<Inst *>>(num_insts);
+    schedule_order_.clear();
+    parameters_.clear();
+    num_placed_insts_ = 0;
+
+    PinInsts(rpo_regions);
+    // Inputs of pinned instructions are scheduled early from them, the walk gives order of inputs before users
+    for (auto region : rpo_regions) {
         if (region->GetOpcode() == Opcode::End) {
             continue;
         }
-        // PHI inst always at the beginning of the region
-        for (Inst *fixed_inst = region->GetControlUser();; fixed_inst = fixed_inst->GetControlUser()) {
-            auto opc = fixed_inst->GetOpcode();
-            if (opc == Opcode::Jump || opc == Opcode::If) {
-                PlacingExitFromRegion(fixed_inst, region);
+        for (Inst *inst = region->GetControlUser();; inst = inst->GetControlUser()) {
+            ScheduleEarly(inst);
+            if (inst->IsTerminator()) {
                 break;
             }
-            PlacingDataInst(fixed_inst, region);
+        }
+    }
+    for (auto it = schedule_order_.rbegin(); it != schedule_order_.rend(); it++) {
+        ScheduleLate(*it);
+    }
+    for (auto inst : schedule_order_) {
+        region_insts_[blocks_[inst]].push_back(inst);
+    }
+    std::sort(parameters_.begin(), parameters_.end(), [](Inst *left, Inst *right) {
+        return left->CastToParameter()->GetIndexParam() < right->CastToParameter()->GetIndexParam();
+    });
+
+    for (auto region : rpo_regions) {
+        if (region->GetOpcode() != Opcode::End) {
+            PlaceRegion(region);
         }
     }
     graph_->SetInstsPlaced();
 }
 
-void GCM::PlacingDataInst(Inst *inst, RegionInst *region) {
-    if (inst->IsPlaced()) {
-        return;
+// Dominator of region is before it in RPO
+void GCM::PinInsts(const std::vector<RegionInst *> &rpo_regions) {
+    for (auto region : rpo_regions) {
+        blocks_[region] = region;
+        auto dominator = region->GetDominator();
+        dom_depths_[region] = dominator == nullptr ? 0 : dom_depths_[dominator] + 1;
+        if (region->GetOpcode() == Opcode::End) {
+            continue;
+        }
+        for (Inst *inst = region->GetControlUser();; inst = inst->GetControlUser()) {
+            blocks_[inst] = region;
+            if (inst->IsTerminator()) {
+                break;
+            }
+        }
     }
+}
 
-    auto opc = inst->GetOpcode();
-    if (opc == Opcode::Constant || opc == Opcode::Parameter) {
-        graph_->GetStartRegion()->PushFrontInst(inst);
-        inst->SetPlaced();
+void GCM::ScheduleEarly(Inst *root) {
+    auto start = graph_->GetStartRegion();
+    auto enter = [this, root, start](Inst *inst, Inst *) {
+        if (inst == root) {
+            return true;
+        }
+        if (blocks_[inst] != nullptr) {
+            return false;
+        }
+        if (IsPinned(inst)) {
+            // The only pinned instruction out of control chain
+            ASSERT(inst->GetOpcode() == Opcode::Parameter);
+            blocks_[inst] = start;
+            parameters_.push_back(inst);
+            return false;
+        }
+        // Instruction is visited once, inputs of PURE instruction never reach it again
+        blocks_[inst] = start;
+        return true;
+    };
+    auto leave = [this, root](Inst *inst) {
+        if (inst == root) {
+            return;
+        }
+        auto early = blocks_[inst];
+        for (auto input : inst->GetDataInputs()) {
+            auto block = blocks_[input];
+            if (dom_depths_[block] > dom_depths_[early]) {
+                early = block;
+            }
+        }
+        blocks_[inst] = early;
+        schedule_order_.push_back(inst);
+    };
+    walker_.Walk(root, enter, leave);
+}
+
+/*
+ * Users are scheduled before, so their regions are final. User, which isn't placed
+ * (it is unused or unreachable), has no region and doesn't restrict instruction.
+ */
+void GCM::ScheduleLate(Inst *inst) {
+    RegionInst *lca = nullptr;
+    for (auto user : inst->GetDataUsers()) {
+        if (blocks_[user] == nullptr) {
+            continue;
+        }
+        if (!user->IsPhi()) {
+            lca = FindLca(lca, blocks_[user]);
+            continue;
+        }
+        auto region = blocks_[user];
+        auto num_inputs = user->NumDataInputs();
+        for (id_t i = 0; i < num_inputs; i++) {
+            auto pred = blocks_[region->GetRegionInput(i)];
+            if (user->GetDataInput(i) == inst && pred != nullptr) {
+                lca = FindLca(lca, pred);
+            }
+        }
+    }
+    auto early = blocks_[inst];
+    if (lca == nullptr) {
+        return;
+    }
+    // Region above LCA may be out of the branch, which guards the instruction
+    if (inst->CanTrap()) {
+        blocks_[inst] = lca;
         return;
     }
+    // Path from late to early in dominator tree, the first region with the smallest loop depth.
+    // Region out of loops can't be replaced, so the walk stops at it
+    auto best = lca;
+    while (lca != early && best->GetLoop()->GetDepth() != 0) {
+        lca = lca->GetDominator()->CastToRegion();
+        if (lca->GetLoop()->GetDepth() < best->GetLoop()->GetDepth()) {
+            best = lca;
+        }
+    }
+    blocks_[inst] = best;
+}
 
-    for (uint32_t i = 0; i < inst->NumDataInputs(); i++) {
-        auto input = inst->GetDataInput(i);
-        PlacingDataInst(input, region);
+RegionInst *GCM::FindLca(RegionInst *first, RegionInst *second) {
+    if (first == nullptr) {
+        return second;
+    }
+    while (dom_depths_[first] > dom_depths_[second]) {
+        first = first->GetDominator()->CastToRegion();
+    }
+    while (dom_depths_[second] > dom_depths_[first]) {
+        second = second->GetDominator()->CastToRegion();
+    }
+    while (first != second) {
+        first = first->GetDominator()->CastToRegion();
+        second = second->GetDominator()->CastToRegion();
     }
-    region->CastToRegion()->PushBackInst(inst);
-    inst->SetPlaced();
+    return first;
 }
 
-void GCM::PlacingExitFromRegion(Inst *inst, RegionInst *region) {
-    auto opc = inst->GetOpcode();
-    ASSERT(opc == Opcode::Jump || opc == Opcode::If);
-    if (opc == Opcode::Jump) {
-        // TODO: Find more good place for this fill
+/*
+ * Phi are at the beginning of region, parameters are the first in Start. Then instructions
+ * of control chain with their inputs, then values for other regions and condition of If.
+ */
+void GCM::PlaceRegion(RegionInst *region) {
+    if (region == graph_->GetStartRegion()) {
+        for (auto parameter : parameters_) {
+            region->PushBackInst(parameter);
+            parameter->SetPlaced();
+            num_placed_insts_++;
+        }
+    }
+    Inst *inst = region->GetControlUser();
+    for (; inst->IsPhi(); inst = inst->GetControlUser()) {
         region->PushBackInst(inst);
-        return;
+        inst->SetPlaced();
+        num_placed_insts_++;
+    }
+    for (; !inst->IsTerminator(); inst = inst->GetControlUser()) {
+        PlaceWithInputs(inst, region);
     }
+    auto exit = inst;
+    auto condition = exit->GetOpcode() == Opcode::If ? exit->GetDataInput(0) : nullptr;
+    for (auto scheduled : region_insts_[region]) {
+        if (scheduled != condition) {
+            PlaceWithInputs(scheduled, region);
+        }
+    }
+    PlaceWithInputs(exit, region);
+}
 
-    if (opc == Opcode::If) {
-        // TODO: Find more good place for this fill
-        PlacingDataInst(inst->GetDataInput(0), region);
+void GCM::PlaceWithInputs(Inst *root, RegionInst *region) {
+    auto enter = [this, region](Inst *inst, Inst *from) {
+        if (inst->IsPlaced()) {
+            return false;
+        }
+        return from == nullptr || (!IsPinned(inst) && blocks_[inst] == region);
+    };
+    auto leave = [this, region](Inst *inst) {
         region->PushBackInst(inst);
-        return;
-    }
+        inst->SetPlaced();
+        num_placed_insts_++;
+    };
+    walker_.Walk(root, enter, leave);
 }
 
 }
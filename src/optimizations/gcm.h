@@ -1,12 +1,30 @@
 #pragma once
 
+#include <vector>
+
 #include "graph.h"
+#include "inst_map.h"
+#include "analysis/dfs_walker.h"
 
 namespace compiler {
 
-
-// After graph can have less instrutions than was before, because during Global Code Motion
-// not added unused instructions in regions
+/*
+ * Global Code Motion (Click, "Global Code Motion / Global Value Numbering", 1995).
+ * Instructions of control chain, Phi and Parameter are pinned in their regions, PURE
+ * instructions are scheduled:
+ *   - early: the deepest region in dominator tree of regions of inputs;
+ *   - late: LCA in dominator tree of regions of users, Phi uses its input at the end
+ *     of the corresponding predecessor;
+ *   - the region with the smallest loop depth on the path from late to early in dominator
+ *     tree, the latest of them. So invariants leave loops and values sink into conditional
+ *     paths, where they are used;
+ *   - instruction, which can trap, stays in late region, so it isn't hoisted out of branch,
+ *     which may guard it.
+ * Inside of region instruction is placed right before its first user, instructions, which
+ * are used only in other regions, are placed before the exit of region.
+ *
+ * After graph can have less instructions than was before, unused instructions aren't placed.
+ */
 class GCM
 {
 public:
@@ -15,12 +33,41 @@ public:
 
     void Run();
 
+    uint32_t GetNumPlacedInsts() const {
+        return num_placed_insts_;
+    }
+
+    // Instructions are placed in regions, but edges of graph aren't changed
+    static constexpr AnalysisSet PRESERVED_ANALYSES = CFG_ANALYSES | ANALYSIS_BIT(RPO_INSTS);
+
 private:
-    void PlacingDataInst(Inst *inst, RegionInst *region);
-    void PlacingExitFromRegion(Inst *inst, RegionInst *region);
+    static bool IsPinned(Inst *inst) {
+        return !inst->IsPure();
+    }
+
+    // Regions of pinned instructions, which are used as bounds of scheduling
+    void PinInsts(const std::vector<RegionInst *> &rpo_regions);
+    void ScheduleEarly(Inst *root);
+    void ScheduleLate(Inst *inst);
+    RegionInst *FindLca(RegionInst *first, RegionInst *second);
+    void PlaceRegion(RegionInst *region);
+    // Instruction and its inputs from the same region, which aren't placed yet
+    void PlaceWithInputs(Inst *root, RegionInst *region);
 
 private:
     Graph *graph_;
+    DfsWalker<DataInputEdges> walker_;
+
+    // Region of pinned instruction, or region of scheduled one: early, then the final one
+    InstMap<RegionInst *> blocks_;
+    // Depth of region in dominator tree
+    InstMap<uint32_t> dom_depths_;
+    // Scheduled instructions, inputs before users
+    std::vector<Inst *> schedule_order_;
+    // Scheduled instructions of region in schedule_order_
+    InstMap<std::vector<Inst *>> region_insts_;
+    std::vector<Inst *> parameters_;
+    uint32_t num_placed_insts_ = 0;
 };
 
 }
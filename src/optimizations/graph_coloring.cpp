@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "graph_coloring.h"
+
+namespace compiler {
+
+GraphColoringRegAlloc::GraphColoringRegAlloc(LivenessAnalyzer &liveness, const Target &target):
+    liveness_(&liveness),
+    target_(&target),
+    // Values of IR are integer, so all of them are in general purpose registers
+    class_regs_(target.GetAllocatableRegs(RegClass::GPR)),
+    constraints_(BuildRegConstraints(liveness.GetLinearRegions(), liveness.GetLiveIntervals().size(), target)) {}
+
+void GraphColoringRegAlloc::Run() {
+    auto &intervals = liveness_->GetLiveIntervals();
+    auto &block_bounds = liveness_->GetBlockBounds();
+    auto num_values = intervals.size();
+
+    representatives_.resize(num_values);
+    neighbors_.assign(num_values, {});
+    reserved_regs_.assign(num_values, 0);
+    hints_ = constraints_.hints;
+    spill_costs_.assign(num_values, 0);
+    degrees_.assign(num_values, 0);
+    removed_.assign(num_values, false);
+    select_stack_.clear();
+    colors_.assign(num_values, INVALID_REG);
+    stack_locations_.assign(num_values, 0);
+    marks_.assign(num_values, 0);
+    mark_ = 0;
+    num_spills_ = 0;
+    num_stack_locations_ = 0;
+    num_interferences_ = 0;
+    num_coalesced_moves_ = 0;
+    num_stack_uses_ = 0;
+    num_rematerializations_ = 0;
+    spill_cost_ = 0;
+
+    for (LinearNumber value = 0; value < num_values; value++) {
+        representatives_[value] = value;
+        auto &interval = intervals[value];
+        if (interval.IsEmpty()) {
+            continue;
+        }
+        auto cost = GetFrequency(block_bounds, interval.GetBegin());
+        for (size_t i = 0; i < interval.NumUsePositions(); i++) {
+            cost += GetFrequency(block_bounds, interval.GetUsePosition(i));
+        }
+        // Value is computed again instead of load, it is cheaper
+        spill_costs_[value] = constraints_.rematerializable[value] ? cost / 2.0 : cost;
+    }
+    for (auto regs = class_regs_; regs != 0; regs &= regs - 1) {
+        auto reg_index = __builtin_ctzll(regs);
+        auto &fixed = constraints_.fixed_intervals[reg_index];
+        if (fixed.IsEmpty()) {
+            continue;
+        }
+        for (LinearNumber value = 0; value < num_values; value++) {
+            if (fixed.FindIntersection(intervals[value]) != INVALID_LIFE_NUMBER) {
+                reserved_regs_[value] |= RegMask(1) << reg_index;
+            }
+        }
+    }
+
+    BuildInterferenceGraph();
+    Coalesce();
+    Simplify();
+    Select();
+    AssignStackLocations();
+    BuildRegsMap();
+    CollectSpillStatistics();
+}
+
+LinearNumber GraphColoringRegAlloc::GetNode(LinearNumber value) {
+    while (representatives_[value] != value) {
+        representatives_[value] = representatives_[representatives_[value]];
+        value = representatives_[value];
+    }
+    return value;
+}
+
+// Intervals are swept by begin, every interval is checked with intervals, which are live at its begin
+void GraphColoringRegAlloc::BuildInterferenceGraph() {
+    auto &intervals = liveness_->GetLiveIntervals();
+    std::vector<LinearNumber> order;
+    for (LinearNumber value = 0; value < intervals.size(); value++) {
+        if (!intervals[value].IsEmpty()) {
+            order.push_back(value);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&intervals](LinearNumber left, LinearNumber right) {
+        return intervals[left].GetBegin() < intervals[right].GetBegin();
+    });
+
+    std::vector<LinearNumber> live;
+    for (auto value : order) {
+        auto &interval = intervals[value];
+        auto begin = interval.GetBegin();
+        live.erase(std::remove_if(live.begin(), live.end(), [&intervals, begin](LinearNumber other) {
+            return intervals[other].GetEnd() <= begin;
+        }), live.end());
+        for (auto other : live) {
+            if (intervals[other].FindIntersection(interval) != INVALID_LIFE_NUMBER) {
+                AddInterference(other, value);
+            }
+        }
+        live.push_back(value);
+    }
+}
+
+void GraphColoringRegAlloc::AddInterference(LinearNumber left, LinearNumber right) {
+    neighbors_[left].push_back(right);
+    neighbors_[right].push_back(left);
+    num_interferences_++;
+}
+
+bool GraphColoringRegAlloc::IsInterfered(LinearNumber left, LinearNumber right) const {
+    if (neighbors_[left].size() > neighbors_[right].size()) {
+        std::swap(left, right);
+    }
+    auto &neighbors = neighbors_[left];
+    return std::find(neighbors.begin(), neighbors.end(), right) != neighbors.end();
+}
+
+/*
+ * Every input of Phi is a move on edge, if it is in other location. Moves are
+ * coalesced in order of frequency of edge, so moves in loops are removed first.
+ */
+void GraphColoringRegAlloc::Coalesce() {
+    struct Candidate {
+        uint64_t frequency;
+        LinearNumber phi;
+        LinearNumber input;
+    };
+    auto &intervals = liveness_->GetLiveIntervals();
+    auto &block_bounds = liveness_->GetBlockBounds();
+    std::vector<Candidate> candidates;
+    for (auto region : liveness_->GetLinearRegions()) {
+        if (region->GetOpcode() == Opcode::End) {
+            continue;
+        }
+        for (Inst *phi = region->GetFirst(); phi != nullptr && phi->IsPhi(); phi = phi->GetNext()) {
+            if (intervals[phi->GetLinearNumber()].IsEmpty()) {
+                continue;
+            }
+            auto num_inputs = phi->NumDataInputs();
+            for (id_t i = 0; i < num_inputs; i++) {
+                // Exit of predecessor is Jump or If, which has life number of the last instruction, or Start
+                auto frequency = GetFrequency(block_bounds, region->GetRegionInput(i)->GetLifeNumber());
+                candidates.push_back({frequency, phi->GetLinearNumber(), phi->GetDataInput(i)->GetLinearNumber()});
+            }
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &left, const Candidate &right) {
+        return left.frequency > right.frequency;
+    });
+
+    for (auto &candidate : candidates) {
+        auto node = GetNode(candidate.phi);
+        auto other = GetNode(candidate.input);
+        if (node == other) {
+            num_coalesced_moves_++;
+        } else if (CanCoalesce(node, other)) {
+            Merge(node, other);
+            num_coalesced_moves_++;
+        }
+    }
+}
+
+// Briggs test: the merged node is removed by simplify, as its neighbors of significant degree are removed
+bool GraphColoringRegAlloc::CanCoalesce(LinearNumber left, LinearNumber right) {
+    if (IsInterfered(left, right)) {
+        return false;
+    }
+    auto num_regs = __builtin_popcountll(class_regs_ & ~(reserved_regs_[left] | reserved_regs_[right]));
+    uint32_t num_significant = 0;
+    mark_++;
+    for (auto node : {left, right}) {
+        for (auto neighbor : neighbors_[node]) {
+            if (marks_[neighbor] == mark_) {
+                continue;
+            }
+            marks_[neighbor] = mark_;
+            if (neighbors_[neighbor].size() >= GetNumAvailableRegs(neighbor)) {
+                num_significant++;
+            }
+        }
+    }
+    return num_significant < static_cast<uint32_t>(num_regs);
+}
+
+// "other" is merged into "node", neighbors of "other" become neighbors of "node"
+void GraphColoringRegAlloc::Merge(LinearNumber node, LinearNumber other) {
+    representatives_[other] = node;
+    reserved_regs_[node] |= reserved_regs_[other];
+    if (hints_[node] == INVALID_REG) {
+        hints_[node] = hints_[other];
+    }
+    spill_costs_[node] += spill_costs_[other];
+
+    mark_++;
+    for (auto neighbor : neighbors_[node]) {
+        marks_[neighbor] = mark_;
+    }
+    for (auto neighbor : neighbors_[other]) {
+        auto &list = neighbors_[neighbor];
+        auto it = std::find(list.begin(), list.end(), other);
+        ASSERT(it != list.end());
+        *it = list.back();
+        list.pop_back();
+        if (marks_[neighbor] != mark_) {
+            list.push_back(node);
+            neighbors_[node].push_back(neighbor);
+        }
+    }
+    neighbors_[other].clear();
+    neighbors_[other].shrink_to_fit();
+}
+
+uint32_t GraphColoringRegAlloc::GetNumAvailableRegs(LinearNumber node) const {
+    return __builtin_popcountll(class_regs_ & ~reserved_regs_[node]);
+}
+
+/*
+ * Spill candidates are in min-heap by spill cost / degree. Degree of node only decreases,
+ * so priority in heap can be smaller than the real one, it is updated, when node is on top.
+ * Node without available registers is removed at once, it is spilled anyway.
+ */
+void GraphColoringRegAlloc::Simplify() {
+    auto &intervals = liveness_->GetLiveIntervals();
+    using Candidate = std::pair<double, LinearNumber>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> spill_candidates;
+    std::vector<LinearNumber> worklist;
+    uint32_t num_left = 0;
+    for (LinearNumber node = 0; node < intervals.size(); node++) {
+        if (intervals[node].IsEmpty() || GetNode(node) != node) {
+            continue;
+        }
+        num_left++;
+        degrees_[node] = neighbors_[node].size();
+        auto num_regs = GetNumAvailableRegs(node);
+        if (num_regs == 0 || degrees_[node] < num_regs) {
+            worklist.push_back(node);
+        } else {
+            spill_candidates.push({spill_costs_[node] / degrees_[node], node});
+        }
+    }
+
+    while (num_left != 0) {
+        LinearNumber node = 0;
+        if (!worklist.empty()) {
+            node = worklist.back();
+            worklist.pop_back();
+        } else {
+            auto top = spill_candidates.top();
+            spill_candidates.pop();
+            node = top.second;
+            if (removed_[node]) {
+                continue;
+            }
+            auto priority = spill_costs_[node] / degrees_[node];
+            if (priority > top.first) {
+                spill_candidates.push({priority, node});
+                continue;
+            }
+        }
+        if (removed_[node]) {
+            continue;
+        }
+        removed_[node] = true;
+        select_stack_.push_back(node);
+        num_left--;
+        for (auto neighbor : neighbors_[node]) {
+            if (!removed_[neighbor] && degrees_[neighbor]-- == GetNumAvailableRegs(neighbor)) {
+                worklist.push_back(neighbor);
+            }
+        }
+    }
+}
+
+// Register, which isn't taken by colored neighbors and fixed intervals, hint is preferred
+void GraphColoringRegAlloc::Select() {
+    for (auto it = select_stack_.rbegin(); it != select_stack_.rend(); it++) {
+        auto node = *it;
+        auto available = class_regs_ & ~reserved_regs_[node];
+        for (auto neighbor : neighbors_[node]) {
+            if (colors_[neighbor] != INVALID_REG) {
+                available &= ~(RegMask(1) << colors_[neighbor]);
+            }
+        }
+        if (available == 0) {
+            continue;
+        }
+        auto hint = hints_[node];
+        if (hint != INVALID_REG && (available & (RegMask(1) << hint)) != 0) {
+            colors_[node] = hint;
+            continue;
+        }
+        for (auto reg_index : target_->GetAllocationOrder()) {
+            if ((available & (RegMask(1) << reg_index)) != 0) {
+                colors_[node] = reg_index;
+                break;
+            }
+        }
+    }
+}
+
+// Spilled node takes the first stack location, which isn't taken by its spilled neighbors
+void GraphColoringRegAlloc::AssignStackLocations() {
+    auto &intervals = liveness_->GetLiveIntervals();
+    std::vector<bool> needs_stack(intervals.size(), false);
+    for (LinearNumber value = 0; value < intervals.size(); value++) {
+        if (!intervals[value].IsEmpty() && !constraints_.rematerializable[value]) {
+            needs_stack[GetNode(value)] = true;
+        }
+    }
+    std::vector<bool> taken;
+    for (auto node : select_stack_) {
+        if (colors_[node] != INVALID_REG || !needs_stack[node]) {
+            continue;
+        }
+        taken.assign(num_stack_locations_ + 2, false);
+        for (auto neighbor : neighbors_[node]) {
+            taken[stack_locations_[neighbor]] = true;
+        }
+        int32_t location = 1;
+        while (taken[location]) {
+            location++;
+        }
+        stack_locations_[node] = location;
+        num_stack_locations_ = std::max(num_stack_locations_, static_cast<uint32_t>(location));
+    }
+}
+
+void GraphColoringRegAlloc::BuildRegsMap() {
+    auto &intervals = liveness_->GetLiveIntervals();
+    regs_map_.clear();
+    regs_map_.reserve(intervals.size());
+    for (LinearNumber value = 0; value < intervals.size(); value++) {
+        auto location = LocationData(-1, "NOT SET", false);
+        if (!intervals[value].IsEmpty()) {
+            auto node = GetNode(value);
+            if (colors_[node] != INVALID_REG) {
+                location = Register(colors_[node], target_->GetRegName(colors_[node]));
+            } else if (constraints_.rematerializable[value]) {
+                location = RematLocation();
+            } else {
+                location = StackLocation(stack_locations_[node], "stack");
+            }
+        }
+        regs_map_.push_back({intervals[value], location});
+    }
+    // Values with the same begin stay ordered by linear number
+    std::stable_sort(regs_map_.begin(), regs_map_.end(), [](const RegMap &left, const RegMap &right) {
+        return left.interval.GetBegin() < right.interval.GetBegin();
+    });
+}
+
+void GraphColoringRegAlloc::CollectSpillStatistics() {
+    auto &block_bounds = liveness_->GetBlockBounds();
+    for (auto &map : regs_map_) {
+        auto &interval = map.interval;
+        if (interval.IsEmpty() || map.location.is_reg) {
+            continue;
+        }
+        if (map.location.is_remat) {
+            num_rematerializations_ += interval.NumUsePositions();
+            continue;
+        }
+        num_spills_++;
+        num_stack_uses_ += interval.NumUsePositions();
+        spill_cost_ += GetFrequency(block_bounds, interval.GetBegin());
+        for (size_t i = 0; i < interval.NumUsePositions(); i++) {
+            spill_cost_ += GetFrequency(block_bounds, interval.GetUsePosition(i));
+        }
+    }
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "analysis/liveness_analyzer.h"
+#include "linear_scan.h"
+#include "reg_constraints.h"
+#include "target.h"
+
+namespace compiler {
+
+/*
+ * Chaitin-Briggs graph coloring (Briggs, Cooper, Torczon, "Improvements to Graph Coloring
+ * Register Allocation"). Node of interference graph is a value or values, which are
+ * coalesced, two nodes interfere, if intervals of their values intersect.
+ *   - Coalesce: Phi and its input are merged, if they don't interfere and the merged node
+ *     has less than K neighbors of significant degree (conservative Briggs test), so graph
+ *     doesn't become harder to color. Inputs from hot edges are coalesced first.
+ *   - Simplify: node with degree less than K is removed from graph, it gets register after
+ *     its neighbors. If there is no such node, the node with the smallest spill cost / degree
+ *     is removed, it is colored optimistically.
+ *   - Select: nodes get registers in reverse order of removal, hint is preferred. Node, for
+ *     which no register is left, is spilled.
+ * K of node is number of allocatable registers without registers, which fixed intervals
+ * reserve in life of the node. Spill cost is 10^(loop depth) for definition and every use,
+ * it is halved for rematerializable values as in linear scan.
+ *
+ * Intervals aren't split, spilled value is on stack for all its life and is used from
+ * there, rematerializable value is computed again before every use. Spill makes no new
+ * intervals, so graph isn't built again. Spilled nodes share stack locations, if they
+ * don't interfere.
+ *
+ * Graph is built in O(values * live values), it is more expensive than linear scan, but
+ * gives better result for hot methods. Result is the same as of LinearScanRegAlloc:
+ * RegMap for every value, RegMaps are sorted by begin.
+ */
+class GraphColoringRegAlloc {
+public:
+    GraphColoringRegAlloc(LivenessAnalyzer &liveness, const Target &target);
+
+    void Run();
+
+    std::vector<RegMap> &GetRegsMap() {
+        return regs_map_;
+    }
+
+    const Target &GetTarget() const {
+        return *target_;
+    }
+
+    // Statistics of the last Run
+    // Values on stack
+    uint32_t GetNumSpills() const {
+        return num_spills_;
+    }
+
+    uint32_t GetNumStackLocations() const {
+        return num_stack_locations_;
+    }
+
+    // Edges of graph before coalescing
+    uint32_t GetNumInterferences() const {
+        return num_interferences_;
+    }
+
+    // Inputs of Phi, which are in the same node as Phi, so there are no moves for them
+    uint32_t GetNumCoalescedMoves() const {
+        return num_coalesced_moves_;
+    }
+
+    uint32_t GetNumStackUses() const {
+        return num_stack_uses_;
+    }
+
+    uint32_t GetNumRematerializations() const {
+        return num_rematerializations_;
+    }
+
+    // Definitions and uses on stack, each costs 10^(loop depth), as in linear scan
+    uint64_t GetSpillCost() const {
+        return spill_cost_;
+    }
+
+private:
+    // Node of value is its representative after coalescing
+    LinearNumber GetNode(LinearNumber value);
+    void BuildInterferenceGraph();
+    void AddInterference(LinearNumber left, LinearNumber right);
+    bool IsInterfered(LinearNumber left, LinearNumber right) const;
+    void Coalesce();
+    bool CanCoalesce(LinearNumber left, LinearNumber right);
+    void Merge(LinearNumber node, LinearNumber other);
+    uint32_t GetNumAvailableRegs(LinearNumber node) const;
+    void Simplify();
+    void RemoveNode(LinearNumber node);
+    void Select();
+    void AssignStackLocations();
+    void BuildRegsMap();
+    void CollectSpillStatistics();
+
+private:
+    LivenessAnalyzer *liveness_;
+    const Target *target_;
+    RegMask class_regs_ = 0;
+    RegConstraints constraints_;
+
+    // Indexed by node, a node is the linear number of one of its values. Only elements
+    // of representatives are valid
+    std::vector<LinearNumber> representatives_;
+    std::vector<std::vector<LinearNumber>> neighbors_;
+    // Registers, which are reserved by fixed intervals in life of node
+    std::vector<RegMask> reserved_regs_;
+    std::vector<int32_t> hints_;
+    std::vector<double> spill_costs_;
+    // Current degree, while nodes are removed
+    std::vector<uint32_t> degrees_;
+    std::vector<bool> removed_;
+    // Removed nodes, the last one is colored first
+    std::vector<LinearNumber> select_stack_;
+    std::vector<int32_t> colors_;
+    std::vector<int32_t> stack_locations_;
+    // Nodes are marked in walks over neighbors
+    std::vector<uint32_t> marks_;
+    uint32_t mark_ = 0;
+
+    std::vector<RegMap> regs_map_;
+
+    uint32_t num_spills_ = 0;
+    uint32_t num_stack_locations_ = 0;
+    uint32_t num_interferences_ = 0;
+    uint32_t num_coalesced_moves_ = 0;
+    uint32_t num_stack_uses_ = 0;
+    uint32_t num_rematerializations_ = 0;
+    uint64_t spill_cost_ = 0;
+};
+
+}
@@ -0,0 +1,44 @@
+#include <unordered_set>
+
+#include "gvn.h"
+#include "analysis/rpo.h"
+
+namespace compiler {
+
+namespace {
+
+struct ValueHash {
+    size_t operator()(Inst *inst) const {
+        return inst->GetValueHash();
+    }
+};
+
+struct ValueEqual {
+    bool operator()(Inst *left, Inst *right) const {
+        return left->IsValueEqual(right);
+    }
+};
+
+}  // namespace
+
+void GVN::Run() {
+    ASSERT(!graph_->IsInstsPlaced());
+    num_removed_insts_ = 0;
+    // Inputs are before users, users of removed instructions aren't visited yet
+    auto &rpo_insts = graph_->GetPassManager()->GetAnalysis<RpoInsts>().GetVector();
+    std::unordered_set<Inst *, ValueHash, ValueEqual> values;
+    values.reserve(rpo_insts.size());
+    for (auto inst : rpo_insts) {
+        // Merged instruction is placed above guards of both, where it may trap
+        if (!inst->IsPure() || inst->CanTrap()) {
+            continue;
+        }
+        auto [it, inserted] = values.insert(inst);
+        if (!inserted) {
+            (*it)->ReplaceDataUsers(inst);
+            num_removed_insts_++;
+        }
+    }
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include "graph.h"
+
+namespace compiler {
+
+/*
+ * Global value numbering (Click, "Global Code Motion / Global Value Numbering", 1995).
+ * Equal PURE instructions are merged into one: users of the later one use the first one.
+ * Instructions aren't bound to regions before GCM, so the merged instruction may be in
+ * other branch or loop, GCM places it in the region, which dominates all its users.
+ * Inputs are visited before users, so instructions, which become equal after merge of
+ * their inputs, are merged too. Instructions, which can trap, aren't merged.
+ *
+ * Merged instructions aren't used and GCM doesn't place them, so pass is run before GCM.
+ */
+class GVN
+{
+public:
+    GVN(Graph *graph):
+        graph_(graph) {};
+
+    void Run();
+
+    uint32_t GetNumRemovedInsts() const {
+        return num_removed_insts_;
+    }
+
+    // Data instructions lose users, regions aren't changed
+    static constexpr AnalysisSet PRESERVED_ANALYSES = CFG_ANALYSES;
+
+private:
+    Graph *graph_;
+    uint32_t num_removed_insts_ = 0;
+};
+
+}
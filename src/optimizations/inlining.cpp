@@ -1,5 +1,6 @@
 #include "inlining.h"
 #include "analysis/rpo.h"
+#include "inst_map.h"
 
 namespace compiler {
 
@@ -140,7 +141,8 @@ Inst *Inlining::InsertExternalGraph(Graph *ext_graph) {
     rpo.Run();
     auto rpo_vector = rpo.GetVector();
     std::vector<Inst *> branchs_fill_after;
-    std::map<id_t, id_t> connection_index;
+    // Id of instruction in external graph -> id of its copy
+    InstMap<id_t> connection_index(ext_graph->GetNumInsts());
 
     const id_t offset_index = graph_->GetNumInsts();
     // Exclude Start and End insts (first and last in rpo)
@@ -14,6 +14,9 @@ public:
 
     void Run();
 
+    // Control flow graph is changed
+    static constexpr AnalysisSet PRESERVED_ANALYSES = NO_ANALYSES;
+
 private:
     void TryInlineCalls();
     void FillMapAdditionalGraphs(std::vector<Graph *> &additional_graphs);
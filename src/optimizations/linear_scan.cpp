@@ -3,75 +3,423 @@
 
 namespace compiler {
 
-
 void LinearScanRegAlloc::Run() {
-    for (LinearNumber index = 0; index < regs_map_sorted_begin_.size(); index++) {
-        auto &map = regs_map_sorted_begin_[index];
-        if (map.interval.GetBegin() == map.interval.GetEnd() && map.interval.GetBegin() == 0) {
-            continue;
+    CalcMaxRegisterPressure();
+    spill_weights_.resize(regs_map_sorted_begin_.size());
+    for (RegMapLinkIndex index = 0; index < regs_map_sorted_begin_.size(); index++) {
+        auto &interval = regs_map_sorted_begin_[index].interval;
+        if (!interval.IsEmpty()) {
+            unhandled_.Push(interval.GetBegin(), index);
         }
-        ExpireOldIntervals(map);
+    }
+    while (!unhandled_.Empty()) {
+        auto position = unhandled_.TopPosition();
+        auto index = unhandled_.Pop();
+        ExpireOldIntervals(position);
 
-        if (free_regs_.empty()) {
-            SpillAtInterval(map, index);
+        if (TryAllocateReg(index)) {
+            AddActive(index, position);
         } else {
-            map.location = free_regs_.back();
-            free_regs_.pop_back();
-            action_idx_sorted_end_.push_back(index);
-            SortActionIndexes();
+            SpillAtInterval(index);
         }
     }
+    SortRegsMap();
+    CollectSpillStatistics();
 }
 
-void LinearScanRegAlloc::ExpireOldIntervals([[maybe_unused]]RegMap &map) {
-    for (auto it = action_idx_sorted_end_.begin(); it != action_idx_sorted_end_.end(); it = action_idx_sorted_end_.begin()) {
-        // Yes, it is look strage
-        if (regs_map_sorted_begin_[*it].interval.GetEnd() > map.interval.GetBegin()) {
-            return;
+void LinearScanRegAlloc::ExpireOldIntervals(LifeNumber position) {
+    while (!active_.Empty() && active_.TopPosition() <= position) {
+        auto index = active_.Pop();
+        auto &map = regs_map_sorted_begin_[index];
+        active_regs_ &= ~RegBit(map.location.index);
+        if (map.interval.GetEnd() <= position) {
+            ReleaseLocation(map);
+        } else {
+            // Position is in lifetime hole
+            inactive_.Push(map.interval.NextRangeBound(position), index);
         }
-        if (map.location.is_reg) {
-            free_regs_.push_back(map.location);
+    }
+    while (!inactive_.Empty() && inactive_.TopPosition() <= position) {
+        auto index = inactive_.Pop();
+        auto &map = regs_map_sorted_begin_[index];
+        if (map.interval.GetEnd() <= position) {
+            ReleaseLocation(map);
+        } else if (map.interval.Covers(position)) {
+            AddActive(index, position);
+        } else {
+            inactive_.Push(map.interval.NextRangeBound(position), index);
         }
-        action_idx_sorted_end_.pop_front();
+    }
+    while (!spilled_.Empty() && spilled_.TopPosition() <= position) {
+        ReleaseLocation(regs_map_sorted_begin_[spilled_.Pop()]);
+    }
+}
+
+bool LinearScanRegAlloc::TryAllocateReg(RegMapLinkIndex index) {
+    auto &map = regs_map_sorted_begin_[index];
+    auto &interval = map.interval;
+    auto hint = value_hints_[interval.GetLinearNumber()];
+    // Registers, which aren't taken by other intervals, are limited only by fixed intervals
+    for (auto regs = free_regs_; regs != 0; regs &= regs - 1) {
+        auto reg_index = __builtin_ctzll(regs);
+        reg_free_until_[reg_index] = FindRegConflictFixed(reg_index, interval);
+    }
+    auto best_reg = ChooseReg(free_regs_, hint);
+
+    // Register is taken only by inactive intervals, the new interval is placed in their holes
+    auto inactive_regs = class_regs_ & ~(free_regs_ | active_regs_);
+    if ((best_reg == INVALID_REG || reg_free_until_[best_reg] != INVALID_LIFE_NUMBER) && inactive_regs != 0) {
+        for (auto regs = inactive_regs; regs != 0; regs &= regs - 1) {
+            auto reg_index = __builtin_ctzll(regs);
+            reg_free_until_[reg_index] = FindRegConflictFixed(reg_index, interval);
+        }
+        for (auto &element : inactive_) {
+            auto &inactive = regs_map_sorted_begin_[element.index];
+            auto reg_index = inactive.location.index;
+            if ((inactive_regs & RegBit(reg_index)) != 0) {
+                reg_free_until_[reg_index] = std::min(reg_free_until_[reg_index], inactive.interval.FindIntersection(interval));
+            }
+        }
+        best_reg = ChooseReg(free_regs_ | inactive_regs, hint);
+    }
+    if (best_reg == INVALID_REG || reg_free_until_[best_reg] <= interval.GetBegin() + 1) {
+        return false;
+    }
+    auto free_until = reg_free_until_[best_reg];
+    AssignRegister(map, best_reg);
+    if (free_until != INVALID_LIFE_NUMBER) {
+        // Register is free only for the first part of interval
+        SplitAndRetry(index, FindOptimalSplitPos(interval.GetBegin(), free_until));
+    }
+    return true;
+}
+
+// Hint is taken, if it is free for the whole interval or not worse than others
+int32_t LinearScanRegAlloc::ChooseReg(RegMask candidates, int32_t hint) const {
+    int32_t best_reg = INVALID_REG;
+    if (hint != INVALID_REG && (candidates & RegBit(hint)) != 0) {
+        best_reg = hint;
+        if (reg_free_until_[hint] == INVALID_LIFE_NUMBER) {
+            return best_reg;
+        }
+    }
+    for (auto reg_index : target_->GetAllocationOrder()) {
+        if ((candidates & RegBit(reg_index)) == 0) {
+            continue;
+        }
+        if (best_reg == INVALID_REG || reg_free_until_[reg_index] > reg_free_until_[best_reg]) {
+            best_reg = reg_index;
+            if (reg_free_until_[best_reg] == INVALID_LIFE_NUMBER) {
+                break;
+            }
+        }
+    }
+    return best_reg;
+}
+
+void LinearScanRegAlloc::SpillAtInterval(RegMapLinkIndex index) {
+    auto position = regs_map_sorted_begin_[index].interval.GetBegin();
+    auto use = regs_map_sorted_begin_[index].interval.NextUsePosition(position);
+
+    // Active interval with the smallest spill weight, from equal ones the interval, which is used the last.
+    // It can't be spilled, if it is used right now or its register is reserved by fixed interval right now
+    RegMapLinkIndex spill_index = 0;
+    LifeNumber spill_use = 0;
+    double spill_weight = 0;
+    bool found = false;
+    for (auto &element : active_) {
+        auto &active = regs_map_sorted_begin_[element.index];
+        auto next_use = active.interval.NextUsePosition(position);
+        if (next_use <= position + 1) {
+            continue;
+        }
+        auto weight = GetSpillWeight(element.index);
+        if (found && (weight > spill_weight || (weight == spill_weight && next_use <= spill_use))) {
+            continue;
+        }
+        if (FindRegConflictFixed(active.location.index, regs_map_sorted_begin_[index].interval) > position + 1) {
+            spill_index = element.index;
+            spill_use = next_use;
+            spill_weight = weight;
+            found = true;
+        }
+    }
+
+    auto weight = GetSpillWeight(index);
+    if (!found || weight < spill_weight || (weight == spill_weight && spill_use <= use)) {
+        // The new interval is on stack till its first use
+        if (use != INVALID_LIFE_NUMBER && use > position + 1) {
+            SplitAndRetry(index, FindOptimalSplitPos(position, use - 1));
+        }
+        AssignStackLocation(index);
+        return;
+    }
+
+    auto &spill_interval = regs_map_sorted_begin_[spill_index].interval;
+    // Store is after the last use of spilled interval, but out of loop if it is possible
+    auto prev_use = spill_interval.PrevUsePosition(position);
+    auto min = prev_use == INVALID_LIFE_NUMBER ? spill_interval.GetBegin() :
+                                                 std::max(prev_use, spill_interval.GetBegin());
+    // Interval, which begins in the same position, is spilled fully
+    auto stack_index = spill_index;
+    if (min < position) {
+        stack_index = SplitInterval(spill_index, FindOptimalSplitPos(min, position));
+    }
+    if (spill_use != INVALID_LIFE_NUMBER) {
+        // Reload before the next use
+        SplitAndRetry(stack_index, FindOptimalSplitPos(position, spill_use - 1));
+    }
+    // The new interval takes register of spilled one, number of holders isn't changed
+    auto &map = regs_map_sorted_begin_[index];
+    map.location = regs_map_sorted_begin_[spill_index].location;
+    UpdateHint(map);
+    active_.Remove(spill_index);
+    active_regs_ &= ~RegBit(map.location.index);
+    AssignStackLocation(stack_index);
+
+    // Register can be taken by inactive or fixed interval later
+    auto free_until = std::min(FindRegConflictInactive(map.location.index, map.interval),
+                               FindRegConflictFixed(map.location.index, map.interval));
+    if (free_until != INVALID_LIFE_NUMBER) {
+        SplitAndRetry(index, FindOptimalSplitPos(position, free_until));
+    }
+    AddActive(index, position);
+}
+
+void LinearScanRegAlloc::AssignRegister(RegMap &map, uint32_t reg_index) {
+    map.location = registers_[reg_index];
+    UpdateHint(map);
+    reg_holders_[reg_index]++;
+    free_regs_ &= ~RegBit(reg_index);
+}
+
+// The next parts of value without constraints prefer register of the first part
+void LinearScanRegAlloc::UpdateHint(const RegMap &map) {
+    auto &hint = value_hints_[map.interval.GetLinearNumber()];
+    if (hint == INVALID_REG) {
+        hint = map.location.index;
+    } else if (hint != map.location.index) {
+        num_hint_misses_++;
     }
 }
 
-void LinearScanRegAlloc::SpillAtInterval(RegMap &map, LinearNumber index) {
-    if (regs_map_sorted_begin_[action_idx_sorted_end_.back()].interval.GetEnd() > map.interval.GetEnd()) {
-        map.location = regs_map_sorted_begin_[action_idx_sorted_end_.back()].location;
+void LinearScanRegAlloc::AddActive(RegMapLinkIndex index, LifeNumber position) {
+    auto &map = regs_map_sorted_begin_[index];
+    ASSERT((active_regs_ & RegBit(map.location.index)) == 0);
+    active_regs_ |= RegBit(map.location.index);
+    active_.Push(map.interval.NextRangeBound(position), index);
+}
+
+void LinearScanRegAlloc::AssignStackLocation(RegMapLinkIndex index) {
+    auto &map = regs_map_sorted_begin_[index];
+    if (rematerializable_[map.interval.GetLinearNumber()]) {
+        map.location = RematLocation();
+        return;
+    }
+    auto &location = value_stack_locations_[map.interval.GetLinearNumber()];
+    if (location.index == -1) {
         if (free_stack_location_.empty()) {
             AddNewStackLocation();
         }
-        regs_map_sorted_begin_[action_idx_sorted_end_.back()].location = free_stack_location_.back();
+        location = free_stack_location_.back();
         free_stack_location_.pop_back();
+    }
+    map.location = location;
+    spilled_.Push(map.interval.GetEnd(), index);
+    num_spills_++;
+}
+
+// Register is free, when the last interval, which takes it, is expired
+void LinearScanRegAlloc::ReleaseLocation(RegMap &map) {
+    auto &interval = map.interval;
+    auto &stack_location = value_stack_locations_[interval.GetLinearNumber()];
+    if (stack_location.index != -1 && interval.GetEnd() == value_ends_[interval.GetLinearNumber()]) {
+        // The last part of value
+        free_stack_location_.push_back(StackLocation(stack_location));
+        stack_location = LocationData(-1, "NOT SET", false);
+    }
+    if (!map.location.is_reg) {
+        return;
+    }
+    ASSERT(reg_holders_[map.location.index] > 0);
+    if (--reg_holders_[map.location.index] == 0) {
+        free_regs_ |= RegBit(map.location.index);
+    }
+}
+
+LifeNumber LinearScanRegAlloc::FindRegConflictInactive(int32_t reg_index, const LiveInterval &interval) const {
+    LifeNumber conflict = INVALID_LIFE_NUMBER;
+    for (auto &element : inactive_) {
+        auto &map = regs_map_sorted_begin_[element.index];
+        if (map.location.index == reg_index) {
+            conflict = std::min(conflict, map.interval.FindIntersection(interval));
+        }
+    }
+    return conflict;
+}
 
-        // Remove spilled from active
-        action_idx_sorted_end_.pop_back();
-        action_idx_sorted_end_.push_back(index);
-        SortActionIndexes();
+RegMapLinkIndex LinearScanRegAlloc::SplitInterval(RegMapLinkIndex index, LifeNumber position) {
+    auto child = regs_map_sorted_begin_[index].interval.SplitAt(position);
+    regs_map_sorted_begin_.push_back({std::move(child), LocationData(-1, "NOT SET", false)});
+    num_splits_++;
+    // Weight of the first part is counted again, the rest is weight of the new part
+    auto weight = spill_weights_[index];
+    if (weight.length == 0) {
+        spill_weights_.push_back(weight);
     } else {
-        if (free_stack_location_.empty()) {
-            AddNewStackLocation();
+        CalcSpillWeight(index);
+        spill_weights_.push_back({weight.use_cost - spill_weights_[index].use_cost,
+                                  weight.length - spill_weights_[index].length});
+    }
+    return regs_map_sorted_begin_.size() - 1;
+}
+
+void LinearScanRegAlloc::SplitAndRetry(RegMapLinkIndex index, LifeNumber position) {
+    auto child = SplitInterval(index, position);
+    unhandled_.Push(regs_map_sorted_begin_[child].interval.GetBegin(), child);
+}
+
+/*
+ * Candidates are ends of regions in (min, max], position before the begin of region is free
+ * for moves. The latest end of region with smaller depth is found by link of block, so number
+ * of steps isn't more than loop depth.
+ */
+LifeNumber LinearScanRegAlloc::FindOptimalSplitPos(LifeNumber min, LifeNumber max) const {
+    ASSERT(min < max);
+    auto best = max;
+    // Block, which contains max
+    auto it = std::upper_bound(block_bounds_.begin(), block_bounds_.end(), max,
+        [](LifeNumber pos, const BlockBound &bound) { return pos < bound.begin; });
+    if (it == block_bounds_.begin()) {
+        return best;
+    }
+    for (auto block = (it - 1)->prev_shallower; block != NO_BLOCK; block = block_bounds_[block].prev_shallower) {
+        auto end = block_bounds_[block + 1].begin - 1;
+        if (end <= min) {
+            break;
         }
-        map.location = free_stack_location_.back();
-        free_stack_location_.pop_back();
+        best = end;
+    }
+    return best;
+}
+
+void LinearScanRegAlloc::CalcSpillWeight(RegMapLinkIndex index) {
+    auto &interval = regs_map_sorted_begin_[index].interval;
+    SpillWeight weight {0, 0};
+    for (size_t i = 0; i < interval.NumRanges(); i++) {
+        weight.length += interval.GetRange(i).GetEnd() - interval.GetRange(i).GetBegin();
+    }
+    for (size_t i = 0; i < interval.NumUsePositions(); i++) {
+        weight.use_cost += GetFrequency(block_bounds_, interval.GetUsePosition(i));
+    }
+    spill_weights_[index] = weight;
+}
+
+// Weight is counted, when it is needed at the first time
+double LinearScanRegAlloc::GetSpillWeight(RegMapLinkIndex index) {
+    if (spill_weights_[index].length == 0) {
+        CalcSpillWeight(index);
     }
+    auto &weight = spill_weights_[index];
+    auto density = static_cast<double>(weight.use_cost) / weight.length;
+    // Value is computed again instead of load, it is cheaper
+    return rematerializable_[regs_map_sorted_begin_[index].interval.GetLinearNumber()] ? density / 2 : density;
+}
 
+// Parts of value are sorted by begin, move is in the begin of part, which location differs in kind
+void LinearScanRegAlloc::CollectSpillStatistics() {
+    std::vector<const LocationData *> prev_locations(value_ends_.size(), nullptr);
+    for (auto &map : regs_map_sorted_begin_) {
+        auto &interval = map.interval;
+        if (interval.IsEmpty()) {
+            continue;
+        }
+        auto &prev = prev_locations[interval.GetLinearNumber()];
+        if (map.location.is_remat) {
+            // Value is computed for every use, it isn't memory access
+            num_rematerializations_ += interval.NumUsePositions();
+        } else if (!map.location.is_reg) {
+            if (prev == nullptr || prev->is_reg) {
+                num_spill_stores_++;
+                spill_cost_ += GetFrequency(block_bounds_, interval.GetBegin());
+            }
+            num_stack_uses_ += interval.NumUsePositions();
+            for (size_t i = 0; i < interval.NumUsePositions(); i++) {
+                spill_cost_ += GetFrequency(block_bounds_, interval.GetUsePosition(i));
+            }
+        } else if (prev != nullptr && prev->is_remat) {
+            num_rematerializations_++;
+        } else if (prev != nullptr && !prev->is_reg) {
+            num_reloads_++;
+            spill_cost_ += GetFrequency(block_bounds_, interval.GetBegin());
+        }
+        prev = &map.location;
+    }
 }
 
 void LinearScanRegAlloc::AddNewStackLocation() {
     num_stack_locations_++;
-    free_stack_location_.push_back(StackLocation(num_stack_locations_, std::string("s") + std::to_string(num_stack_locations_)));
+    free_stack_location_.push_back(StackLocation(num_stack_locations_, "stack"));
+}
+
+// Is called before splits, so every RegMap is the whole interval of value
+void LinearScanRegAlloc::CalcMaxRegisterPressure() {
+    // Positions are dense, so changes of pressure are counted in every position without sort
+    std::vector<int32_t> pressure_diff;
+    for (auto &map : regs_map_sorted_begin_) {
+        auto &interval = map.interval;
+        if (interval.IsEmpty()) {
+            continue;
+        }
+        if (pressure_diff.size() <= interval.GetEnd()) {
+            pressure_diff.resize(interval.GetEnd() + 1, 0);
+        }
+        for (size_t i = 0; i < interval.NumRanges(); i++) {
+            pressure_diff[interval.GetRange(i).GetBegin()]++;
+            pressure_diff[interval.GetRange(i).GetEnd()]--;
+        }
+    }
+    int32_t pressure = 0;
+    max_register_pressure_ = 0;
+    for (auto diff : pressure_diff) {
+        pressure += diff;
+        max_register_pressure_ = std::max(max_register_pressure_, static_cast<uint32_t>(pressure));
+    }
 }
 
-void LinearScanRegAlloc::SortActionIndexes() {
-    action_idx_sorted_end_.sort([this](RegMapLinkIndex &left, RegMapLinkIndex &right)
-        {return regs_map_sorted_begin_[left].interval.GetEnd() < regs_map_sorted_begin_[right].interval.GetEnd();});
+// Parts of intervals are added to the end, so RegMaps are sorted by begin and value.
+// Indexes are sorted instead of RegMaps, then every RegMap is moved once
+void LinearScanRegAlloc::SortRegsMap() {
+    std::vector<RegMapLinkIndex> order(regs_map_sorted_begin_.size());
+    for (RegMapLinkIndex i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](RegMapLinkIndex left, RegMapLinkIndex right) {
+        auto &left_interval = regs_map_sorted_begin_[left].interval;
+        auto &right_interval = regs_map_sorted_begin_[right].interval;
+        if (left_interval.GetBegin() != right_interval.GetBegin()) {
+            return left_interval.GetBegin() < right_interval.GetBegin();
+        }
+        return left_interval.GetLinearNumber() < right_interval.GetLinearNumber();
+    });
+    std::vector<RegMap> sorted;
+    sorted.reserve(order.size());
+    for (auto index : order) {
+        sorted.push_back(std::move(regs_map_sorted_begin_[index]));
+    }
+    regs_map_sorted_begin_ = std::move(sorted);
 }
 
 void LinearScanRegAlloc::Dump() {
-    for (auto map : regs_map_sorted_begin_) {
-        std::cerr << "LinNum: " << map.interval.GetLinearNumber() << "(" << map.location.name << ")" << std::endl;
+    for (auto &map : regs_map_sorted_begin_) {
+        std::cerr << "LinNum: " << map.interval.GetLinearNumber() << "(";
+        if (map.location.is_reg || map.location.is_remat) {
+            std::cerr << map.location.name;
+        } else {
+            std::cerr << "s" << map.location.index;
+        }
+        std::cerr << ") ";
+        map.interval.Dump();
     }
 }
 
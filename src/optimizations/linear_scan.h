@@ -1,26 +1,32 @@
 #pragma once
 
-#include <string>
+#include <algorithm>
+#include <cstdint>
 #include <list>
 #include <vector>
 #include "analysis/liveness_analyzer.h"
+#include "reg_constraints.h"
+#include "target.h"
 
 namespace compiler {
 
+// Name of register is owned by Target
 struct LocationData {
-    LocationData(int32_t reg_index, std::string&& reg_name, bool it_is_reg):
+    LocationData(int32_t reg_index, const char *reg_name, bool it_is_reg):
         index(reg_index),
         name(reg_name),
         is_reg(it_is_reg) {};
 
     int32_t index;
-    std::string name;
+    const char *name;
     bool is_reg;
+    // Value isn't stored, it is computed again, where it is needed
+    bool is_remat = false;
 };
 
 struct Register: public LocationData {
-    Register(int32_t reg_index, std::string&& reg_name):
-        LocationData(reg_index, std::move(reg_name), true) {};
+    Register(int32_t reg_index, const char *reg_name):
+        LocationData(reg_index, reg_name, true) {};
 
     Register(LocationData &location):
         LocationData(location) {
@@ -29,8 +35,8 @@ struct Register: public LocationData {
 };
 
 struct StackLocation: public LocationData {
-    StackLocation(int32_t reg_index, std::string&& reg_name):
-        LocationData(reg_index, std::move(reg_name), false) {};
+    StackLocation(int32_t reg_index, const char *reg_name):
+        LocationData(reg_index, reg_name, false) {};
 
     StackLocation(LocationData &location):
         LocationData(location) {
@@ -38,6 +44,13 @@ struct StackLocation: public LocationData {
         };
 };
 
+struct RematLocation: public LocationData {
+    RematLocation():
+        LocationData(-1, "remat", false) {
+            is_remat = true;
+        };
+};
+
 struct RegMap {
     LiveInterval interval;
     LocationData location;
@@ -45,45 +58,279 @@ struct RegMap {
 
 using RegMapLinkIndex = LinearNumber;
 
+/*
+ * Min-heap of intervals by position, where interval should be moved to other set
+ * (begin for unhandled, end of range for active, begin of the next range for inactive).
+ * Intervals with the same position are ordered by index, so result doesn't depend on heap.
+ * Elements can be iterated in any order.
+ */
+class IntervalHeap {
+public:
+    struct Element {
+        LifeNumber position;
+        RegMapLinkIndex index;
+    };
+
+    void Push(LifeNumber position, RegMapLinkIndex index) {
+        elements_.push_back({position, index});
+        std::push_heap(elements_.begin(), elements_.end(), Greater);
+    }
+
+    RegMapLinkIndex Pop() {
+        std::pop_heap(elements_.begin(), elements_.end(), Greater);
+        auto index = elements_.back().index;
+        elements_.pop_back();
+        return index;
+    }
+
+    LifeNumber TopPosition() const {
+        ASSERT(!elements_.empty());
+        return elements_.front().position;
+    }
+
+    bool Empty() const {
+        return elements_.empty();
+    }
+
+    // Linear search, is used for small heaps only
+    void Remove(RegMapLinkIndex index) {
+        auto it = std::find_if(elements_.begin(), elements_.end(), [index](const Element &element) {
+            return element.index == index;
+        });
+        ASSERT(it != elements_.end());
+        *it = elements_.back();
+        elements_.pop_back();
+        std::make_heap(elements_.begin(), elements_.end(), Greater);
+    }
+
+    std::vector<Element>::const_iterator begin() const {
+        return elements_.begin();
+    }
+
+    std::vector<Element>::const_iterator end() const {
+        return elements_.end();
+    }
+
+private:
+    static bool Greater(const Element &left, const Element &right) {
+        return left.position > right.position || (left.position == right.position && left.index > right.index);
+    }
+
+    std::vector<Element> elements_;
+};
+
+/*
+ * Linear scan on intervals with lifetime holes (Wimmer, "Linear Scan Register Allocation
+ * on SSA Form"). Interval is "active", if it covers current position, and "inactive",
+ * if current position is in its hole. Register of inactive interval is given to other
+ * interval, which ends before the hole is finished.
+ *
+ * Interval, which doesn't get register, is split: the part till the next use is on stack,
+ * the rest gets the second chance for register (reload before the use). Interval with
+ * the smallest spill weight is spilled: use in loop costs 10^depth, sum of costs is divided
+ * by length of interval, so rarely used values are spilled first. Rematerializable values
+ * (constants) aren't stored on stack, they are computed again before use, so their
+ * weight is smaller. Split positions
+ * are moved to begins of regions with smaller loop depth, so spills and reloads are out
+ * of hot loops. All parts of value use the same stack location.
+ * Result has a RegMap for every part of interval, they are sorted by begin.
+ *
+ * Sets of intervals are heaps by position of the next change, so interval is touched
+ * only when it begins, ends or enters or leaves its hole. Free registers are bit mask.
+ *
+ * Registers and calling convention are taken from Target, fixed intervals and hints
+ * are built by BuildRegConstraints.
+ */
 class LinearScanRegAlloc {
 public:
-    LinearScanRegAlloc(std::vector<LiveInterval>& intervals):
-        live_intervals_(intervals) {
+    // Intervals are ordered by unhandled heap, RegMaps are sorted after Run.
+    // Instructions aren't known here, so there are no fixed intervals and hints
+    LinearScanRegAlloc(std::vector<LiveInterval>& intervals, const Target &target):
+        target_(&target),
+        value_stack_locations_(intervals.size(), LocationData(-1, "NOT SET", false)) {
 
         auto num_linear_inst = intervals.size();
         regs_map_sorted_begin_.reserve(num_linear_inst);
+        value_ends_.reserve(num_linear_inst);
         for (LinearNumber j = 0; j < num_linear_inst; j++) {
             regs_map_sorted_begin_.push_back({intervals[j], LocationData(-1, "NOT SET", false)});
+            value_ends_.push_back(intervals[j].GetEnd());
         }
-        std::sort(regs_map_sorted_begin_.begin(), regs_map_sorted_begin_.end(),
-            [](RegMap &left, RegMap &right) {return left.interval.GetBegin() < right.interval.GetBegin();});
 
+        num_regs_ = target.GetNumRegs();
         for (uint32_t i = 0; i < num_regs_; i++) {
-            free_regs_.push_back(Register(i, std::string("x") + std::to_string(i)));
+            registers_.push_back(Register(i, target.GetRegName(i)));
         }
+        // Values of IR are integer, so all of them are in general purpose registers
+        class_regs_ = target.GetAllocatableRegs(RegClass::GPR);
+        free_regs_ = class_regs_;
+        reg_holders_.resize(num_regs_, 0);
+        reg_free_until_.resize(num_regs_);
+        fixed_intervals_.resize(num_regs_);
+        value_hints_.resize(num_linear_inst, INVALID_REG);
+        rematerializable_.resize(num_linear_inst, false);
+    }
+
+    // Split positions are chosen with loop depth of regions, constraints are taken from instructions
+    LinearScanRegAlloc(LivenessAnalyzer &liveness, const Target &target):
+        LinearScanRegAlloc(liveness.GetLiveIntervals(), target) {
+        block_bounds_ = liveness.GetBlockBounds();
+        auto constraints = BuildRegConstraints(liveness.GetLinearRegions(), regs_map_sorted_begin_.size(), target);
+        fixed_intervals_ = std::move(constraints.fixed_intervals);
+        value_hints_ = std::move(constraints.hints);
+        rematerializable_ = std::move(constraints.rematerializable);
     }
 
     std::vector<RegMap>& GetRegsMap() {
         return regs_map_sorted_begin_;
     }
 
+    const Target &GetTarget() const {
+        return *target_;
+    }
+
     void Run();
 
+    // Statistics of the last Run
+    // Number of parts of intervals on stack
+    uint32_t GetNumSpills() const {
+        return num_spills_;
+    }
+
+    uint32_t GetNumSplits() const {
+        return num_splits_;
+    }
+
+    uint32_t GetNumStackLocations() const {
+        return num_stack_locations_;
+    }
+
+    // Max number of values, which are live in the same position
+    uint32_t GetMaxRegisterPressure() const {
+        return max_register_pressure_;
+    }
+
+    // Parts of intervals with hint, which got other register
+    uint32_t GetNumHintMisses() const {
+        return num_hint_misses_;
+    }
+
+    // Moves between register and stack, when part of value is changed
+    uint32_t GetNumSpillStores() const {
+        return num_spill_stores_;
+    }
+
+    uint32_t GetNumReloads() const {
+        return num_reloads_;
+    }
+
+    // Uses of values, which are on stack in place of use
+    uint32_t GetNumStackUses() const {
+        return num_stack_uses_;
+    }
+
+    // Values, which are computed again before part in register or before use
+    uint32_t GetNumRematerializations() const {
+        return num_rematerializations_;
+    }
+
+    // Stores, reloads and stack uses, each costs 10^(loop depth)
+    uint64_t GetSpillCost() const {
+        return spill_cost_;
+    }
+
+    const LiveInterval &GetFixedInterval(int32_t reg_index) const {
+        return fixed_intervals_[reg_index];
+    }
+
 private:
-    void ExpireOldIntervals(RegMap &map);
-    void SpillAtInterval(RegMap &map, LinearNumber index);
+    void ExpireOldIntervals(LifeNumber position);
+    bool TryAllocateReg(RegMapLinkIndex index);
+    // Candidate with the latest reg_free_until_, hint is preferred
+    int32_t ChooseReg(RegMask candidates, int32_t hint) const;
+    void SpillAtInterval(RegMapLinkIndex index);
+    void AssignRegister(RegMap &map, uint32_t reg_index);
+    void UpdateHint(const RegMap &map);
+    void AddActive(RegMapLinkIndex index, LifeNumber position);
+    // Stack location or rematerialization
+    void AssignStackLocation(RegMapLinkIndex index);
+    void ReleaseLocation(RegMap &map);
+    // The first position, where interval intersects inactive intervals with the register
+    LifeNumber FindRegConflictInactive(int32_t reg_index, const LiveInterval &interval) const;
+    LifeNumber FindRegConflictFixed(int32_t reg_index, const LiveInterval &interval) const {
+        return fixed_intervals_[reg_index].FindIntersection(interval);
+    }
+    // Returns index of the new part
+    RegMapLinkIndex SplitInterval(RegMapLinkIndex index, LifeNumber position);
+    void SplitAndRetry(RegMapLinkIndex index, LifeNumber position);
+    // Position in (min, max] with the smallest loop depth, the latest of them
+    LifeNumber FindOptimalSplitPos(LifeNumber min, LifeNumber max) const;
+    void CalcSpillWeight(RegMapLinkIndex index);
+    double GetSpillWeight(RegMapLinkIndex index);
+    void CollectSpillStatistics();
     void AddNewStackLocation();
-    void SortActionIndexes();
+    void CalcMaxRegisterPressure();
+    void SortRegsMap();
     void Dump();
 
+    static RegMask RegBit(int32_t reg_index) {
+        return RegMask(1) << reg_index;
+    }
+
+    // Sum of frequencies of uses and number of covered positions of part of interval
+    struct SpillWeight {
+        uint64_t use_cost;
+        LifeNumber length;
+    };
+
 private:
-    std::list<Register> free_regs_;
-    uint32_t num_regs_ = 3;
+    const Target *target_;
+    uint32_t num_regs_ = 0;
+    std::vector<Register> registers_;
+    // Registers, which are allocated
+    RegMask class_regs_ = 0;
+    // Registers, which aren't taken by active and inactive intervals
+    RegMask free_regs_ = 0;
+    // Registers of active intervals, one active interval per register
+    RegMask active_regs_ = 0;
+    // Number of active and inactive intervals with the register
+    std::vector<uint32_t> reg_holders_;
+    std::vector<LifeNumber> reg_free_until_;
+    // Positions, where register is reserved by instructions, are built from the last one
+    std::vector<LiveInterval> fixed_intervals_;
+    // Preferred register of value by linear number, the register of the first part is taken,
+    // if value has no constraints
+    std::vector<int32_t> value_hints_;
+    // By linear number
+    std::vector<bool> rematerializable_;
+
     uint32_t num_stack_locations_ = 0;
     std::list<StackLocation> free_stack_location_;
-    std::vector<LiveInterval> live_intervals_;
+    // End of the last part of value by linear number
+    std::vector<LifeNumber> value_ends_;
+    std::vector<BlockBound> block_bounds_;
     std::vector<RegMap> regs_map_sorted_begin_;
-    std::list<RegMapLinkIndex> action_idx_sorted_end_;
+    // Indexes in regs_map_sorted_begin_
+    IntervalHeap unhandled_;
+    IntervalHeap active_;
+    IntervalHeap inactive_;
+    // Parts of intervals on stack, by end. Rematerialized parts have no location to release
+    IntervalHeap spilled_;
+    // Stack location of value by linear number, is released after the last part of value
+    std::vector<LocationData> value_stack_locations_;
+    // Indexed as regs_map_sorted_begin_, is valid till the end of allocation. Zero length
+    // means, that weight isn't counted yet
+    std::vector<SpillWeight> spill_weights_;
+
+    uint32_t num_spills_ = 0;
+    uint32_t num_splits_ = 0;
+    uint32_t max_register_pressure_ = 0;
+    uint32_t num_hint_misses_ = 0;
+    uint32_t num_spill_stores_ = 0;
+    uint32_t num_reloads_ = 0;
+    uint32_t num_stack_uses_ = 0;
+    uint32_t num_rematerializations_ = 0;
+    uint64_t spill_cost_ = 0;
 };
 
 }
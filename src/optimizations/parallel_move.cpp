@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "parallel_move.h"
+
+namespace compiler {
+
+namespace {
+
+void DumpLocation(const LocationData &location, std::ostream &out) {
+    if (location.is_reg || location.is_remat) {
+        out << location.name;
+    } else {
+        out << "s" << location.index;
+    }
+}
+
+}  // namespace
+
+void DumpMove(const Move &move, std::ostream &out) {
+    out << (move.kind == MoveKind::MOVE ? "move " : "swap ");
+    DumpLocation(move.from, out);
+    out << (move.kind == MoveKind::MOVE ? " -> " : " <-> ");
+    DumpLocation(move.to, out);
+    if (move.value != nullptr) {
+        out << " (v" << move.value->GetId() << ")";
+    }
+    out << "\n";
+}
+
+/*
+ * Move is done, when its destination isn't read by other pending moves. If there is
+ * no such move, every pending move is in a cycle, one of cycles is broken.
+ * Number of moves of one position is small, so search is linear.
+ */
+void ParallelMoveResolver::Resolve(const std::vector<Move> &moves, std::vector<Move> *result) {
+    pending_.clear();
+    for (auto &move : moves) {
+        ASSERT(move.kind == MoveKind::MOVE);
+        // Value leaves location, nothing is written for rematerialized part
+        if (move.to.is_remat || IsSameLocation(move.from, move.to)) {
+            continue;
+        }
+        ASSERT(std::none_of(pending_.begin(), pending_.end(), [&move](const Move &other) {
+            return IsSameLocation(other.to, move.to);
+        }));
+        pending_.push_back(move);
+    }
+
+    while (!pending_.empty()) {
+        auto ready = std::find_if(pending_.begin(), pending_.end(), [this](const Move &move) {
+            return !IsReadByPending(move.to);
+        });
+        if (ready == pending_.end()) {
+            BreakCycle(result);
+            continue;
+        }
+        result->push_back(*ready);
+        pending_.erase(ready);
+    }
+}
+
+bool ParallelMoveResolver::IsReadByPending(const LocationData &location) const {
+    return std::any_of(pending_.begin(), pending_.end(), [&location](const Move &move) {
+        return IsSameLocation(move.from, location);
+    });
+}
+
+void ParallelMoveResolver::BreakCycle(std::vector<Move> *result) {
+    // Swap of register with register or stack is one instruction
+    auto with_reg = std::find_if(pending_.begin(), pending_.end(), [](const Move &move) {
+        return move.from.is_reg || move.to.is_reg;
+    });
+    auto scratch = target_->GetScratchReg();
+    if (with_reg == pending_.end() && scratch != INVALID_REG) {
+        // Destination of the move is saved in scratch, then the move isn't blocked
+        auto blocked = pending_.front().to;
+        LocationData scratch_location = Register(scratch, target_->GetRegName(scratch));
+        auto reader = std::find_if(pending_.begin(), pending_.end(), [&blocked](const Move &move) {
+            return IsSameLocation(move.from, blocked);
+        });
+        ASSERT(reader != pending_.end());
+        result->push_back({MoveKind::MOVE, reader->value, blocked, scratch_location});
+        for (auto &move : pending_) {
+            if (IsSameLocation(move.from, blocked)) {
+                move.from = scratch_location;
+            }
+        }
+        num_scratch_moves_++;
+        return;
+    }
+
+    auto swapped = with_reg == pending_.end() ? pending_.begin() : with_reg;
+    auto move = *swapped;
+    pending_.erase(swapped);
+    result->push_back({MoveKind::SWAP, move.value, move.from, move.to});
+    num_swaps_++;
+    // "to" has value of "from" and "from" has old value of "to"
+    for (auto &other : pending_) {
+        if (IsSameLocation(other.from, move.to)) {
+            other.from = move.from;
+        } else if (IsSameLocation(other.from, move.from)) {
+            other.from = move.to;
+        }
+    }
+    // Move of the cycle to "from" is done by swap
+    pending_.erase(std::remove_if(pending_.begin(), pending_.end(), [](const Move &other) {
+        return IsSameLocation(other.from, other.to);
+    }), pending_.end());
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "linear_scan.h"
+
+namespace compiler {
+
+enum class MoveKind {
+    // "to" gets value of "from", rematerialized value is computed again in "to"
+    MOVE,
+    // "from" and "to" exchange values
+    SWAP,
+};
+
+// "value" is the value, which is moved to "to", it is used to compute rematerialized value
+struct Move {
+    MoveKind kind;
+    Inst *value;
+    LocationData from;
+    LocationData to;
+};
+
+// Rematerialized value has no location, it is never the same as other one
+inline bool IsSameLocation(const LocationData &left, const LocationData &right) {
+    return !left.is_remat && !right.is_remat && left.is_reg == right.is_reg && left.index == right.index;
+}
+
+void DumpMove(const Move &move, std::ostream &out);
+
+/*
+ * Moves of one position are parallel: all sources are read before any destination
+ * is written. Resolver orders them, so that location is written after all its reads.
+ * Cycles like "r0 -> r1, r1 -> r0" are broken by swap, if one of locations is register.
+ * Cycle of stack locations is broken by move to scratch register of target, or by swap
+ * of stack locations, if target has no scratch. Move from stack to stack is left as is,
+ * it doesn't need register on x86-64 (push and pop).
+ */
+class ParallelMoveResolver {
+public:
+    explicit ParallelMoveResolver(const Target &target):
+        target_(&target) {}
+
+    // Every location is destination of one move at most. Sequential moves are appended to "result"
+    void Resolve(const std::vector<Move> &moves, std::vector<Move> *result);
+
+    // Statistics of all resolved moves
+    uint32_t GetNumSwaps() const {
+        return num_swaps_;
+    }
+
+    uint32_t GetNumScratchMoves() const {
+        return num_scratch_moves_;
+    }
+
+private:
+    bool IsReadByPending(const LocationData &location) const;
+    void BreakCycle(std::vector<Move> *result);
+
+private:
+    const Target *target_;
+    std::vector<Move> pending_;
+
+    uint32_t num_swaps_ = 0;
+    uint32_t num_scratch_moves_ = 0;
+};
+
+}
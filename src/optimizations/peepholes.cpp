@@ -7,9 +7,8 @@
 namespace compiler {
 
 void Peepholes::Run() {
-    auto rpo = RpoInsts(graph_);
-    rpo.Run();
-    auto rpo_vector = rpo.GetVector();
+    // Copy, because graph is changed during iteration
+    auto rpo_vector = graph_->GetPassManager()->GetAnalysis<RpoInsts>().GetVector();
     for (auto inst : rpo_vector) {
         AnalysisInst(inst);
     }
@@ -26,6 +25,15 @@ void Peepholes::AnalysisInst(Inst *inst) {
         case Opcode::Or:
             VisitOr(inst);
             break;
+        // Only constant folding is applied
+        case Opcode::Add:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Shr:
+        case Opcode::And:
+        case Opcode::Compare:
+            ConstFoldingBinaryOp(graph_, inst);
+            break;
         default:
             break;
     }
@@ -11,6 +11,9 @@ public:
 
     void Run();
 
+    // Only data instructions are changed
+    static constexpr AnalysisSet PRESERVED_ANALYSES = CFG_ANALYSES;
+
 private:
     void AnalysisInst(Inst *inst);
 
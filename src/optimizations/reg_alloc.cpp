@@ -0,0 +1,36 @@
+#include "reg_alloc.h"
+
+namespace compiler {
+
+void RegAlloc::Run() {
+    ASSERT(graph_->IsInstsPlaced());
+    auto &liveness = graph_->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+    switch (kind_) {
+        case RegAllocKind::LINEAR_SCAN:
+            linear_scan_ = std::make_unique<LinearScanRegAlloc>(liveness, *target_);
+            linear_scan_->Run();
+            break;
+        case RegAllocKind::GRAPH_COLORING:
+            graph_coloring_ = std::make_unique<GraphColoringRegAlloc>(liveness, *target_);
+            graph_coloring_->Run();
+            break;
+        default:
+            UNREACHABLE();
+    }
+    ssa_deconstruction_ = std::make_unique<SsaDeconstruction>(graph_, liveness, GetRegsMap(), *target_);
+    ssa_deconstruction_->Run();
+}
+
+std::vector<RegMap> &RegAlloc::GetRegsMap() {
+    return linear_scan_ != nullptr ? linear_scan_->GetRegsMap() : graph_coloring_->GetRegsMap();
+}
+
+uint32_t RegAlloc::GetNumSpills() const {
+    return linear_scan_ != nullptr ? linear_scan_->GetNumSpills() : graph_coloring_->GetNumSpills();
+}
+
+uint64_t RegAlloc::GetSpillCost() const {
+    return linear_scan_ != nullptr ? linear_scan_->GetSpillCost() : graph_coloring_->GetSpillCost();
+}
+
+}
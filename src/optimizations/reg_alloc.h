@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "graph.h"
+#include "graph_coloring.h"
+#include "linear_scan.h"
+#include "ssa_deconstruction.h"
+
+namespace compiler {
+
+/*
+ * Register allocation of method and lowering of Phi to moves. Allocator is chosen in
+ * pipeline of the graph ("regalloc=graph_coloring"), so hot methods can take the slower
+ * allocator with better result. Instructions should be placed by GCM.
+ * Edges can be split by SsaDeconstruction, analyses of graph aren't valid after Run.
+ */
+class RegAlloc {
+public:
+    RegAlloc(Graph *graph, const Target &target):
+        graph_(graph),
+        target_(&target),
+        kind_(graph->GetPassManager()->GetRegAllocKind()) {}
+
+    void Run();
+
+    RegAllocKind GetKind() const {
+        return kind_;
+    }
+
+    std::vector<RegMap> &GetRegsMap();
+
+    const SsaDeconstruction &GetSsaDeconstruction() const {
+        return *ssa_deconstruction_;
+    }
+
+    // Parts of intervals on stack
+    uint32_t GetNumSpills() const;
+    uint64_t GetSpillCost() const;
+
+private:
+    Graph *graph_;
+    const Target *target_;
+    RegAllocKind kind_;
+    // One of allocators is used
+    std::unique_ptr<LinearScanRegAlloc> linear_scan_;
+    std::unique_ptr<GraphColoringRegAlloc> graph_coloring_;
+    std::unique_ptr<SsaDeconstruction> ssa_deconstruction_;
+};
+
+}
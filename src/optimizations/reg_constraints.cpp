@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "reg_constraints.h"
+
+namespace compiler {
+
+namespace {
+
+// Definition is stronger than use, hint of use is set only if there is no other
+void SetHint(RegConstraints *constraints, Inst *inst, int32_t reg_index, bool is_def) {
+    if (reg_index == INVALID_REG) {
+        return;
+    }
+    auto &hint = constraints->hints[inst->GetLinearNumber()];
+    if (is_def || hint == INVALID_REG) {
+        hint = reg_index;
+    }
+}
+
+}  // namespace
+
+/*
+ * Regions are walked from the last one, so ranges of fixed intervals are added
+ * from the last one too. Use of Call is at the position of Call, value of Call is defined
+ * in the same position, so return register is reserved right before it and other
+ * caller-saved registers from it.
+ */
+RegConstraints BuildRegConstraints(const std::vector<RegionInst *> &linear_regions, size_t num_values,
+                                   const Target &target) {
+    RegConstraints constraints;
+    constraints.fixed_intervals.resize(target.GetNumRegs());
+    constraints.hints.resize(num_values, INVALID_REG);
+    constraints.rematerializable.resize(num_values, false);
+
+    auto return_reg = target.GetReturnReg();
+    auto clobbered_regs = target.GetCallerSavedRegs();
+    if (return_reg != INVALID_REG) {
+        clobbered_regs &= ~(RegMask(1) << return_reg);
+    }
+    for (auto it = linear_regions.rbegin(); it != linear_regions.rend(); it++) {
+        auto region = *it;
+        if (region->GetOpcode() == Opcode::End) {
+            continue;
+        }
+        for (Inst *inst = region->GetLast(); inst != nullptr; inst = inst->GetPrev()) {
+            auto life_number = inst->GetLifeNumber();
+            if (inst->IsRematerializable()) {
+                constraints.rematerializable[inst->GetLinearNumber()] = true;
+            }
+            switch (inst->GetOpcode()) {
+                case Opcode::Call: {
+                    if (return_reg != INVALID_REG) {
+                        constraints.fixed_intervals[return_reg].AddRange(life_number - 1, life_number);
+                    }
+                    for (auto regs = clobbered_regs; regs != 0; regs &= regs - 1) {
+                        constraints.fixed_intervals[__builtin_ctzll(regs)].AddRange(life_number, life_number + 1);
+                    }
+                    SetHint(&constraints, inst, return_reg, true);
+                    auto num_inputs = inst->NumDataInputs();
+                    for (id_t i = 0; i < num_inputs; i++) {
+                        SetHint(&constraints, inst->GetDataInput(i), target.GetParamReg(i), false);
+                    }
+                    break;
+                }
+                case Opcode::Parameter: {
+                    // Register of parameter isn't given to values, which are defined before it
+                    auto reg_index = target.GetParamReg(inst->CastToParameter()->GetIndexParam());
+                    if (reg_index != INVALID_REG) {
+                        constraints.fixed_intervals[reg_index].AddRange(region->GetLifeNumber(), life_number);
+                    }
+                    SetHint(&constraints, inst, reg_index, true);
+                    break;
+                }
+                case Opcode::Return:
+                    SetHint(&constraints, inst->GetDataInput(0), return_reg, false);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    return constraints;
+}
+
+uint32_t GetLoopDepth(const std::vector<BlockBound> &block_bounds, LifeNumber position) {
+    auto it = std::upper_bound(block_bounds.begin(), block_bounds.end(), position,
+        [](LifeNumber pos, const BlockBound &bound) { return pos < bound.begin; });
+    return it == block_bounds.begin() ? 0 : (it - 1)->loop_depth;
+}
+
+uint64_t GetFrequency(const std::vector<BlockBound> &block_bounds, LifeNumber position) {
+    auto depth = std::min(GetLoopDepth(block_bounds, position), MAX_FREQUENCY_LOOP_DEPTH);
+    uint64_t frequency = 1;
+    for (uint32_t i = 0; i < depth; i++) {
+        frequency *= 10;
+    }
+    return frequency;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "analysis/liveness_analyzer.h"
+#include "target.h"
+
+namespace compiler {
+
+/*
+ * Constraints of calling convention, which are common for register allocators.
+ * Fixed interval of register covers positions, where register can't hold other values:
+ * caller-saved registers at Call, register of parameter before the parameter is defined.
+ * Parameters, results of Call, arguments of Call and values of Return get hint of their
+ * register, so they are placed there without moves, if the register is free.
+ */
+struct RegConstraints {
+    // By register index
+    std::vector<LiveInterval> fixed_intervals;
+    // Preferred register by linear number, INVALID_REG if value has no constraints
+    std::vector<int32_t> hints;
+    // By linear number, value is computed again instead of load from stack
+    std::vector<bool> rematerializable;
+};
+
+RegConstraints BuildRegConstraints(const std::vector<RegionInst *> &linear_regions, size_t num_values,
+                                   const Target &target);
+
+// Frequency of deeper loops is the same, so sums of frequencies don't overflow
+constexpr uint32_t MAX_FREQUENCY_LOOP_DEPTH = 9;
+
+uint32_t GetLoopDepth(const std::vector<BlockBound> &block_bounds, LifeNumber position);
+
+// Estimation of number of executions of position, 10^(loop depth)
+uint64_t GetFrequency(const std::vector<BlockBound> &block_bounds, LifeNumber position);
+
+}
@@ -0,0 +1,361 @@
+#include "sccp.h"
+#include "constant_folding.h"
+
+namespace compiler {
+
+void SCCP::Run() {
+    ASSERT(!graph_->IsInstsPlaced());
+    num_insts_ = graph_->GetNumInsts();
+    values_ = InstMap<LatticeValue>(num_insts_);
+    executable_edges_ = InstMap<uint8_t>(num_insts_, 0);
+    reachable_ = InstMap<uint8_t>(num_insts_, 0);
+    regions_ = InstMap<RegionInst *>(num_insts_, nullptr);
+    reachable_regions_.clear();
+    cfg_worklist_.clear();
+    ssa_worklist_.clear();
+    maybe_unused_.clear();
+    num_folded_insts_ = 0;
+    num_folded_branches_ = 0;
+    num_removed_regions_ = 0;
+
+    for (auto inst : graph_->GetAllInsts()) {
+        if (inst == nullptr) {
+            continue;
+        }
+        if (inst->IsConst()) {
+            SetValue(inst, {LatticeValue::CONSTANT, inst->CastToConstant()->GetImm()});
+        } else if (inst->GetOpcode() == Opcode::Parameter) {
+            SetValue(inst, {LatticeValue::OVERDEFINED, 0});
+        }
+    }
+    MarkRegionReachable(graph_->GetStartRegion());
+    // Worklists instead of recursion, paths in graph may be long
+    while (!cfg_worklist_.empty() || !ssa_worklist_.empty()) {
+        if (!cfg_worklist_.empty()) {
+            auto [exit, successor] = cfg_worklist_.back();
+            cfg_worklist_.pop_back();
+            auto region = exit->GetControlUsers()[successor]->CastToRegion();
+            if (reachable_[region] == 0) {
+                MarkRegionReachable(region);
+                continue;
+            }
+            // New edge is met in Phi
+            for (Inst *inst = region->GetControlUser(); inst != nullptr && inst->IsPhi(); inst = inst->GetControlUser()) {
+                VisitPhi(inst);
+            }
+            continue;
+        }
+        auto inst = ssa_worklist_.back();
+        ssa_worklist_.pop_back();
+        VisitInst(inst);
+    }
+
+    RemoveNotExecutableEdges();
+    FoldBranches();
+    DeleteUnreachableInsts();
+    ReplaceConstants();
+    RemoveRedundantPhis();
+    DeleteUnusedInsts();
+}
+
+void SCCP::MarkEdgeExecutable(Inst *exit, uint32_t successor) {
+    auto bit = static_cast<uint8_t>(1U << successor);
+    if ((executable_edges_[exit] & bit) != 0) {
+        return;
+    }
+    executable_edges_[exit] |= bit;
+    cfg_worklist_.emplace_back(exit, successor);
+}
+
+void SCCP::MarkRegionReachable(RegionInst *region) {
+    reachable_[region] = 1;
+    reachable_regions_.push_back(region);
+    if (region->GetOpcode() == Opcode::End) {
+        return;
+    }
+    for (Inst *inst = region->GetControlUser();; inst = inst->GetControlUser()) {
+        reachable_[inst] = 1;
+        regions_[inst] = region;
+        VisitInst(inst);
+        if (inst->IsTerminator()) {
+            break;
+        }
+    }
+}
+
+// Start is input of region only in inlined graphs, it is always reachable
+bool SCCP::IsEdgeExecutable(RegionInst *region, id_t index) {
+    auto pred = region->GetRegionInput(index);
+    if (pred->IsRegion()) {
+        return reachable_[pred] != 0;
+    }
+    auto successors = pred->GetControlUsers();
+    for (uint32_t i = 0; i < successors.size(); i++) {
+        if (successors[i] == region && (executable_edges_[pred] & (1U << i)) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SCCP::VisitInst(Inst *inst) {
+    // Instruction of control chain is evaluated, when its region is reached
+    if (inst->HasControlProp() && reachable_[inst] == 0) {
+        return;
+    }
+    switch (inst->GetOpcode()) {
+        case Opcode::Phi:
+            VisitPhi(inst);
+            break;
+        case Opcode::If:
+            VisitIf(inst);
+            break;
+        case Opcode::Jump:
+            MarkEdgeExecutable(inst, 0);
+            break;
+        default:
+            SetValue(inst, inst->IsPure() ? EvaluatePure(inst) : LatticeValue {LatticeValue::OVERDEFINED, 0});
+            break;
+    }
+}
+
+void SCCP::VisitPhi(Inst *phi) {
+    auto region = regions_[phi];
+    LatticeValue value;
+    auto num_inputs = phi->NumDataInputs();
+    for (id_t i = 0; i < num_inputs; i++) {
+        if (!IsEdgeExecutable(region, i)) {
+            continue;
+        }
+        auto input = values_[phi->GetDataInput(i)];
+        if (input.kind == LatticeValue::UNDEFINED || input == value) {
+            continue;
+        }
+        if (value.kind != LatticeValue::UNDEFINED || input.kind == LatticeValue::OVERDEFINED) {
+            value = {LatticeValue::OVERDEFINED, 0};
+            break;
+        }
+        value = input;
+    }
+    SetValue(phi, value);
+}
+
+// True branch is the first successor
+void SCCP::VisitIf(Inst *inst) {
+    auto condition = values_[inst->GetDataInput(0)];
+    switch (condition.kind) {
+        case LatticeValue::UNDEFINED:
+            break;
+        case LatticeValue::CONSTANT:
+            MarkEdgeExecutable(inst, condition.imm != 0 ? 0 : 1);
+            break;
+        case LatticeValue::OVERDEFINED:
+            MarkEdgeExecutable(inst, 0);
+            MarkEdgeExecutable(inst, 1);
+            break;
+    }
+}
+
+SCCP::LatticeValue SCCP::EvaluatePure(Inst *inst) {
+    ASSERT(inst->NumDataInputs() == 2);
+    bool undefined = false;
+    for (auto input : inst->GetDataInputs()) {
+        auto kind = values_[input].kind;
+        if (kind == LatticeValue::OVERDEFINED) {
+            return {LatticeValue::OVERDEFINED, 0};
+        }
+        undefined |= kind == LatticeValue::UNDEFINED;
+    }
+    if (undefined) {
+        return {};
+    }
+    auto input0 = inst->GetDataInput(0);
+    auto imm0 = values_[input0].imm;
+    auto imm1 = values_[inst->GetDataInput(1)].imm;
+    ImmType result = 0;
+    bool folded = inst->GetOpcode() == Opcode::Compare
+        ? EvaluateCompare(inst->CastToCompare()->GetCC(), input0->GetType(), imm0, imm1, &result)
+        : EvaluateBinaryOp(inst->GetOpcode(), inst->GetType(), imm0, imm1, &result);
+    // E.g. division by zero is left for runtime
+    if (!folded) {
+        return {LatticeValue::OVERDEFINED, 0};
+    }
+    return {LatticeValue::CONSTANT, result};
+}
+
+void SCCP::SetValue(Inst *inst, LatticeValue value) {
+    auto &old_value = values_[inst];
+    if (old_value == value) {
+        return;
+    }
+    ASSERT(old_value.kind < value.kind);
+    old_value = value;
+    for (auto user : inst->GetDataUsers()) {
+        ssa_worklist_.push_back(user);
+    }
+}
+
+// Input of Phi is removed together with the edge
+void SCCP::RemoveRegionInput(RegionInst *region, id_t index) {
+    region->GetRegionInput(index)->DeleteRawUser(region, index);
+    region->DeleteInputAt(index);
+    if (region->GetOpcode() == Opcode::End) {
+        return;
+    }
+    for (Inst *inst = region->GetControlUser(); inst != nullptr && inst->IsPhi(); inst = inst->GetControlUser()) {
+        maybe_unused_.push_back(inst->GetDataInput(index));
+        // The first input is control one
+        static_cast<DynamicInputs *>(inst)->DeleteInputAt(index + 1);
+    }
+}
+
+void SCCP::RemoveNotExecutableEdges() {
+    for (auto region : reachable_regions_) {
+        for (auto index = region->NumRegionInputs(); index-- > 0;) {
+            if (!IsEdgeExecutable(region, index)) {
+                RemoveRegionInput(region, index);
+            }
+        }
+    }
+}
+
+// Edge of If to reachable region is already removed, if it isn't executable
+void SCCP::FoldBranches() {
+    for (id_t id = 0; id < num_insts_; id++) {
+        auto inst = graph_->GetInstByIndex(id);
+        if (inst == nullptr || inst->GetOpcode() != Opcode::If || reachable_[inst] == 0) {
+            continue;
+        }
+        auto edges = executable_edges_[inst];
+        ASSERT(edges != 0);
+        if (edges == 0b11) {
+            continue;
+        }
+        auto successors = inst->GetControlUsers();
+        auto taken = successors[edges == 0b01 ? 0 : 1]->CastToRegion();
+        auto other = successors[edges == 0b01 ? 1 : 0];
+        if (other != nullptr) {
+            RemoveRegionInput(other->CastToRegion(), other->CastToRegion()->GetIndexPredecessor(inst));
+        }
+        auto jump = graph_->CreateJumpInst();
+        jump->SetControlInput(inst->GetControlInput());
+        // Jump takes place of If in inputs of region, so inputs of Phi aren't changed
+        jump->SetControlUser(taken);
+        taken->SetRegionInput(taken->GetIndexPredecessor(inst), jump);
+        for (auto &successor : inst->GetControlUsers()) {
+            successor = nullptr;
+        }
+        maybe_unused_.push_back(inst->GetDataInput(0));
+        graph_->DeleteInst(inst);
+        num_folded_branches_++;
+    }
+}
+
+/*
+ * Instructions of unreachable regions and PURE instructions, which have never got a value,
+ * are dead. Their users are dead too, Phi of reachable region doesn't use them anymore.
+ */
+void SCCP::DeleteUnreachableInsts() {
+    InstMap<uint8_t> dead(num_insts_, 0);
+    std::vector<Inst *> dead_insts;
+    auto mark = [this, &dead, &dead_insts](Inst *inst) {
+        if (dead[inst] != 0) {
+            return;
+        }
+        ASSERT(reachable_[inst] == 0);
+        dead[inst] = 1;
+        dead_insts.push_back(inst);
+    };
+    for (id_t id = 0; id < num_insts_; id++) {
+        auto inst = graph_->GetInstByIndex(id);
+        if (inst == nullptr || reachable_[inst] != 0) {
+            continue;
+        }
+        if (inst->GetOpcode() == Opcode::Region) {
+            mark(inst);
+            num_removed_regions_++;
+            for (Inst *user = inst->GetControlUser(); user != nullptr; user = user->GetControlUser()) {
+                mark(user);
+                if (user->IsTerminator()) {
+                    break;
+                }
+            }
+        } else if (inst->IsPure() && !inst->IsConst() && values_[inst].kind == LatticeValue::UNDEFINED) {
+            mark(inst);
+        }
+    }
+    for (size_t i = 0; i < dead_insts.size(); i++) {
+        for (auto user : dead_insts[i]->GetDataUsers()) {
+            mark(user);
+        }
+    }
+    for (auto inst : dead_insts) {
+        for (auto input : inst->GetAllInputs()) {
+            if (input != nullptr && dead[input] == 0) {
+                maybe_unused_.push_back(input);
+            }
+        }
+        graph_->DeleteInst(inst);
+    }
+}
+
+void SCCP::ReplaceConstants() {
+    for (id_t id = 0; id < num_insts_; id++) {
+        auto inst = graph_->GetInstByIndex(id);
+        if (inst == nullptr || inst->IsConst() || (!inst->IsPure() && !inst->IsPhi())) {
+            continue;
+        }
+        auto value = values_[inst];
+        if (value.kind != LatticeValue::CONSTANT || !inst->HasDataUsers()) {
+            continue;
+        }
+        auto type = inst->GetType() == Type::NONE ? Type::INT64 : inst->GetType();
+        graph_->CreateConstantInst(type, value.imm)->ReplaceDataUsers(inst);
+        maybe_unused_.push_back(inst);
+        num_folded_insts_++;
+    }
+}
+
+// Constant Phi has no users here, Phi with one input is replaced by it
+void SCCP::RemoveRedundantPhis() {
+    for (auto region : reachable_regions_) {
+        if (region->GetOpcode() == Opcode::End) {
+            continue;
+        }
+        Inst *inst = region->GetControlUser();
+        while (inst->IsPhi()) {
+            auto phi = inst;
+            inst = inst->GetControlUser();
+            if (phi->NumDataInputs() == 1) {
+                phi->GetDataInput(0)->ReplaceDataUsers(phi);
+            } else if (values_[phi].kind != LatticeValue::CONSTANT) {
+                continue;
+            }
+            ASSERT(!phi->HasDataUsers());
+            for (auto input : phi->GetDataInputs()) {
+                maybe_unused_.push_back(input);
+            }
+            inst->SetControlInput(phi->GetControlInput());
+            graph_->DeleteInst(phi);
+        }
+    }
+}
+
+// Constants and parameters are left, they may be found by other passes
+void SCCP::DeleteUnusedInsts() {
+    while (!maybe_unused_.empty()) {
+        auto inst = maybe_unused_.back();
+        maybe_unused_.pop_back();
+        // Instruction may be pushed several times
+        if (graph_->GetInstByIndex(inst->GetId()) != inst || !inst->IsPure() || inst->IsConst() ||
+            inst->HasDataUsers()) {
+            continue;
+        }
+        for (auto input : inst->GetDataInputs()) {
+            maybe_unused_.push_back(input);
+        }
+        graph_->DeleteInst(inst);
+    }
+}
+
+}
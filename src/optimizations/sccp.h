@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "inst_map.h"
+
+namespace compiler {
+
+/*
+ * Sparse conditional constant propagation (Wegman, Zadeck, "Constant Propagation with
+ * Conditional Branches", 1991). Value of instruction is in lattice:
+ *   UNDEFINED -> CONSTANT -> OVERDEFINED,
+ * and it only goes down. Region is reachable, if one of its input edges is executable,
+ * only executable edges are met in Phi. CFG worklist has new executable edges, SSA worklist
+ * has users of changed values. PURE instructions aren't in regions before GCM, so they are
+ * evaluated from inputs only, instructions of control chain are evaluated in reachable regions.
+ *
+ * Then graph is changed:
+ *   - If with constant condition becomes Jump to the taken branch;
+ *   - edges, which aren't executable, are removed with inputs of Phi;
+ *   - unreachable regions and instructions, which are computed only there, are deleted;
+ *   - users of constant values use Constant, constant Phi and Phi with one input are deleted;
+ *   - PURE instructions, which were used only by removed ones, are deleted.
+ * Pass is run before GCM, so placement and register allocation don't see dead code.
+ */
+class SCCP
+{
+public:
+    SCCP(Graph *graph):
+        graph_(graph) {};
+
+    void Run();
+
+    uint32_t GetNumFoldedInsts() const {
+        return num_folded_insts_;
+    }
+
+    uint32_t GetNumFoldedBranches() const {
+        return num_folded_branches_;
+    }
+
+    uint32_t GetNumRemovedRegions() const {
+        return num_removed_regions_;
+    }
+
+    // Edges of control flow are changed
+    static constexpr AnalysisSet PRESERVED_ANALYSES = NO_ANALYSES;
+
+private:
+    struct LatticeValue {
+        enum Kind : uint8_t {
+            UNDEFINED,
+            CONSTANT,
+            OVERDEFINED
+        };
+
+        Kind kind = UNDEFINED;
+        ImmType imm = 0;
+
+        bool operator==(const LatticeValue &other) const {
+            return kind == other.kind && (kind != CONSTANT || imm == other.imm);
+        }
+    };
+
+    // Analysis
+    void MarkEdgeExecutable(Inst *exit, uint32_t successor);
+    void MarkRegionReachable(RegionInst *region);
+    bool IsEdgeExecutable(RegionInst *region, id_t index);
+    void VisitInst(Inst *inst);
+    void VisitPhi(Inst *phi);
+    void VisitIf(Inst *inst);
+    LatticeValue EvaluatePure(Inst *inst);
+    void SetValue(Inst *inst, LatticeValue value);
+
+    // Transformation
+    void RemoveRegionInput(RegionInst *region, id_t index);
+    void RemoveNotExecutableEdges();
+    void FoldBranches();
+    void DeleteUnreachableInsts();
+    void ReplaceConstants();
+    void RemoveRedundantPhis();
+    void DeleteUnusedInsts();
+
+private:
+    Graph *graph_;
+    size_t num_insts_ = 0;
+    InstMap<LatticeValue> values_;
+    // Bit of successor is set, when edge from exit of region to it is executable
+    InstMap<uint8_t> executable_edges_;
+    // Regions and instructions of their control chains, which are reachable
+    InstMap<uint8_t> reachable_;
+    // Region of every reached instruction of control chain
+    InstMap<RegionInst *> regions_;
+    std::vector<RegionInst *> reachable_regions_;
+    std::vector<std::pair<Inst *, uint32_t>> cfg_worklist_;
+    std::vector<Inst *> ssa_worklist_;
+    // Inputs of removed instructions and edges, which may lose all users
+    std::vector<Inst *> maybe_unused_;
+
+    uint32_t num_folded_insts_ = 0;
+    uint32_t num_folded_branches_ = 0;
+    uint32_t num_removed_regions_ = 0;
+};
+
+}
@@ -0,0 +1,253 @@
+#include <algorithm>
+
+#include "ssa_deconstruction.h"
+
+namespace compiler {
+
+void SsaDeconstruction::Run() {
+    BuildValueParts();
+    begin_moves_ = InstMap<std::vector<Move>>(graph_->GetNumInsts());
+    end_moves_ = InstMap<std::vector<Move>>(graph_->GetNumInsts());
+    exit_regions_ = InstMap<RegionInst *>(graph_->GetNumInsts(), nullptr);
+    for (auto region : liveness_->GetLinearRegions()) {
+        if (region->GetOpcode() != Opcode::End) {
+            exit_regions_[region->GetLast()] = region;
+        }
+    }
+
+    ResolveSplitMoves();
+
+    // Edges are split after all of them are resolved, so linear regions aren't changed in walk
+    std::vector<EdgeMoves> critical_edges;
+    for (auto succ : liveness_->GetLinearRegions()) {
+        if (succ->GetOpcode() == Opcode::End) {
+            continue;
+        }
+        auto num_preds = succ->NumRegionInputs();
+        for (id_t i = 0; i < num_preds; i++) {
+            auto pred_exit = succ->GetRegionInput(i);
+            auto pred = pred_exit->IsRegion() ? pred_exit->CastToRegion() : exit_regions_[pred_exit];
+            auto moves = CollectEdgeMoves(pred, i, succ);
+            if (moves.empty()) {
+                continue;
+            }
+            if (pred->GetLast()->GetOpcode() != Opcode::If) {
+                AddMoves(&end_moves_[pred], moves);
+            } else if (num_preds == 1) {
+                AddMoves(&begin_moves_[succ], moves);
+            } else {
+                critical_edges.push_back({pred->GetLast()->CastToIf(), succ, std::move(moves)});
+            }
+        }
+    }
+
+    for (auto &edge : critical_edges) {
+        auto region = SplitEdge(edge.pred_exit, edge.succ);
+        begin_moves_.Resize(graph_->GetNumInsts());
+        end_moves_.Resize(graph_->GetNumInsts());
+        AddMoves(&end_moves_[region], edge.moves);
+    }
+    if (num_split_edges_ != 0) {
+        graph_->GetPassManager()->InvalidateAnalyses(PRESERVED_ANALYSES);
+    }
+}
+
+// RegMaps are sorted by begin, so parts of every value are sorted after stable distribution
+void SsaDeconstruction::BuildValueParts() {
+    auto &regs_map = *regs_map_;
+    auto num_values = liveness_->GetLiveIntervals().size();
+    parts_begin_.assign(num_values + 1, 0);
+    for (auto &map : regs_map) {
+        if (!map.interval.IsEmpty()) {
+            parts_begin_[map.interval.GetLinearNumber() + 1]++;
+        }
+    }
+    for (size_t i = 0; i < num_values; i++) {
+        parts_begin_[i + 1] += parts_begin_[i];
+    }
+    parts_.resize(parts_begin_.back());
+    auto next_part = parts_begin_;
+    split_begins_.clear();
+    for (RegMapLinkIndex i = 0; i < regs_map.size(); i++) {
+        auto &interval = regs_map[i].interval;
+        if (interval.IsEmpty()) {
+            continue;
+        }
+        auto value = interval.GetLinearNumber();
+        if (next_part[value] != parts_begin_[value]) {
+            split_begins_.push_back({interval.GetBegin(), value});
+        }
+        parts_[next_part[value]++] = i;
+    }
+    edge_marks_.assign(num_values, 0);
+    edge_mark_ = 0;
+
+    values_.assign(num_values, nullptr);
+    for (auto region : liveness_->GetLinearRegions()) {
+        for (Inst *inst = region->GetFirst(); inst != nullptr; inst = inst->GetNext()) {
+            if (inst->GetOpcode() != Opcode::Jump) {
+                values_[inst->GetLinearNumber()] = inst;
+            }
+        }
+    }
+}
+
+size_t SsaDeconstruction::FindBlock(LifeNumber position) const {
+    auto &bounds = liveness_->GetBlockBounds();
+    return std::lower_bound(bounds.begin(), bounds.end(), position,
+        [](const BlockBound &bound, LifeNumber pos) { return bound.begin < pos; }) - bounds.begin();
+}
+
+const LocationData &SsaDeconstruction::GetLocation(LinearNumber value, LifeNumber position) const {
+    auto &regs_map = *regs_map_;
+    auto first = parts_.begin() + parts_begin_[value];
+    auto last = parts_.begin() + parts_begin_[value + 1];
+    // The last part, which begins not after position
+    auto part = std::upper_bound(first, last, position, [&regs_map](LifeNumber pos, RegMapLinkIndex index) {
+        return pos < regs_map[index].interval.GetBegin();
+    });
+    ASSERT(part != first);
+    auto &map = regs_map[*std::prev(part)];
+    ASSERT(map.interval.Covers(position));
+    return map.location;
+}
+
+// Begin of region or position between the last instruction of region and the next region
+bool SsaDeconstruction::IsBlockBoundary(LifeNumber position) const {
+    auto &bounds = liveness_->GetBlockBounds();
+    auto block = FindBlock(position);
+    return block < bounds.size() && (bounds[block].begin == position || bounds[block].begin == position + 1);
+}
+
+/*
+ * Part, which begins inside of region, continues the previous part of value. Split
+ * in the bounds of regions is resolved on edges, because previous part in linear order
+ * can be not in predecessor.
+ */
+void SsaDeconstruction::ResolveSplitMoves() {
+    auto &regs_map = *regs_map_;
+    std::vector<std::pair<LifeNumber, Move>> moves;
+    for (LinearNumber value = 0; value + 1 < parts_begin_.size(); value++) {
+        for (auto i = parts_begin_[value] + 1; i < parts_begin_[value + 1]; i++) {
+            auto &prev = regs_map[parts_[i - 1]];
+            auto &part = regs_map[parts_[i]];
+            auto position = part.interval.GetBegin();
+            if (IsBlockBoundary(position)) {
+                continue;
+            }
+            ASSERT(prev.interval.GetEnd() == position);
+            moves.push_back({position, {MoveKind::MOVE, values_[value], prev.location, part.location}});
+        }
+    }
+    std::stable_sort(moves.begin(), moves.end(), [](const auto &left, const auto &right) {
+        return left.first < right.first;
+    });
+
+    position_moves_.clear();
+    std::vector<Move> point;
+    for (size_t i = 0; i < moves.size(); i++) {
+        point.push_back(moves[i].second);
+        if (i + 1 == moves.size() || moves[i + 1].first != moves[i].first) {
+            position_moves_.push_back({moves[i].first, {}});
+            AddMoves(&position_moves_.back().moves, point);
+            point.clear();
+        }
+    }
+}
+
+/*
+ * Moves of edge are done after the last instruction of pred and before Phi of succ.
+ * Location of value is changed on edge, only if one of its parts begins between
+ * the ends of edge, so values aren't checked one by one.
+ */
+std::vector<Move> SsaDeconstruction::CollectEdgeMoves(RegionInst *pred, id_t index_pred, RegionInst *succ) {
+    std::vector<Move> moves;
+    auto pred_end = pred->GetLast()->GetLifeNumber();
+    auto succ_begin = succ->GetLifeNumber();
+    for (Inst *phi = succ->GetFirst(); phi != nullptr && phi->IsPhi(); phi = phi->GetNext()) {
+        auto input = phi->GetDataInput(index_pred);
+        moves.push_back({MoveKind::MOVE, input, GetLocation(input->GetLinearNumber(), pred_end),
+                         GetLocation(phi->GetLinearNumber(), succ_begin)});
+    }
+
+    auto &intervals = liveness_->GetLiveIntervals();
+    auto by_position = [](const SplitBegin &split, LifeNumber position) { return split.position <= position; };
+    auto first = std::lower_bound(split_begins_.begin(), split_begins_.end(), std::min(pred_end, succ_begin), by_position);
+    auto last = std::lower_bound(first, split_begins_.end(), std::max(pred_end, succ_begin), by_position);
+    edge_mark_++;
+    for (auto split = first; split != last; split++) {
+        auto value = split->value;
+        if (edge_marks_[value] == edge_mark_) {
+            continue;
+        }
+        edge_marks_[value] = edge_mark_;
+        // Phi of succ is moved above, value, which isn't live on the edge, isn't moved
+        auto &interval = intervals[value];
+        if (interval.GetBegin() == succ_begin || !interval.Covers(succ_begin) || !interval.Covers(pred_end)) {
+            continue;
+        }
+        auto &from = GetLocation(value, pred_end);
+        auto &to = GetLocation(value, succ_begin);
+        if (!IsSameLocation(from, to)) {
+            moves.push_back({MoveKind::MOVE, values_[value], from, to});
+        }
+    }
+    return moves;
+}
+
+RegionInst *SsaDeconstruction::SplitEdge(IfInst *pred_exit, RegionInst *succ) {
+    ASSERT(pred_exit->GetTrueBranch() != pred_exit->GetFalseBranch());
+    auto index_pred = succ->GetIndexPredecessor(pred_exit);
+    auto region = graph_->CreateRegionInst();
+    auto jump = graph_->CreateJumpInst();
+    if (pred_exit->GetTrueBranch() == succ) {
+        pred_exit->SetTrueBranch(region);
+    } else {
+        pred_exit->SetFalseBranch(region);
+    }
+    jump->SetControlInput(region);
+    // Jump takes place of If in inputs of succ, so inputs of Phi aren't changed
+    jump->SetControlUser(succ);
+    succ->SetRegionInput(index_pred, jump);
+    region->PushBackInst(jump);
+    num_split_edges_++;
+    return region;
+}
+
+void SsaDeconstruction::AddMoves(std::vector<Move> *destination, const std::vector<Move> &moves) {
+    auto size = destination->size();
+    resolver_.Resolve(moves, destination);
+    num_moves_ += destination->size() - size;
+}
+
+const std::vector<Move> &SsaDeconstruction::GetMovesAt(LifeNumber position) const {
+    static const std::vector<Move> NO_MOVES;
+    auto it = std::lower_bound(position_moves_.begin(), position_moves_.end(), position,
+        [](const PositionMoves &point, LifeNumber pos) { return point.position < pos; });
+    return it != position_moves_.end() && it->position == position ? it->moves : NO_MOVES;
+}
+
+void SsaDeconstruction::Dump(std::ostream &out) {
+    for (auto &point : position_moves_) {
+        out << "Position " << point.position << ":\n";
+        for (auto &move : point.moves) {
+            DumpMove(move, out);
+        }
+    }
+    for (id_t id = 0; id < end_moves_.size(); id++) {
+        if (!begin_moves_[id].empty()) {
+            out << "Begin of region " << id << ":\n";
+            for (auto &move : begin_moves_[id]) {
+                DumpMove(move, out);
+            }
+        }
+        if (!end_moves_[id].empty()) {
+            out << "End of region " << id << ":\n";
+            for (auto &move : end_moves_[id]) {
+                DumpMove(move, out);
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "graph.h"
+#include "inst_map.h"
+#include "parallel_move.h"
+
+namespace compiler {
+
+/*
+ * Lowering of Phi to moves after register allocation (Wimmer, "Linear Scan Register
+ * Allocation on SSA Form", resolution of data flow). Moves are computed from locations
+ * of parts of intervals:
+ *   - inside region, where the next part of split value begins;
+ *   - on edge "pred -> succ" for every Phi of succ (input from pred to Phi) and for every
+ *     value, which is live in succ and is in other location at the end of pred.
+ * Moves of one point are resolved as parallel moves. Moves of edge are placed in the end
+ * of pred, if it has one successor, else in the begin of succ, if it has one predecessor.
+ * Otherwise the edge is critical, it is split by new region with Jump, moves are in it.
+ *
+ * Regions of split edges have no life numbers, CFG is changed, so analyses of graph
+ * are invalidated. Liveness and result of allocator aren't used after Run.
+ */
+class SsaDeconstruction {
+public:
+    // "regs_map" is result of any allocator: RegMaps of parts of intervals, sorted by begin
+    SsaDeconstruction(Graph *graph, LivenessAnalyzer &liveness, const std::vector<RegMap> &regs_map,
+                      const Target &target):
+        graph_(graph),
+        liveness_(&liveness),
+        regs_map_(&regs_map),
+        resolver_(target) {}
+
+    void Run();
+
+    // Edges are split
+    static constexpr AnalysisSet PRESERVED_ANALYSES = NO_ANALYSES;
+
+    // After Phi of region
+    const std::vector<Move> &GetMovesAtBegin(RegionInst *region) const {
+        return begin_moves_[region];
+    }
+
+    // Before Jump or If of region
+    const std::vector<Move> &GetMovesAtEnd(RegionInst *region) const {
+        return end_moves_[region];
+    }
+
+    // Before instruction with the life number, or between instructions for odd position
+    const std::vector<Move> &GetMovesAt(LifeNumber position) const;
+
+    // Statistics of the last Run, swap and move to scratch are counted as one move
+    uint32_t GetNumMoves() const {
+        return num_moves_;
+    }
+
+    uint32_t GetNumSwaps() const {
+        return resolver_.GetNumSwaps();
+    }
+
+    uint32_t GetNumScratchMoves() const {
+        return resolver_.GetNumScratchMoves();
+    }
+
+    uint32_t GetNumSplitEdges() const {
+        return num_split_edges_;
+    }
+
+    void Dump(std::ostream &out);
+
+private:
+    struct EdgeMoves {
+        IfInst *pred_exit;
+        RegionInst *succ;
+        std::vector<Move> moves;
+    };
+
+    struct SplitBegin {
+        LifeNumber position;
+        LinearNumber value;
+    };
+
+    struct PositionMoves {
+        LifeNumber position;
+        std::vector<Move> moves;
+    };
+
+    void BuildValueParts();
+    // Index of the first block bound, which begins not before position
+    size_t FindBlock(LifeNumber position) const;
+    // Location of value, which is live in position
+    const LocationData &GetLocation(LinearNumber value, LifeNumber position) const;
+    bool IsBlockBoundary(LifeNumber position) const;
+    void ResolveSplitMoves();
+    // Parallel moves of edge, pred is input "index_pred" of succ
+    std::vector<Move> CollectEdgeMoves(RegionInst *pred, id_t index_pred, RegionInst *succ);
+    RegionInst *SplitEdge(IfInst *pred_exit, RegionInst *succ);
+    void AddMoves(std::vector<Move> *destination, const std::vector<Move> &moves);
+
+private:
+    Graph *graph_;
+    LivenessAnalyzer *liveness_;
+    const std::vector<RegMap> *regs_map_;
+    ParallelMoveResolver resolver_;
+
+    // Value by linear number
+    std::vector<Inst *> values_;
+    // Parts of value "v" are parts_[parts_begin_[v]] ... parts_[parts_begin_[v + 1] - 1], sorted by begin
+    std::vector<uint32_t> parts_begin_;
+    std::vector<RegMapLinkIndex> parts_;
+    // Begins of parts of values except the first ones, sorted by position
+    std::vector<SplitBegin> split_begins_;
+    // Value is checked once per edge, when it has several parts on the edge
+    std::vector<uint32_t> edge_marks_;
+    uint32_t edge_mark_ = 0;
+    // Region, which is ended by Jump or If
+    InstMap<RegionInst *> exit_regions_;
+
+    InstMap<std::vector<Move>> begin_moves_;
+    InstMap<std::vector<Move>> end_moves_;
+    // Sorted by position
+    std::vector<PositionMoves> position_moves_;
+
+    uint32_t num_moves_ = 0;
+    uint32_t num_split_edges_ = 0;
+};
+
+}
@@ -0,0 +1,138 @@
+#include "pass_manager.h"
+#include "graph.h"
+#include "optimizations/analysis/rpo.h"
+#include "optimizations/analysis/domtree.h"
+#include "optimizations/analysis/loop_analysis.h"
+#include "optimizations/analysis/linear_order.h"
+#include "optimizations/analysis/liveness_analyzer.h"
+#include "optimizations/peepholes.h"
+#include "optimizations/checks_elimination.h"
+#include "optimizations/gcm.h"
+#include "optimizations/gvn.h"
+#include "optimizations/sccp.h"
+
+#include <sstream>
+
+namespace compiler {
+
+// Passes, which can be used in pipeline by name
+#define PASS_LIST(ACTION)                               \
+    ACTION( "peepholes"          , Peepholes         )  \
+    ACTION( "checks_elimination" , ChecksElimination )  \
+    ACTION( "sccp"               , SCCP              )  \
+    ACTION( "gvn"                , GVN               )  \
+    ACTION( "gcm"                , GCM               )
+
+const char *GetRegAllocName(RegAllocKind kind) {
+    switch (kind) {
+
+#define REG_ALLOC_NAME(KIND, NAME) \
+        case RegAllocKind::KIND:   \
+            return NAME;
+
+        REG_ALLOC_LIST(REG_ALLOC_NAME)
+
+#undef REG_ALLOC_NAME
+
+        default:
+            UNREACHABLE();
+    }
+}
+
+PassManager::PassManager(Graph *graph):
+    graph_(graph) {}
+
+PassManager::~PassManager() = default;
+
+void PassManager::InvalidateAnalyses(AnalysisSet preserved) {
+    AnalysisSet valid = NO_ANALYSES;
+
+#define INVALIDATE_ANALYSIS(CLASS, ID, ...)                                                     \
+    {                                                                                           \
+        auto deps = ANALYSIS_DEPENDENCIES[static_cast<size_t>(AnalysisId::ID)];                 \
+        auto &analysis = std::get<std::unique_ptr<CLASS>>(analyses_);                           \
+        if ((preserved & ANALYSIS_BIT(ID)) == 0 || (valid & deps) != deps) {                    \
+            analysis.reset();                                                                   \
+        }                                                                                       \
+        if (analysis != nullptr) {                                                              \
+            valid |= ANALYSIS_BIT(ID);                                                          \
+        }                                                                                       \
+    }
+
+    // Dependencies are placed before dependent analysis in the list
+    ANALYSIS_LIST(INVALIDATE_ANALYSIS)
+
+#undef INVALIDATE_ANALYSIS
+}
+
+bool PassManager::RunPipeline(const std::string &pipeline) {
+    std::vector<std::string> passes;
+    std::vector<std::string> options;
+    std::stringstream stream(pipeline);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (name.find('=') != std::string::npos) {
+            if (!SetOptionByName(name, true)) {
+                std::cerr << "Unknown option \"" << name << "\" in pipeline\n";
+                return false;
+            }
+            options.push_back(name);
+            continue;
+        }
+        if (!RunPassByName(name, true)) {
+            std::cerr << "Unknown pass \"" << name << "\" in pipeline\n";
+            return false;
+        }
+        passes.push_back(name);
+    }
+    // Options don't depend on their place in pipeline
+    for (auto &option : options) {
+        SetOptionByName(option, false);
+    }
+    for (auto &pass : passes) {
+        RunPassByName(pass, false);
+    }
+    return true;
+}
+
+bool PassManager::RunPassByName(const std::string &name, bool dry_run) {
+
+#define RUN_PASS_BY_NAME(NAME, CLASS)   \
+    if (name == NAME) {                 \
+        if (!dry_run) {                 \
+            RunPass<CLASS>();           \
+        }                               \
+        return true;                    \
+    }
+
+    PASS_LIST(RUN_PASS_BY_NAME)
+
+#undef RUN_PASS_BY_NAME
+
+    return false;
+}
+
+bool PassManager::SetOptionByName(const std::string &option, bool dry_run) {
+    auto separator = option.find('=');
+    auto key = option.substr(0, separator);
+    auto value = option.substr(separator + 1);
+    if (key != "regalloc") {
+        return false;
+    }
+
+#define SET_REG_ALLOC_BY_NAME(KIND, NAME)           \
+    if (value == NAME) {                            \
+        if (!dry_run) {                             \
+            reg_alloc_kind_ = RegAllocKind::KIND;   \
+        }                                           \
+        return true;                                \
+    }
+
+    REG_ALLOC_LIST(SET_REG_ALLOC_BY_NAME)
+
+#undef SET_REG_ALLOC_BY_NAME
+
+    return false;
+}
+
+}
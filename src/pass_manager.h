@@ -1,5 +1,170 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "utils/utils.h"
+
 namespace compiler {
-    
-}
\ No newline at end of file
+
+class Graph;
+class RpoRegions;
+class RpoInsts;
+class DomTree;
+class LoopAnalysis;
+class LinearOrder;
+class LivenessAnalyzer;
+
+// Analysis, which needs other analyses, is invalidated together with them
+#define ANALYSIS_LIST(ACTION)                                                               \
+    ACTION( RpoRegions       , RPO_REGIONS   , 0                                          ) \
+    ACTION( RpoInsts         , RPO_INSTS     , 0                                          ) \
+    ACTION( DomTree          , DOM_TREE      , ANALYSIS_BIT(RPO_REGIONS)                  ) \
+    ACTION( LoopAnalysis     , LOOPS         , ANALYSIS_BIT(DOM_TREE)                     ) \
+    ACTION( LinearOrder      , LINEAR_ORDER  , ANALYSIS_BIT(LOOPS)                        ) \
+    ACTION( LivenessAnalyzer , LIVENESS      , ANALYSIS_BIT(LINEAR_ORDER)                 )
+
+enum class AnalysisId {
+
+#define CREATE_ANALYSIS_ID(CLASS, ID, ...) \
+    ID,
+
+    ANALYSIS_LIST(CREATE_ANALYSIS_ID)
+
+#undef CREATE_ANALYSIS_ID
+
+    NUM_ANALYSES
+};
+
+// Bit mask of AnalysisId
+using AnalysisSet = uint32_t;
+
+#define ANALYSIS_BIT(ID) (1U << static_cast<uint32_t>(AnalysisId::ID))
+
+constexpr AnalysisSet NO_ANALYSES = 0;
+constexpr AnalysisSet ALL_ANALYSES = (1U << static_cast<uint32_t>(AnalysisId::NUM_ANALYSES)) - 1;
+// Set of analyses, which don't depend on data instructions and their order
+constexpr AnalysisSet CFG_ANALYSES = ANALYSIS_BIT(RPO_REGIONS) | ANALYSIS_BIT(DOM_TREE) | ANALYSIS_BIT(LOOPS);
+
+constexpr std::array<AnalysisSet, static_cast<size_t>(AnalysisId::NUM_ANALYSES)> ANALYSIS_DEPENDENCIES {
+
+#define CREATE_DEPENDENCIES(CLASS, ID, DEPS) \
+    DEPS,
+
+    ANALYSIS_LIST(CREATE_DEPENDENCIES)
+
+#undef CREATE_DEPENDENCIES
+};
+
+// Register allocators, which can be chosen for method in pipeline by "regalloc=<name>"
+#define REG_ALLOC_LIST(ACTION)                    \
+    ACTION( LINEAR_SCAN    , "linear_scan"    )   \
+    ACTION( GRAPH_COLORING , "graph_coloring" )
+
+enum class RegAllocKind {
+
+#define CREATE_REG_ALLOC_KIND(KIND, ...) \
+    KIND,
+
+    REG_ALLOC_LIST(CREATE_REG_ALLOC_KIND)
+
+#undef CREATE_REG_ALLOC_KIND
+};
+
+const char *GetRegAllocName(RegAllocKind kind);
+
+template <typename T>
+struct AnalysisTraits;
+
+#define CREATE_ANALYSIS_TRAITS(CLASS, ID, ...)                  \
+    template <>                                                 \
+    struct AnalysisTraits<CLASS> {                              \
+        static constexpr AnalysisId ID_VALUE = AnalysisId::ID;  \
+    };
+
+ANALYSIS_LIST(CREATE_ANALYSIS_TRAITS)
+
+#undef CREATE_ANALYSIS_TRAITS
+
+/*
+ * Owns results of analyses of one graph. Analysis is run by the first GetAnalysis and
+ * is reused until some pass, which doesn't preserve it, is run by RunPass.
+ * Every pass declares PRESERVED_ANALYSES, all other analyses are invalidated after it.
+ */
+class PassManager
+{
+public:
+    explicit PassManager(Graph *graph);
+    ~PassManager();
+
+    PassManager(const PassManager &) = delete;
+    PassManager &operator=(const PassManager &) = delete;
+
+    template <typename T>
+    T &GetAnalysis() {
+        auto &analysis = std::get<std::unique_ptr<T>>(analyses_);
+        if (analysis == nullptr) {
+            analysis = std::make_unique<T>(graph_);
+            analysis->Run();
+            num_runs_[static_cast<size_t>(AnalysisTraits<T>::ID_VALUE)]++;
+        }
+        return *analysis;
+    }
+
+    template <typename T>
+    bool IsAnalysisValid() const {
+        return std::get<std::unique_ptr<T>>(analyses_) != nullptr;
+    }
+
+    template <typename T, typename... Args>
+    void RunPass(Args&&... args) {
+        T pass(graph_, std::forward<Args>(args)...);
+        pass.Run();
+        InvalidateAnalyses(T::PRESERVED_ANALYSES);
+    }
+
+    // Analyses from "preserved" stay valid if analyses which they depend on are valid too
+    void InvalidateAnalyses(AnalysisSet preserved = NO_ANALYSES);
+
+    /*
+     * Passes are separated by comma, for example "checks_elimination,peepholes,sccp,gvn,gcm".
+     * Option "regalloc=<name>" chooses register allocator of the method, e.g.
+     * "peepholes,gcm,regalloc=graph_coloring" for hot method.
+     * Returns false if pipeline has unknown pass or option, nothing is run in this case.
+     */
+    bool RunPipeline(const std::string &pipeline);
+
+    // Linear scan by default
+    RegAllocKind GetRegAllocKind() const {
+        return reg_alloc_kind_;
+    }
+
+    void SetRegAllocKind(RegAllocKind kind) {
+        reg_alloc_kind_ = kind;
+    }
+
+    // Number of real runs of analysis, requests of cached result aren't counted
+    uint32_t GetNumAnalysisRuns(AnalysisId id) const {
+        return num_runs_[static_cast<size_t>(id)];
+    }
+
+private:
+    bool RunPassByName(const std::string &name, bool dry_run);
+    bool SetOptionByName(const std::string &option, bool dry_run);
+
+private:
+    Graph *graph_;
+
+    // Result is nullptr if analysis isn't valid. Last element only closes the list
+#define CREATE_ANALYSIS_PTR(CLASS, ...) std::unique_ptr<CLASS>,
+    std::tuple<ANALYSIS_LIST(CREATE_ANALYSIS_PTR) std::nullptr_t> analyses_;
+#undef CREATE_ANALYSIS_PTR
+
+    std::array<uint32_t, static_cast<size_t>(AnalysisId::NUM_ANALYSES)> num_runs_ {};
+    RegAllocKind reg_alloc_kind_ = RegAllocKind::LINEAR_SCAN;
+};
+
+}
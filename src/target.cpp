@@ -0,0 +1,125 @@
+#include "target.h"
+
+namespace compiler {
+
+RegClass GetRegClass(Type type) {
+    switch (type) {
+        case Type::NONE:
+        case Type::BOOL:
+        case Type::INT32:
+        case Type::UINT32:
+        case Type::INT64:
+        case Type::UINT64:
+        case Type::REFERENCE:
+            return RegClass::GPR;
+        default:
+            UNREACHABLE();
+    }
+    return RegClass::GPR;
+}
+
+Target::Target(const char *name, std::vector<TargetRegister> &&registers,
+               std::vector<int32_t> &&param_regs, int32_t return_reg, int32_t scratch_reg,
+               std::vector<int32_t> &&allocation_order):
+    name_(name),
+    registers_(std::move(registers)),
+    param_regs_(std::move(param_regs)),
+    return_reg_(return_reg),
+    scratch_reg_(scratch_reg),
+    allocation_order_(std::move(allocation_order)) {
+    ASSERT(registers_.size() <= MAX_NUM_REGS);
+    ASSERT(allocation_order_.size() + (scratch_reg_ != INVALID_REG ? 1 : 0) == registers_.size());
+    for (uint32_t reg = 0; reg < registers_.size(); reg++) {
+        if (registers_[reg].callee_saved) {
+            callee_saved_ |= RegMask(1) << reg;
+        } else {
+            caller_saved_ |= RegMask(1) << reg;
+        }
+    }
+}
+
+RegMask Target::GetRegsOfClass(RegClass reg_class) const {
+    RegMask mask = 0;
+    for (uint32_t reg = 0; reg < registers_.size(); reg++) {
+        if (registers_[reg].reg_class == reg_class) {
+            mask |= RegMask(1) << reg;
+        }
+    }
+    return mask;
+}
+
+RegMask Target::GetAllocatableRegs(RegClass reg_class) const {
+    auto mask = GetRegsOfClass(reg_class);
+    if (scratch_reg_ != INVALID_REG) {
+        mask &= ~(RegMask(1) << scratch_reg_);
+    }
+    return mask;
+}
+
+namespace {
+
+#define X86_64_REGISTER_LIST(ACTION)  \
+    ACTION( RAX , "rax" , false )     \
+    ACTION( RCX , "rcx" , false )     \
+    ACTION( RDX , "rdx" , false )     \
+    ACTION( RBX , "rbx" , true  )     \
+    ACTION( RSI , "rsi" , false )     \
+    ACTION( RDI , "rdi" , false )     \
+    ACTION( R8  , "r8"  , false )     \
+    ACTION( R9  , "r9"  , false )     \
+    ACTION( R10 , "r10" , false )     \
+    ACTION( R11 , "r11" , false )     \
+    ACTION( R12 , "r12" , true  )     \
+    ACTION( R13 , "r13" , true  )     \
+    ACTION( R14 , "r14" , true  )     \
+    ACTION( R15 , "r15" , true  )
+
+enum X86_64Reg : int32_t {
+
+#define CREATE_X86_64_REG(REG, ...) \
+    REG,
+
+    X86_64_REGISTER_LIST(CREATE_X86_64_REG)
+
+#undef CREATE_X86_64_REG
+};
+
+Target CreateX86_64SysV() {
+    std::vector<TargetRegister> registers {
+
+#define CREATE_X86_64_REG_DESC(REG, NAME, CALLEE_SAVED) \
+        {NAME, RegClass::GPR, CALLEE_SAVED},
+
+        X86_64_REGISTER_LIST(CREATE_X86_64_REG_DESC)
+
+#undef CREATE_X86_64_REG_DESC
+    };
+    /*
+     * Caller-saved registers are taken first, callee-saved ones cost save and restore.
+     * Registers of the first parameters are the last of caller-saved, so they are
+     * free for hints of arguments of Call more often. R11 isn't used for arguments and
+     * result, so it is scratch for resolution of moves.
+     */
+    std::vector<int32_t> allocation_order {RAX, R10, R9, R8, RCX, RDX, RSI, RDI, RBX, R12, R13, R14, R15};
+    return Target("x86-64 SysV", std::move(registers), {RDI, RSI, RDX, RCX, R8, R9}, RAX, R11,
+                  std::move(allocation_order));
+}
+
+}  // namespace
+
+const Target &Target::X86_64SysV() {
+    static const Target target = CreateX86_64SysV();
+    return target;
+}
+
+Target Target::CreateGeneric(uint32_t num_regs) {
+    std::vector<TargetRegister> registers;
+    std::vector<int32_t> allocation_order;
+    for (uint32_t reg = 0; reg < num_regs; reg++) {
+        registers.push_back({std::string("r") + std::to_string(reg), RegClass::GPR, false});
+        allocation_order.push_back(reg);
+    }
+    return Target("generic", std::move(registers), {}, INVALID_REG, INVALID_REG, std::move(allocation_order));
+}
+
+}
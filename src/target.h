@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "opcodes.h"
+#include "utils/utils.h"
+
+namespace compiler {
+
+// Bit per register of register file
+using RegMask = uint64_t;
+constexpr uint32_t MAX_NUM_REGS = 64;
+constexpr int32_t INVALID_REG = -1;
+
+#define REG_CLASS_LIST(ACTION) \
+    ACTION( GPR , "gpr" )
+
+enum class RegClass {
+
+#define CREATE_REG_CLASS(CLASS, ...) \
+    CLASS,
+
+    REG_CLASS_LIST(CREATE_REG_CLASS)
+
+#undef CREATE_REG_CLASS
+
+    NUM_CLASSES
+};
+
+// All types of IR are integer or reference, they are in general purpose registers
+RegClass GetRegClass(Type type);
+
+struct TargetRegister {
+    std::string name;
+    RegClass reg_class;
+    bool callee_saved;
+};
+
+/*
+ * Register file and calling convention, which are used by register allocator.
+ * Registers are numbered in order of description. Caller-saved registers are clobbered
+ * by Call, callee-saved ones are saved in prologue of method, if they are used.
+ * Parameters and arguments of Call are passed in "param_regs" (the rest on stack),
+ * result of Call and value of Return are in "return_reg".
+ * "scratch_reg" isn't allocated, it is free for moves between allocated locations.
+ * Target must live longer than allocator, which uses it.
+ */
+class Target {
+public:
+    Target(const char *name, std::vector<TargetRegister> &&registers,
+           std::vector<int32_t> &&param_regs, int32_t return_reg, int32_t scratch_reg,
+           std::vector<int32_t> &&allocation_order);
+
+    // x86-64 System V ABI, rsp and rbp aren't allocated, r11 is scratch
+    static const Target &X86_64SysV();
+    // "num_regs" caller-saved registers "r0", "r1"..., all values are passed on stack,
+    // there is no scratch register
+    static Target CreateGeneric(uint32_t num_regs);
+
+    const char *GetName() const {
+        return name_;
+    }
+
+    uint32_t GetNumRegs() const {
+        return registers_.size();
+    }
+
+    const char *GetRegName(int32_t reg) const {
+        ASSERT(reg >= 0 && static_cast<uint32_t>(reg) < registers_.size());
+        return registers_[reg].name.c_str();
+    }
+
+    RegClass GetRegClass(int32_t reg) const {
+        ASSERT(reg >= 0 && static_cast<uint32_t>(reg) < registers_.size());
+        return registers_[reg].reg_class;
+    }
+
+    RegMask GetRegsOfClass(RegClass reg_class) const;
+
+    // Registers of class without scratch register
+    RegMask GetAllocatableRegs(RegClass reg_class) const;
+
+    RegMask GetCallerSavedRegs() const {
+        return caller_saved_;
+    }
+
+    RegMask GetCalleeSavedRegs() const {
+        return callee_saved_;
+    }
+
+    // Register of parameter or argument of Call, INVALID_REG if it is passed on stack
+    int32_t GetParamReg(uint32_t index) const {
+        return index < param_regs_.size() ? param_regs_[index] : INVALID_REG;
+    }
+
+    int32_t GetReturnReg() const {
+        return return_reg_;
+    }
+
+    // INVALID_REG if all registers are allocated
+    int32_t GetScratchReg() const {
+        return scratch_reg_;
+    }
+
+    // Allocatable registers in order of preference of allocator
+    const std::vector<int32_t> &GetAllocationOrder() const {
+        return allocation_order_;
+    }
+
+private:
+    const char *name_;
+    std::vector<TargetRegister> registers_;
+    std::vector<int32_t> param_regs_;
+    int32_t return_reg_;
+    int32_t scratch_reg_;
+    std::vector<int32_t> allocation_order_;
+    RegMask caller_saved_ = 0;
+    RegMask callee_saved_ = 0;
+};
+
+}
@@ -0,0 +1,83 @@
+#include "arena_allocator.h"
+
+namespace compiler {
+
+ArenaChunkPool::~ArenaChunkPool() {
+    for (auto chunk : free_chunks_) {
+        ::operator delete(chunk);
+    }
+}
+
+void *ArenaChunkPool::Acquire() {
+    if (free_chunks_.empty()) {
+        return ::operator new(ArenaAllocator::CHUNK_SIZE);
+    }
+    auto chunk = free_chunks_.back();
+    free_chunks_.pop_back();
+    return chunk;
+}
+
+void ArenaChunkPool::Release(void *chunk) {
+    free_chunks_.push_back(chunk);
+}
+
+ArenaAllocator::~ArenaAllocator() {
+    for (auto record = last_destructor_; record != nullptr; record = record->prev) {
+        record->dtor(record->obj);
+    }
+    for (auto chunk : chunks_) {
+        if (pool_ != nullptr) {
+            pool_->Release(chunk);
+        } else {
+            ::operator delete(chunk);
+        }
+    }
+    for (auto chunk : large_chunks_) {
+        ::operator delete(chunk);
+    }
+}
+
+void *ArenaAllocator::Alloc(size_t size, size_t align) {
+    ASSERT(align != 0 && (align & (align - 1)) == 0);
+    ASSERT(align <= alignof(std::max_align_t));
+    num_allocations_++;
+    allocated_bytes_ += size;
+
+    if (size > MAX_SMALL_ALLOC) {
+        return AllocLarge(size);
+    }
+
+    auto aligned = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(align - 1));
+    if (cur_ == nullptr || aligned + size > end_) {
+        NewChunk();
+        aligned = cur_;
+    }
+    cur_ = aligned + size;
+    return aligned;
+}
+
+void ArenaAllocator::NewChunk() {
+    void *chunk = pool_ != nullptr ? pool_->Acquire() : ::operator new(CHUNK_SIZE);
+    chunks_.push_back(chunk);
+    cur_ = static_cast<uint8_t *>(chunk);
+    end_ = cur_ + CHUNK_SIZE;
+}
+
+void *ArenaAllocator::AllocLarge(size_t size) {
+    void *chunk = ::operator new(size);
+    large_chunks_.push_back(chunk);
+    return chunk;
+}
+
+void ArenaAllocator::RegisterDestructor(void *obj, Destructor dtor) {
+    auto record = static_cast<DestructorRecord *>(Alloc(sizeof(DestructorRecord), alignof(DestructorRecord)));
+    // Service records aren't counted as user allocations
+    num_allocations_--;
+    allocated_bytes_ -= sizeof(DestructorRecord);
+    record->obj = obj;
+    record->dtor = dtor;
+    record->prev = last_destructor_;
+    last_destructor_ = record;
+}
+
+}
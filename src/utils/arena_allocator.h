@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+namespace compiler {
+
+// Keeps chunks of finished compilations, so the next graph can take them without malloc.
+// Pool must outlive all allocators which use it.
+class ArenaChunkPool
+{
+public:
+    ArenaChunkPool() = default;
+    ArenaChunkPool(const ArenaChunkPool &) = delete;
+    ArenaChunkPool &operator=(const ArenaChunkPool &) = delete;
+    ~ArenaChunkPool();
+
+    void *Acquire();
+    void Release(void *chunk);
+
+    size_t GetNumFreeChunks() const {
+        return free_chunks_.size();
+    }
+
+private:
+    std::vector<void *> free_chunks_;
+};
+
+/*
+ * Chunked bump allocator. All objects of one Graph (instructions, loops, side tables)
+ * live in it and are freed together, when the allocator is destroyed.
+ * Only objects with non-trivial destructor are remembered and destroyed one by one,
+ * memory itself is returned by chunks.
+ */
+class ArenaAllocator
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    // Bigger allocations get own chunk, so that tail of current chunk isn't wasted
+    static constexpr size_t MAX_SMALL_ALLOC = CHUNK_SIZE / 4;
+
+    explicit ArenaAllocator(ArenaChunkPool *pool = nullptr):
+        pool_(pool) {}
+
+    ArenaAllocator(const ArenaAllocator &) = delete;
+    ArenaAllocator &operator=(const ArenaAllocator &) = delete;
+    ~ArenaAllocator();
+
+    void *Alloc(size_t size, size_t align = alignof(std::max_align_t));
+
+    template <typename T, typename... Args>
+    T *New(Args&&... args) {
+        void *mem = Alloc(sizeof(T), alignof(T));
+        auto *obj = new (mem) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            RegisterDestructor(obj, [](void *ptr) { static_cast<T *>(ptr)->~T(); });
+        }
+        return obj;
+    }
+
+    // Memory isn't initialized, destructors of elements are never called
+    template <typename T>
+    T *AllocArray(size_t num) {
+        static_assert(std::is_trivially_destructible_v<T>, "Elements of arena array are never destroyed");
+        return static_cast<T *>(Alloc(sizeof(T) * num, alignof(T)));
+    }
+
+    size_t GetNumAllocations() const {
+        return num_allocations_;
+    }
+
+    size_t GetAllocatedBytes() const {
+        return allocated_bytes_;
+    }
+
+    size_t GetNumChunks() const {
+        return chunks_.size() + large_chunks_.size();
+    }
+
+private:
+    using Destructor = void (*)(void *);
+
+    struct DestructorRecord {
+        void *obj;
+        Destructor dtor;
+        DestructorRecord *prev;
+    };
+
+    void NewChunk();
+    void *AllocLarge(size_t size);
+    void RegisterDestructor(void *obj, Destructor dtor);
+
+private:
+    ArenaChunkPool *pool_;
+    uint8_t *cur_ = nullptr;
+    uint8_t *end_ = nullptr;
+    std::vector<void *> chunks_;
+    std::vector<void *> large_chunks_;
+    // Destroyed in reverse order of creation
+    DestructorRecord *last_destructor_ = nullptr;
+
+    size_t num_allocations_ = 0;
+    size_t allocated_bytes_ = 0;
+};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils.h"
+
+namespace compiler {
+
+// Dense set of indexes packed in 64-bit words
+class BitVector
+{
+public:
+    using Word = uint64_t;
+    static constexpr size_t WORD_BITS = 64;
+
+    BitVector() = default;
+
+    explicit BitVector(size_t size):
+        words_(NumWords(size)), size_(size) {}
+
+    size_t size() const {
+        return size_;
+    }
+
+    // New bits are cleared
+    void Resize(size_t size) {
+        words_.resize(NumWords(size));
+        if (size < size_ && size % WORD_BITS != 0) {
+            words_.back() &= (Word(1) << (size % WORD_BITS)) - 1;
+        }
+        size_ = size;
+    }
+
+    bool GetBit(size_t index) const {
+        ASSERT(index < size_);
+        return (words_[index / WORD_BITS] >> (index % WORD_BITS)) & 1U;
+    }
+
+    void SetBit(size_t index) {
+        ASSERT(index < size_);
+        words_[index / WORD_BITS] |= Word(1) << (index % WORD_BITS);
+    }
+
+    void ClearBit(size_t index) {
+        ASSERT(index < size_);
+        words_[index / WORD_BITS] &= ~(Word(1) << (index % WORD_BITS));
+    }
+
+    void Reset() {
+        std::fill(words_.begin(), words_.end(), 0);
+    }
+
+    // Returns true if some bit is added. Loops over words are simple for autovectorization
+    bool Union(const BitVector &other) {
+        ASSERT(other.size_ == size_);
+        Word changed = 0;
+        for (size_t i = 0; i < words_.size(); i++) {
+            auto word = words_[i] | other.words_[i];
+            changed |= word ^ words_[i];
+            words_[i] = word;
+        }
+        return changed != 0;
+    }
+
+    size_t Count() const {
+        size_t count = 0;
+        for (auto word : words_) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+    // Calls fn(index) for set bits in increasing order, cleared words are skipped
+    template <typename Fn>
+    void ForEachSetBit(Fn &&fn) const {
+        for (size_t i = 0; i < words_.size(); i++) {
+            for (auto word = words_[i]; word != 0; word &= word - 1) {
+                fn(i * WORD_BITS + __builtin_ctzll(word));
+            }
+        }
+    }
+
+private:
+    static size_t NumWords(size_t size) {
+        return (size + WORD_BITS - 1) / WORD_BITS;
+    }
+
+private:
+    std::vector<Word> words_;
+    size_t size_ = 0;
+};
+
+}
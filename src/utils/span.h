@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+#include "utils.h"
+
+namespace compiler {
+
+// Non-owning view of contiguous elements (std::span appears only in C++20)
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+
+    Span(T *data, size_t size):
+        data_(data), size_(size) {}
+
+    T *begin() const {
+        return data_;
+    }
+
+    T *end() const {
+        return data_ + size_;
+    }
+
+    T *data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    T &operator[](size_t index) const {
+        ASSERT(index < size_);
+        return data_[index];
+    }
+
+    Span SubSpan(size_t offset) const {
+        ASSERT(offset <= size_);
+        return Span(data_ + offset, size_ - offset);
+    }
+
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "value_table.h"
+
+namespace compiler {
+
+Inst *ValueTable::FindOrInsert(Inst *inst) {
+    if ((size_ + num_erased_ + 1) * 2 > entries_.size()) {
+        Grow();
+    }
+    auto hash = inst->GetValueHash();
+    auto mask = entries_.size() - 1;
+    Entry *free_entry = nullptr;
+    for (auto index = hash & mask;; index = (index + 1) & mask) {
+        auto &entry = entries_[index];
+        if (entry.inst == nullptr) {
+            free_entry = free_entry == nullptr ? &entry : free_entry;
+            if (!entry.erased) {
+                break;
+            }
+            continue;
+        }
+        if (entry.hash == hash && entry.inst->IsValueEqual(inst)) {
+            return entry.inst;
+        }
+    }
+    if (free_entry->erased) {
+        num_erased_--;
+    }
+    *free_entry = {inst, hash, false};
+    size_++;
+    if (inst->GetId() >= entry_indexes_.size()) {
+        entry_indexes_.Resize(inst->GetId() + 1, NO_ENTRY);
+    }
+    entry_indexes_[inst] = free_entry - entries_.data();
+    return nullptr;
+}
+
+// Hash of instruction may be changed after insertion, so its entry is found by id
+void ValueTable::Erase(Inst *inst) {
+    if (inst->GetId() >= entry_indexes_.size() || entry_indexes_[inst] == NO_ENTRY) {
+        return;
+    }
+    auto &entry = entries_[entry_indexes_[inst]];
+    ASSERT(entry.inst == inst);
+    entry = {nullptr, 0, true};
+    entry_indexes_[inst] = NO_ENTRY;
+    size_--;
+    num_erased_++;
+}
+
+void ValueTable::Grow() {
+    auto old_entries = std::move(entries_);
+    auto capacity = std::max(MIN_CAPACITY, old_entries.size());
+    // Erased entries are dropped, so table may stay the same size
+    while ((size_ + 1) * 2 > capacity / 2) {
+        capacity *= 2;
+    }
+    entries_ = std::vector<Entry>(capacity);
+    num_erased_ = 0;
+    auto mask = capacity - 1;
+    for (auto &entry : old_entries) {
+        if (entry.inst == nullptr) {
+            continue;
+        }
+        auto index = entry.hash & mask;
+        while (entries_[index].inst != nullptr) {
+            index = (index + 1) & mask;
+        }
+        entries_[index] = entry;
+        entry_indexes_[entry.inst] = index;
+    }
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "inst.h"
+#include "inst_map.h"
+
+namespace compiler {
+
+/*
+ * Set of PURE instructions of graph, which are found by value: opcode, type, inputs and
+ * immediates (Inst::GetValueHash, Inst::IsValueEqual). It is an open addressing table with
+ * linear probing, hash is stored with instruction. Inputs of instruction may be changed
+ * after insertion, then it isn't found by the new value or isn't equal to the old one,
+ * so merge is only missed, but never wrong. Id of inserted instruction must be set,
+ * its entry is found by id on erase.
+ */
+class ValueTable
+{
+public:
+    // Returns instruction, which is equal to "inst", else "inst" is inserted and nullptr is returned
+    Inst *FindOrInsert(Inst *inst);
+
+    // Deleted instruction must not be found
+    void Erase(Inst *inst);
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    struct Entry {
+        Inst *inst = nullptr;
+        size_t hash = 0;
+        // Probe sequence isn't broken by erased entry
+        bool erased = false;
+    };
+
+    void Grow();
+
+private:
+    static constexpr size_t MIN_CAPACITY = 64;
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    // Capacity is a power of two, no more than half of entries is busy
+    std::vector<Entry> entries_;
+    // Index of entry of inserted instruction
+    InstMap<uint32_t> entry_indexes_;
+    size_t size_ = 0;
+    size_t num_erased_ = 0;
+};
+
+}
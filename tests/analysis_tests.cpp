@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <map>
 #include <ostream>
 #include "graph.h"
 
@@ -12,6 +13,8 @@
 #include "optimizations/analysis/linear_order.h"
 #include "optimizations/analysis/liveness_analyzer.h"
 #include "optimizations/linear_scan.h"
+#include "optimizations/graph_coloring.h"
+#include "optimizations/ssa_deconstruction.h"
 
 
 namespace compiler {
@@ -46,6 +49,53 @@ void CheckLocationData(std::vector<RegMap> &regs_map, LinearNumber linear_number
     ASSERT_EQ((*find_map).location.index, location.index);
 }
 
+// Parts of split interval of value, sorted by begin
+std::vector<RegMap> GetValueParts(std::vector<RegMap> &regs_map, LinearNumber linear_number) {
+    std::vector<RegMap> parts;
+    std::copy_if(regs_map.begin(), regs_map.end(), std::back_inserter(parts),
+        [linear_number](RegMap &map) { return map.interval.GetLinearNumber() == linear_number; });
+    return parts;
+}
+
+// Values, which intersect, aren't in the same register or stack location
+void CheckNoLocationConflicts(std::vector<RegMap> &regs_map) {
+    for (size_t i = 0; i < regs_map.size(); i++) {
+        for (size_t j = i + 1; j < regs_map.size(); j++) {
+            auto &left = regs_map[i];
+            auto &right = regs_map[j];
+            if (left.location.is_remat || right.location.is_remat || left.location.is_reg != right.location.is_reg ||
+                left.location.index != right.location.index) {
+                continue;
+            }
+            ASSERT_EQ(left.interval.FindIntersection(right.interval), INVALID_LIFE_NUMBER);
+        }
+    }
+}
+
+// Sequential moves give every destination of parallel moves the value of its source
+void CheckParallelMoves(const std::vector<Move> &parallel, const std::vector<Move> &sequential) {
+    // Location is pair "is register, index", initial value of location is its number
+    std::map<std::pair<bool, int32_t>, int32_t> values;
+    auto key = [](const LocationData &location) { return std::make_pair(location.is_reg, location.index); };
+    auto get_value = [&values, &key](const LocationData &location) {
+        return values.emplace(key(location), values.size()).first->second;
+    };
+    std::vector<int32_t> expected;
+    for (auto &move : parallel) {
+        expected.push_back(move.from.is_remat ? -1 : get_value(move.from));
+    }
+    for (auto &move : sequential) {
+        auto from = move.from.is_remat ? -1 : get_value(move.from);
+        if (move.kind == MoveKind::SWAP) {
+            values[key(move.from)] = get_value(move.to);
+        }
+        values[key(move.to)] = from;
+    }
+    for (size_t i = 0; i < parallel.size(); i++) {
+        ASSERT_EQ(get_value(parallel[i].to), expected[i]);
+    }
+}
+
 #define CHECK_LIVE_INTERVAL_INST(/* Graph* */ graph, /* std::vector<LiveInterval> */ all_live_intervals, /* id_t */ idx_inst, /* LiveInterval */ true_live_interval)      \
 {                                                                                                                                                                         \
     auto inst = (graph)->GetInstByIndex((idx_inst));                                                                                                                      \
@@ -131,21 +181,138 @@ TEST(AnalysisTest, RpoAnalysisRegionsInsts1) {
     }
 
     // ========================================================================
-    auto domtree = DomTreeSlow(graph);
+    auto domtree = DomTree(graph);
     domtree.Run();
 
     std::ostringstream dump_out;
     std::string output =
     "Dominations in graph:\n"
-    "   0)  -> 3, 5, 7, 1\n"
+    "   0)  -> 3\n"
     "   1) 7 -> \n"
-    "   3) 0 -> 5, 7, 1\n"
+    "   3) 0 -> 5, 7\n"
     "   5) 3 -> \n"
     "   7) 3 -> 1\n";
     graph->DumpDomTree(dump_out);
     ASSERT_EQ(dump_out.str(), output);
 }
 
+/*
+ *          0.Start
+ *             |
+ *          3.Region <-------+
+ *           /     \         |
+ *     5.Region   6.Region   |
+ *           \     /         |
+ *          8.Region --------+
+ *             |
+ *         11.Region
+ *             |
+ *           1.End
+ */
+TEST(AnalysisTest, DomTreeDiamondInLoop) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Constant>(13).Imm(0);
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Jump>(2).CtrlInput(0).JmpTo(3);
+
+    ic.CreateInst<Opcode::Region>(3);
+    ic.CreateInst<Opcode::If>(4).DataInputs(13).CtrlInput(3).Branches(5, 6);
+
+    ic.CreateInst<Opcode::Region>(5);
+    ic.CreateInst<Opcode::Jump>(7).CtrlInput(5).JmpTo(8);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Jump>(9).CtrlInput(6).JmpTo(8);
+
+    ic.CreateInst<Opcode::Region>(8);
+    ic.CreateInst<Opcode::If>(10).DataInputs(13).CtrlInput(8).Branches(3, 11);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+    auto graph = ic.GetFinalGraph();
+
+    // Second run must not duplicate dominated regions
+    DomTree(graph).Run();
+    DomTree(graph).Run();
+
+    std::ostringstream dump_out;
+    std::string output =
+    "Dominations in graph:\n"
+    "   0)  -> 3\n"
+    "   1) 11 -> \n"
+    "   3) 0 -> 6, 5, 8\n"
+    "   5) 3 -> \n"
+    "   6) 3 -> \n"
+    "   8) 3 -> 11\n"
+    "  11) 8 -> 1\n";
+    graph->DumpDomTree(dump_out);
+    ASSERT_EQ(dump_out.str(), output);
+
+    auto region3 = graph->GetInstByIndex(3)->CastToRegion();
+    ASSERT_TRUE(region3->IsDominated(graph->GetInstByIndex(1)));
+    ASSERT_FALSE(region3->IsDominated(region3));
+    ASSERT_FALSE(graph->GetInstByIndex(5)->CastToRegion()->IsDominated(graph->GetInstByIndex(8)));
+
+    // Numbers of DFS over dominator tree
+    ASSERT_EQ(graph->GetStartRegion()->GetDomPreNumber(), 1);
+    ASSERT_EQ(graph->GetStartRegion()->GetDomPostNumber(), 7);
+    ASSERT_EQ(graph->GetInstByIndex(1)->CastToRegion()->GetDomPostNumber(), 3);
+
+    // Instructions in control chains
+    ASSERT_TRUE(graph->GetInstByIndex(2)->IsDominated(graph->GetInstByIndex(10)));
+    ASSERT_FALSE(graph->GetInstByIndex(10)->IsDominated(graph->GetInstByIndex(2)));
+    ASSERT_TRUE(graph->GetInstByIndex(3)->IsDominated(graph->GetInstByIndex(4)));
+    ASSERT_FALSE(graph->GetInstByIndex(4)->IsDominated(graph->GetInstByIndex(3)));
+    ASSERT_FALSE(graph->GetInstByIndex(7)->IsDominated(graph->GetInstByIndex(9)));
+}
+
+// Chains are longer than recursive DFS can pass with default stack
+TEST(AnalysisTest, DeepGraphsWithoutRecursion) {
+    constexpr uint32_t NUM_REGIONS = 100000;
+    constexpr uint32_t NUM_ADDS = 200000;
+
+    auto graph = Graph();
+    auto start = graph.CreateStartInst();
+    auto end = graph.CreateEndInst();
+    Inst *last = start;
+    for (uint32_t i = 0; i < NUM_REGIONS; i++) {
+        auto jump = graph.CreateJumpInst();
+        jump->SetControlInput(last);
+        auto region = graph.CreateRegionInst();
+        jump->SetJmpTo(region);
+        last = region;
+    }
+
+    Inst *value = graph.CreateConstantInst(1);
+    for (uint32_t i = 0; i < NUM_ADDS; i++) {
+        auto add = graph.CreateAddInst();
+        add->SetType(Type::INT64);
+        add->SetDataInput(0, value);
+        add->SetDataInput(1, value);
+        value = add;
+    }
+    auto ret = graph.CreateReturnInst();
+    ret->SetControlInput(last);
+    ret->SetDataInput(0, value);
+    auto jump = graph.CreateJumpInst();
+    jump->SetControlInput(ret);
+    jump->SetJmpTo(end);
+
+    auto pm = graph.GetPassManager();
+    ASSERT_EQ(pm->GetAnalysis<RpoRegions>().GetVector().size(), NUM_REGIONS + 2);
+    ASSERT_EQ(pm->GetAnalysis<RpoInsts>().GetVector().size(), graph.GetNumInsts());
+    pm->GetAnalysis<LoopAnalysis>();
+    ASSERT_EQ(graph.GetNumLoops(), 0);
+    ASSERT_EQ(end->GetDominator(), last);
+    ASSERT_TRUE(start->IsDominated(end));
+
+    pm->RunPass<GCM>();
+    ASSERT_EQ(pm->GetAnalysis<LinearOrder>().GetVector().size(), NUM_REGIONS + 2);
+    ASSERT_EQ(last->CastToRegion()->GetLast(), jump);
+}
+
 TEST(AnalysisTest, RpoAnalysisRegionsInsts2) {
     auto ic = IrConstructor();
     ic.CreateInst<Opcode::Constant>(9).Imm(2);
@@ -687,8 +854,8 @@ TEST(GcmTest, GcmTest1) {
     auto graph = ic.GetFinalGraph();
     GCM(graph).Run();
 
-    CheckOrderPlacedInsts(graph, 0, {2, 10});
-    CheckOrderPlacedInsts(graph, 3, {4, 8, 9});
+    CheckOrderPlacedInsts(graph, 0, {10});
+    CheckOrderPlacedInsts(graph, 3, {2, 4, 8, 9});
     CheckOrderPlacedInsts(graph, 1, {});
 }
 
@@ -713,8 +880,9 @@ TEST(GcmTest, GcmTest2) {
     auto graph = ic.GetFinalGraph();
     GCM(graph).Run();
 
-    CheckOrderPlacedInsts(graph, 0, {3, 2, 8, 10});
-    CheckOrderPlacedInsts(graph, 7, {9, 4, 5});
+    // Condition is loop invariant
+    CheckOrderPlacedInsts(graph, 0, {8, 2, 3, 4, 10});
+    CheckOrderPlacedInsts(graph, 7, {9, 5});
     CheckOrderPlacedInsts(graph, 6, {11});
     CheckOrderPlacedInsts(graph, 1, {});
 }
@@ -742,12 +910,157 @@ TEST(GcmTest, GcmTest3) {
     auto graph = ic.GetFinalGraph();
     GCM(graph).Run();
 
-    CheckOrderPlacedInsts(graph, 0, {7, 3, 2, 4, 5});
+    CheckOrderPlacedInsts(graph, 0, {2, 3, 7, 4, 5});
     CheckOrderPlacedInsts(graph, 6, {8});
     CheckOrderPlacedInsts(graph, 9, {10, 11, 12});
     CheckOrderPlacedInsts(graph, 1, {});
 }
 
+// Increment of loop counter is placed in the latch, not in the header with its Phi
+TEST(GcmTest, GcmLoopPhi) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Constant>(2).Imm(0);
+    ic.CreateInst<Opcode::Constant>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4);
+    ic.CreateInst<Opcode::Jump>(5).CtrlInput(0).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(10);
+    ic.CreateInst<Opcode::Phi>(7).CtrlInput(6).DataInputs(2, 10);
+    ic.GetInst(10);
+    ic.DataInputs(7, 3);
+    ic.CreateInst<Opcode::Compare>(8).DataInputs(7, 4).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(9).CtrlInput(7).DataInputs(8).Branches(11, 13);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(13);
+    ic.CreateInst<Opcode::Return>(14).CtrlInput(13).DataInputs(7);
+    ic.CreateInst<Opcode::Jump>(15).CtrlInput(14).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    GCM(graph).Run();
+
+    CheckOrderPlacedInsts(graph, 6, {7, 8, 9});
+    CheckOrderPlacedInsts(graph, 11, {10, 12});
+    CheckOrderPlacedInsts(graph, 13, {14, 15});
+}
+
+// Invariant of loop is used in the latch, it is placed before the loop
+TEST(GcmTest, GcmHoistLoopInvariant) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Constant>(4).Imm(0);
+    ic.CreateInst<Opcode::Jump>(5).CtrlInput(0).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(10);
+    ic.CreateInst<Opcode::Phi>(7).CtrlInput(6).DataInputs(4, 10);
+    ic.CreateInst<Opcode::Compare>(8).DataInputs(7, 2).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(9).CtrlInput(7).DataInputs(8).Branches(12, 14);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Mul>(11).DataInputs(3, 3);
+    ic.GetInst(10);
+    ic.DataInputs(7, 11);
+    ic.CreateInst<Opcode::Jump>(13).CtrlInput(12).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(14);
+    ic.CreateInst<Opcode::Return>(15).CtrlInput(14).DataInputs(7);
+    ic.CreateInst<Opcode::Jump>(16).CtrlInput(15).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    GCM(graph).Run();
+
+    CheckOrderPlacedInsts(graph, 0, {2, 3, 4, 11, 5});
+    CheckOrderPlacedInsts(graph, 6, {7, 8, 9});
+    CheckOrderPlacedInsts(graph, 12, {10, 13});
+    CheckOrderPlacedInsts(graph, 14, {15, 16});
+}
+
+// Value is used only in one branch, it isn't computed on the other path
+TEST(GcmTest, GcmSinkIntoBranch) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Mul>(4).DataInputs(3, 3);
+    ic.CreateInst<Opcode::Compare>(5).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(6).CtrlInput(0).DataInputs(5).Branches(7, 10);
+
+    ic.CreateInst<Opcode::Region>(7);
+    ic.CreateInst<Opcode::Return>(8).CtrlInput(7).DataInputs(4);
+    ic.CreateInst<Opcode::Jump>(9).CtrlInput(8).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(10);
+    ic.CreateInst<Opcode::Return>(11).CtrlInput(10).DataInputs(2);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    GCM(graph).Run();
+
+    CheckOrderPlacedInsts(graph, 0, {2, 3, 5, 6});
+    CheckOrderPlacedInsts(graph, 7, {4, 8, 9});
+    CheckOrderPlacedInsts(graph, 10, {11, 12});
+}
+
+// Inputs of Div are invariants of loop, but it is guarded by check of divisor and isn't hoisted
+TEST(GcmTest, GcmGuardedDiv) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Constant>(4).Imm(0);
+    ic.CreateInst<Opcode::Jump>(5).CtrlInput(0).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(22);
+    ic.CreateInst<Opcode::Phi>(7).CtrlInput(6).DataInputs(4, 22);
+    ic.CreateInst<Opcode::Compare>(8).DataInputs(7, 2).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(9).CtrlInput(7).DataInputs(8).Branches(10, 24);
+
+    ic.CreateInst<Opcode::Region>(10);
+    ic.CreateInst<Opcode::Compare>(11).DataInputs(3, 4).CC(ConditionCode::NE);
+    ic.CreateInst<Opcode::If>(12).CtrlInput(10).DataInputs(11).Branches(13, 16);
+
+    ic.CreateInst<Opcode::Region>(13);
+    ic.CreateInst<Opcode::Div>(14).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Jump>(15).CtrlInput(13).JmpTo(18);
+
+    ic.CreateInst<Opcode::Region>(16);
+    ic.CreateInst<Opcode::Jump>(17).CtrlInput(16).JmpTo(18);
+
+    ic.CreateInst<Opcode::Region>(18);
+    ic.CreateInst<Opcode::Phi>(19).CtrlInput(18).DataInputs(14, 4);
+    ic.GetInst(22);
+    ic.DataInputs(7, 19);
+    ic.CreateInst<Opcode::Jump>(20).CtrlInput(19).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(24);
+    ic.CreateInst<Opcode::Return>(25).CtrlInput(24).DataInputs(7);
+    ic.CreateInst<Opcode::Jump>(26).CtrlInput(25).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    GCM(graph).Run();
+
+    CheckOrderPlacedInsts(graph, 0, {2, 3, 4, 11, 5});
+    CheckOrderPlacedInsts(graph, 10, {12});
+    CheckOrderPlacedInsts(graph, 13, {14, 15});
+    CheckOrderPlacedInsts(graph, 18, {19, 22, 20});
+}
+
 /*  True linear order of graph in test below
 
        +--------------------------------------------+
@@ -903,7 +1216,7 @@ TEST(LivenessAnalyzerTest, Test1) {
     auto la = LivenessAnalyzer(graph);
     la.Run();
 
-    CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 2, LiveInterval(2, 6));
+    CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 2, LiveInterval(4, 6));
     CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 4, LiveInterval(6, 8));
     CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 8, LiveInterval(0, 0));
 }
@@ -1020,7 +1333,7 @@ TEST(LivenessAnalyzerTest, Test2) {
     BB begin life:0
     0.    Start      [Loop:root]  -> v5
     7.i64 Constant   0x1 -> v10
-        life: 2 lin: 0 Alive: [2, 14)           <<<<================
+        life: 2 lin: 0 Alive: [2, 12)           <<<<================
     3.i64 Constant   0x0 -> v4, v10
         life: 4 lin: 1 Alive: [4, 14)           <<<<================
     2.    Parameter   -> v4
@@ -1075,14 +1388,114 @@ TEST(LivenessAnalyzerTest, TestPhi) {
     auto la = LivenessAnalyzer(graph);
     la.Run();
 
-    CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 7, LiveInterval(2, 14));
+    // Input of Phi from Start isn't live in region 6
+    CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 7, LiveInterval(6, 12));
     CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 3, LiveInterval(4, 14));
-    CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 2, LiveInterval(6, 8));
+    CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 2, LiveInterval(2, 8));
     CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 5, LiveInterval(0, 0));
     CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 10, LiveInterval(14, 16));
     CHECK_LIVE_INTERVAL_INST(graph, la.GetLiveIntervals(), 11, LiveInterval(0, 0));
 }
 
+/*
+ * Region 12 is before region 8 in linear order. Parameters 3 and 4 are used only
+ * in region 8, so their intervals have lifetime hole in region 12.
+ */
+TEST(LivenessAnalyzerTest, LifetimeHole) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(2);
+    ic.CreateInst<Opcode::Compare>(5).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(6).CtrlInput(0).DataInputs(5).Branches(8, 12);
+
+    ic.CreateInst<Opcode::Region>(8);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(4, 4);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(9, 4);
+    ic.CreateInst<Opcode::Jump>(11).CtrlInput(8).JmpTo(15);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Add>(13).DataInputs(2, 2);
+    ic.CreateInst<Opcode::Add>(19).DataInputs(2, 2);
+    ic.CreateInst<Opcode::Add>(20).DataInputs(13, 19);
+    ic.CreateInst<Opcode::Add>(21).DataInputs(20, 2);
+    ic.CreateInst<Opcode::Jump>(14).CtrlInput(12).JmpTo(15);
+
+    ic.CreateInst<Opcode::Region>(15);
+    ic.CreateInst<Opcode::Phi>(16).CtrlInput(15).DataInputs(10, 21);
+    ic.CreateInst<Opcode::Return>(17).CtrlInput(16).DataInputs(16);
+    ic.CreateInst<Opcode::Jump>(18).CtrlInput(17).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto &intervals = la.GetLiveIntervals();
+    auto &param = intervals[graph->GetInstByIndex(4)->GetLinearNumber()];
+    ASSERT_EQ(param.NumRanges(), 2U);
+    CHECK_LIVE_INTERVAL_INST(graph, intervals, 4, LiveInterval(6, 26));
+    ASSERT_TRUE(param.Covers(graph->GetInstByIndex(5)->GetLifeNumber()));
+    ASSERT_FALSE(param.Covers(graph->GetInstByIndex(19)->GetLifeNumber()));
+    ASSERT_TRUE(param.Covers(graph->GetInstByIndex(9)->GetLifeNumber()));
+    ASSERT_EQ(param.NextUsePosition(0), graph->GetInstByIndex(9)->GetLifeNumber());
+    ASSERT_EQ(param.NextUsePosition(graph->GetInstByIndex(10)->GetLifeNumber() + 1), INVALID_LIFE_NUMBER);
+
+    // Value of region 12 is in the hole of parameter
+    auto &add = intervals[graph->GetInstByIndex(19)->GetLinearNumber()];
+    ASSERT_EQ(param.FindIntersection(add), INVALID_LIFE_NUMBER);
+    auto &other_param = intervals[graph->GetInstByIndex(2)->GetLinearNumber()];
+    ASSERT_EQ(other_param.FindIntersection(add), add.GetBegin());
+}
+
+TEST(LivenessAnalyzerTest, LiveIntervalRanges) {
+    LiveInterval interval;
+    ASSERT_TRUE(interval.IsEmpty());
+    interval.AddRange(20, 24);
+    interval.AddRange(4, 8);
+    interval.AddRange(12, 16);
+    ASSERT_EQ(interval.NumRanges(), 3U);
+
+    // Adjacent ranges are merged
+    interval.AddRange(8, 10);
+    ASSERT_EQ(interval.NumRanges(), 3U);
+    ASSERT_EQ(interval.GetRange(0).GetEnd(), 10U);
+
+    // Range, which overlaps two ranges
+    interval.AddRange(14, 22);
+    ASSERT_EQ(interval.NumRanges(), 2U);
+    ASSERT_EQ(interval.GetRange(1).GetBegin(), 12U);
+    ASSERT_EQ(interval.GetRange(1).GetEnd(), 24U);
+
+    interval.TrimBegin(6);
+    ASSERT_EQ(interval.GetBegin(), 6U);
+    ASSERT_FALSE(interval.Covers(10));
+    ASSERT_TRUE(interval.Covers(12));
+    ASSERT_FALSE(interval.Covers(24));
+
+    ASSERT_EQ(interval.FindIntersection(LiveInterval(10, 12)), INVALID_LIFE_NUMBER);
+    ASSERT_EQ(interval.FindIntersection(LiveInterval(11, 13)), 12U);
+
+    interval.AddUsePosition(7);
+    interval.AddUsePosition(20);
+    // Split in lifetime hole
+    auto child = interval.SplitAt(11);
+    ASSERT_EQ(interval.GetEnd(), 10U);
+    ASSERT_EQ(child.GetBegin(), 12U);
+    ASSERT_EQ(interval.NumUsePositions(), 1U);
+    ASSERT_EQ(child.NumUsePositions(), 1U);
+    // Split inside of range
+    auto last_child = child.SplitAt(20);
+    ASSERT_EQ(child.GetEnd(), 20U);
+    ASSERT_EQ(last_child.GetBegin(), 20U);
+    ASSERT_EQ(last_child.NextUsePosition(0), 20U);
+    ASSERT_EQ(child.PrevUsePosition(20), INVALID_LIFE_NUMBER);
+}
+
 // Graph the same as TestPhi
 TEST(LinearScanTest, Test1) {
     auto ic = IrConstructor();
@@ -1110,16 +1523,727 @@ TEST(LinearScanTest, Test1) {
     auto la = LivenessAnalyzer(graph);
     la.Run();
 
-    auto ls = LinearScanRegAlloc(la.GetLiveIntervals());
+    auto target = Target::CreateGeneric(3);
+    auto ls = LinearScanRegAlloc(la.GetLiveIntervals(), target);
     ls.Run();
     auto regs_map = ls.GetRegsMap();
 
-    CheckLocationData(regs_map, 0, Register(2, ""));
-    CheckLocationData(regs_map, 1, StackLocation(1, ""));
-    CheckLocationData(regs_map, 2, Register(0, ""));
+    // No more than 3 values are live together, so nothing is spilled. The lowest free register is taken
+    CheckLocationData(regs_map, 0, Register(0, ""));
+    CheckLocationData(regs_map, 1, Register(1, ""));
+    CheckLocationData(regs_map, 2, Register(2, ""));
+    CheckLocationData(regs_map, 3, Register(0, ""));
     CheckLocationData(regs_map, 4, LocationData(-1, "", false));
-    CheckLocationData(regs_map, 5, StackLocation(2, ""));
+    CheckLocationData(regs_map, 5, Register(0, ""));
     CheckLocationData(regs_map, 6, LocationData(-1, "", false));
+    ASSERT_EQ(ls.GetNumSpills(), 0U);
+    ASSERT_EQ(ls.GetMaxRegisterPressure(), 3U);
+}
+
+// Graph the same as LivenessAnalyzerTest.LifetimeHole
+TEST(LinearScanTest, RegisterInLifetimeHole) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(2);
+    ic.CreateInst<Opcode::Compare>(5).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(6).CtrlInput(0).DataInputs(5).Branches(8, 12);
+
+    ic.CreateInst<Opcode::Region>(8);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(4, 4);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(9, 4);
+    ic.CreateInst<Opcode::Jump>(11).CtrlInput(8).JmpTo(15);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Add>(13).DataInputs(2, 2);
+    ic.CreateInst<Opcode::Add>(19).DataInputs(2, 2);
+    ic.CreateInst<Opcode::Add>(20).DataInputs(13, 19);
+    ic.CreateInst<Opcode::Add>(21).DataInputs(20, 2);
+    ic.CreateInst<Opcode::Jump>(14).CtrlInput(12).JmpTo(15);
+
+    ic.CreateInst<Opcode::Region>(15);
+    ic.CreateInst<Opcode::Phi>(16).CtrlInput(15).DataInputs(10, 21);
+    ic.CreateInst<Opcode::Return>(17).CtrlInput(16).DataInputs(16);
+    ic.CreateInst<Opcode::Jump>(18).CtrlInput(17).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(3);
+    auto ls = LinearScanRegAlloc(la.GetLiveIntervals(), target);
+    ls.Run();
+    auto regs_map = ls.GetRegsMap();
+
+    // Parameter 4, instructions 2, 13 and 19 are live together, but parameter 4 is in the hole
+    ASSERT_EQ(ls.GetNumSpills(), 0U);
+    auto param_index = graph->GetInstByIndex(4)->GetLinearNumber();
+    auto location = std::find_if(regs_map.begin(), regs_map.end(),
+        [param_index](RegMap &map) { return map.interval.GetLinearNumber() == param_index; })->location;
+    CheckLocationData(regs_map, graph->GetInstByIndex(19)->GetLinearNumber(), location);
+}
+
+/*
+ * Four parameters are live together, parameter 2 is used only in the end,
+ * so it is spilled till its use and is reloaded after that.
+ */
+TEST(LinearScanTest, SplitAtUse) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(2);
+    ic.CreateInst<Opcode::Parameter>(5).Imm(3);
+    ic.CreateInst<Opcode::Jump>(6).CtrlInput(0).JmpTo(7);
+
+    ic.CreateInst<Opcode::Region>(7);
+    ic.CreateInst<Opcode::Add>(8).DataInputs(3, 4);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(8, 5);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(9, 2);
+    ic.CreateInst<Opcode::Return>(11).CtrlInput(7).DataInputs(10);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(3);
+    auto ls = LinearScanRegAlloc(la, target);
+    ls.Run();
+    auto regs_map = ls.GetRegsMap();
+
+    ASSERT_EQ(ls.GetNumSpills(), 1U);
+    ASSERT_EQ(ls.GetNumSplits(), 2U);
+    auto parts = GetValueParts(regs_map, graph->GetInstByIndex(2)->GetLinearNumber());
+    ASSERT_EQ(parts.size(), 3U);
+    ASSERT_TRUE(parts[0].location.is_reg);
+    ASSERT_FALSE(parts[1].location.is_reg);
+    ASSERT_TRUE(parts[2].location.is_reg);
+    // Reload is right before the use
+    ASSERT_EQ(parts[2].interval.GetBegin() + 1, graph->GetInstByIndex(10)->GetLifeNumber());
+}
+
+/*
+ * Four values are live in Start. Parameter 2 is used only in loop, so its uses cost more than
+ * the only uses of parameters 3 and 5, which are spilled and reloaded right before the uses.
+ */
+TEST(LinearScanTest, KeepLoopValueInRegister) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(2);
+    ic.CreateInst<Opcode::Parameter>(5).Imm(3);
+    ic.CreateInst<Opcode::Jump>(6).CtrlInput(0).JmpTo(7);
+
+    ic.CreateInst<Opcode::Region>(7);
+    ic.CreateInst<Opcode::Add>(8).DataInputs(3, 4);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(8, 5);
+    ic.CreateInst<Opcode::Jump>(10).CtrlInput(7).JmpTo(11);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Add>(17);
+    ic.CreateInst<Opcode::Phi>(12).CtrlInput(11).DataInputs(9, 17);
+    ic.CreateInst<Opcode::Compare>(13).DataInputs(12, 2).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(14).CtrlInput(12).DataInputs(13).Branches(15, 19);
+
+    ic.CreateInst<Opcode::Region>(15);
+    ic.GetInst(17);
+    ic.DataInputs(12, 2);
+    ic.CreateInst<Opcode::Jump>(18).CtrlInput(15).JmpTo(11);
+
+    ic.CreateInst<Opcode::Region>(19);
+    ic.CreateInst<Opcode::Return>(20).CtrlInput(19).DataInputs(12);
+    ic.CreateInst<Opcode::Jump>(21).CtrlInput(20).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(3);
+    auto ls = LinearScanRegAlloc(la, target);
+    ls.Run();
+    auto regs_map = ls.GetRegsMap();
+
+    auto parts = GetValueParts(regs_map, graph->GetInstByIndex(2)->GetLinearNumber());
+    ASSERT_EQ(parts.size(), 1U);
+    ASSERT_TRUE(parts[0].location.is_reg);
+
+    for (auto [index, user] : {std::pair {3, 8}, std::pair {5, 9}}) {
+        parts = GetValueParts(regs_map, graph->GetInstByIndex(index)->GetLinearNumber());
+        ASSERT_EQ(parts.size(), 3U);
+        ASSERT_TRUE(parts[0].location.is_reg);
+        ASSERT_FALSE(parts[1].location.is_reg);
+        ASSERT_TRUE(parts[2].location.is_reg);
+        ASSERT_EQ(parts[2].interval.GetBegin() + 1, graph->GetInstByIndex(user)->GetLifeNumber());
+    }
+    // Stores and reloads are out of loop
+    ASSERT_EQ(ls.GetNumSpillStores(), 2U);
+    ASSERT_EQ(ls.GetNumReloads(), 2U);
+    ASSERT_EQ(ls.GetSpillCost(), 4U);
+}
+
+/*
+ * Parameter 2 is used only after loop, it is the sparsest interval, where four values
+ * are live in loop. It is stored before the loop and is reloaded after it.
+ */
+TEST(LinearScanTest, SpillSparseAroundLoop) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Jump>(4).CtrlInput(0).JmpTo(5);
+
+    ic.CreateInst<Opcode::Region>(5);
+    ic.CreateInst<Opcode::Add>(6).DataInputs(3, 3);
+    ic.CreateInst<Opcode::Jump>(7).CtrlInput(5).JmpTo(8);
+
+    ic.CreateInst<Opcode::Region>(8);
+    ic.CreateInst<Opcode::Add>(13);
+    ic.CreateInst<Opcode::Phi>(9).CtrlInput(8).DataInputs(6, 13);
+    ic.CreateInst<Opcode::Compare>(10).DataInputs(9, 3).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(11).CtrlInput(9).DataInputs(10).Branches(12, 15);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.GetInst(13);
+    ic.DataInputs(9, 3);
+    ic.CreateInst<Opcode::Jump>(14).CtrlInput(12).JmpTo(8);
+
+    ic.CreateInst<Opcode::Region>(15);
+    ic.CreateInst<Opcode::Add>(16).DataInputs(9, 2);
+    ic.CreateInst<Opcode::Return>(17).CtrlInput(15).DataInputs(16);
+    ic.CreateInst<Opcode::Jump>(18).CtrlInput(17).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(3);
+    auto ls = LinearScanRegAlloc(la, target);
+    ls.Run();
+    auto regs_map = ls.GetRegsMap();
+
+    auto parts = GetValueParts(regs_map, graph->GetInstByIndex(2)->GetLinearNumber());
+    ASSERT_EQ(parts.size(), 3U);
+    ASSERT_TRUE(parts[0].location.is_reg);
+    ASSERT_FALSE(parts[1].location.is_reg);
+    ASSERT_TRUE(parts[2].location.is_reg);
+    // Store is in the end of preheader, reload is right before the use
+    ASSERT_EQ(parts[1].interval.GetBegin() + 1, graph->GetInstByIndex(8)->GetLifeNumber());
+    ASSERT_EQ(parts[2].interval.GetBegin() + 1, graph->GetInstByIndex(16)->GetLifeNumber());
+    ASSERT_EQ(ls.GetNumSpillStores(), 1U);
+    ASSERT_EQ(ls.GetNumReloads(), 1U);
+    ASSERT_EQ(ls.GetNumStackUses(), 0U);
+}
+
+/*
+ * Constant and three parameters are live together, constant is used only in the ends of
+ * both branches, so it is in Start. It isn't stored on stack, it is computed again before
+ * every use.
+ */
+TEST(LinearScanTest, RematerializeConstant) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Constant>(2).Imm(5);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(5).Imm(2);
+    ic.CreateInst<Opcode::If>(6).CtrlInput(0).DataInputs(3).Branches(7, 14);
+
+    ic.CreateInst<Opcode::Region>(7);
+    ic.CreateInst<Opcode::Add>(8).DataInputs(3, 4);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(8, 5);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(9, 2);
+    ic.CreateInst<Opcode::Return>(11).CtrlInput(7).DataInputs(10);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(14);
+    ic.CreateInst<Opcode::Return>(15).CtrlInput(14).DataInputs(2);
+    ic.CreateInst<Opcode::Jump>(16).CtrlInput(15).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(3);
+    auto ls = LinearScanRegAlloc(la, target);
+    ls.Run();
+    auto regs_map = ls.GetRegsMap();
+
+    auto parts = GetValueParts(regs_map, graph->GetInstByIndex(2)->GetLinearNumber());
+    ASSERT_EQ(parts.size(), 4U);
+    ASSERT_TRUE(parts[0].location.is_remat);
+    ASSERT_TRUE(parts[1].location.is_reg);
+    ASSERT_TRUE(parts[2].location.is_remat);
+    ASSERT_TRUE(parts[3].location.is_reg);
+    ASSERT_EQ(ls.GetNumSpills(), 0U);
+    ASSERT_EQ(ls.GetNumStackLocations(), 0U);
+    ASSERT_EQ(ls.GetNumSpillStores(), 0U);
+    ASSERT_EQ(ls.GetNumReloads(), 0U);
+    ASSERT_EQ(ls.GetNumRematerializations(), 2U);
+}
+
+/*
+ * Parameters and argument of Call are in registers of x86-64 SysV without moves,
+ * result of Call is in rax. Parameter 2 is live across Call, so it is in callee-saved register.
+ */
+TEST(LinearScanTest, CallingConventionSysV) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Jump>(4).CtrlInput(0).JmpTo(5);
+
+    ic.CreateInst<Opcode::Region>(5);
+    ic.CreateInst<Opcode::Add>(6).DataInputs(3, 3);
+    ic.CreateInst<Opcode::Call>(7).NameFunc("Foo").CtrlInput(5).DataInputs(6);
+    ic.CreateInst<Opcode::Add>(8).DataInputs(7, 2);
+    ic.CreateInst<Opcode::Return>(9).CtrlInput(7).DataInputs(8);
+    ic.CreateInst<Opcode::Jump>(10).CtrlInput(9).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto &target = Target::X86_64SysV();
+    auto ls = LinearScanRegAlloc(la, target);
+    ls.Run();
+    auto regs_map = ls.GetRegsMap();
+    auto check_reg = [&regs_map, graph](id_t inst, const char *name) {
+        auto parts = GetValueParts(regs_map, graph->GetInstByIndex(inst)->GetLinearNumber());
+        ASSERT_EQ(parts.size(), 1U);
+        ASSERT_TRUE(parts[0].location.is_reg);
+        ASSERT_STREQ(parts[0].location.name, name);
+    };
+    check_reg(2, "rbx");
+    check_reg(3, "rsi");
+    check_reg(6, "rdi");
+    check_reg(7, "rax");
+    check_reg(8, "rax");
+    ASSERT_EQ(ls.GetNumSpills(), 0U);
+    // Only parameter 2 isn't in its register
+    ASSERT_EQ(ls.GetNumHintMisses(), 1U);
+
+    // Caller-saved registers are reserved at Call, except rax, which gets result
+    auto call_position = graph->GetInstByIndex(7)->GetLifeNumber();
+    for (int32_t reg = 0; reg < static_cast<int32_t>(target.GetNumRegs()); reg++) {
+        bool is_callee_saved = (target.GetCalleeSavedRegs() & (RegMask(1) << reg)) != 0;
+        ASSERT_EQ(ls.GetFixedInterval(reg).Covers(call_position), !is_callee_saved && reg != target.GetReturnReg());
+    }
+}
+
+
+/*
+ * Phi 7 of the outer loop is used in its back edge region 19. Region 26 of the innermost
+ * loop is the last in linear order, it isn't in ranges of the outer and the middle loops
+ * without their inner loops, but Phi 7 is live there.
+ */
+TEST(LivenessAnalyzerTest, OuterLoopValueInInnerLoop) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Constant>(3).Imm(0);
+    ic.CreateInst<Opcode::Constant>(4).Imm(1);
+    ic.CreateInst<Opcode::Jump>(5).CtrlInput(0).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(20);
+    ic.CreateInst<Opcode::Phi>(7).CtrlInput(6).DataInputs(3, 20);
+    ic.CreateInst<Opcode::Compare>(8).DataInputs(7, 2).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(9).CtrlInput(7).DataInputs(8).Branches(10, 40);
+
+    ic.CreateInst<Opcode::Region>(10);
+    ic.CreateInst<Opcode::Jump>(11).CtrlInput(10).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Add>(30);
+    ic.CreateInst<Opcode::Phi>(13).CtrlInput(12).DataInputs(3, 30);
+    ic.CreateInst<Opcode::Compare>(14).DataInputs(13, 2).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(15).CtrlInput(13).DataInputs(14).Branches(16, 19);
+
+    ic.CreateInst<Opcode::Region>(16);
+    ic.CreateInst<Opcode::Jump>(17).CtrlInput(16).JmpTo(22);
+
+    ic.CreateInst<Opcode::Region>(22);
+    ic.CreateInst<Opcode::Add>(27);
+    ic.CreateInst<Opcode::Phi>(23).CtrlInput(22).DataInputs(3, 27);
+    ic.CreateInst<Opcode::Compare>(24).DataInputs(23, 2).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(25).CtrlInput(23).DataInputs(24).Branches(26, 29);
+
+    ic.CreateInst<Opcode::Region>(26);
+    ic.GetInst(27);
+    ic.DataInputs(23, 4);
+    ic.CreateInst<Opcode::Jump>(28).CtrlInput(26).JmpTo(22);
+
+    ic.CreateInst<Opcode::Region>(29);
+    ic.GetInst(30);
+    ic.DataInputs(13, 4);
+    ic.CreateInst<Opcode::Jump>(31).CtrlInput(29).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(19);
+    ic.GetInst(20);
+    ic.DataInputs(7, 4);
+    ic.CreateInst<Opcode::Jump>(21).CtrlInput(19).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(40);
+    ic.CreateInst<Opcode::Return>(41).CtrlInput(40).DataInputs(7);
+    ic.CreateInst<Opcode::Jump>(42).CtrlInput(41).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto &phi = la.GetLiveIntervals()[graph->GetInstByIndex(7)->GetLinearNumber()];
+    for (auto region : {10, 12, 16, 19, 22, 26, 29}) {
+        ASSERT_TRUE(phi.Covers(graph->GetInstByIndex(region)->GetLifeNumber()));
+    }
+    auto innermost_back_edge = graph->GetInstByIndex(26)->CastToRegion();
+    ASSERT_TRUE(phi.Covers(innermost_back_edge->GetLifeNumberEndOfRegion() - 1));
+}
+
+TEST(ParallelMoveTest, SwapRegisters) {
+    auto target = Target::CreateGeneric(4);
+    auto reg = [&target](int32_t index) { return Register(index, target.GetRegName(index)); };
+    std::vector<Move> moves {
+        {MoveKind::MOVE, nullptr, reg(0), reg(1)},
+        {MoveKind::MOVE, nullptr, reg(1), reg(0)},
+        {MoveKind::MOVE, nullptr, reg(1), reg(2)},
+        {MoveKind::MOVE, nullptr, reg(3), reg(3)},
+    };
+    ParallelMoveResolver resolver(target);
+    std::vector<Move> result;
+    resolver.Resolve(moves, &result);
+    CheckParallelMoves(moves, result);
+
+    // r1 is copied to r2 before the cycle is broken, move to itself is removed
+    ASSERT_EQ(result.size(), 2U);
+    ASSERT_EQ(result[0].kind, MoveKind::MOVE);
+    ASSERT_EQ(result[0].to.index, 2);
+    ASSERT_EQ(result[1].kind, MoveKind::SWAP);
+    ASSERT_EQ(resolver.GetNumSwaps(), 1U);
+    ASSERT_EQ(resolver.GetNumScratchMoves(), 0U);
+}
+
+/*
+ * Stack locations can't be swapped by one instruction, so cycle is broken by scratch
+ * register. Rematerialization of constant in rax is done after rax is read.
+ */
+TEST(ParallelMoveTest, StackCycleThroughScratch) {
+    auto &target = Target::X86_64SysV();
+    auto rax = Register(target.GetReturnReg(), target.GetRegName(target.GetReturnReg()));
+    std::vector<Move> moves {
+        {MoveKind::MOVE, nullptr, StackLocation(1, "stack"), StackLocation(2, "stack")},
+        {MoveKind::MOVE, nullptr, StackLocation(2, "stack"), StackLocation(1, "stack")},
+        {MoveKind::MOVE, nullptr, RematLocation(), rax},
+        {MoveKind::MOVE, nullptr, rax, StackLocation(3, "stack")},
+    };
+    ParallelMoveResolver resolver(target);
+    std::vector<Move> result;
+    resolver.Resolve(moves, &result);
+    CheckParallelMoves(moves, result);
+
+    ASSERT_EQ(result.size(), 5U);
+    ASSERT_EQ(resolver.GetNumSwaps(), 0U);
+    ASSERT_EQ(resolver.GetNumScratchMoves(), 1U);
+    auto scratch = std::find_if(result.begin(), result.end(), [&target](const Move &move) {
+        return move.to.is_reg && move.to.index == target.GetScratchReg();
+    });
+    ASSERT_NE(scratch, result.end());
+    // Scratch isn't allocated
+    ASSERT_EQ(target.GetAllocatableRegs(RegClass::GPR) & (RegMask(1) << target.GetScratchReg()), 0U);
+}
+
+/*
+ * Phi 7 and 8 exchange values on back edge, both are in registers, so moves of
+ * back edge are one swap in the end of region 11.
+ */
+TEST(SsaDeconstructionTest, SwapPhisInLoop) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(2);
+    ic.CreateInst<Opcode::Jump>(5).CtrlInput(0).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Phi>(7).CtrlInput(6);
+    ic.CreateInst<Opcode::Phi>(8).CtrlInput(7).DataInputs(3, 7);
+    ic.GetInst(7);
+    ic.DataInputs(2, 8);
+    ic.CreateInst<Opcode::Compare>(9).DataInputs(7, 4).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(10).CtrlInput(8).DataInputs(9).Branches(11, 13);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(13);
+    ic.CreateInst<Opcode::Add>(14).DataInputs(7, 8);
+    ic.CreateInst<Opcode::Return>(15).CtrlInput(13).DataInputs(14);
+    ic.CreateInst<Opcode::Jump>(16).CtrlInput(15).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(4);
+    auto ls = LinearScanRegAlloc(la, target);
+    ls.Run();
+    auto ssa = SsaDeconstruction(graph, la, ls.GetRegsMap(), ls.GetTarget());
+    ssa.Run();
+
+    auto regs_map = ls.GetRegsMap();
+    auto phi_7 = GetValueParts(regs_map, graph->GetInstByIndex(7)->GetLinearNumber());
+    auto phi_8 = GetValueParts(regs_map, graph->GetInstByIndex(8)->GetLinearNumber());
+    ASSERT_EQ(phi_7.size(), 1U);
+    ASSERT_EQ(phi_8.size(), 1U);
+    ASSERT_TRUE(phi_7[0].location.is_reg);
+    ASSERT_TRUE(phi_8[0].location.is_reg);
+
+    auto &moves = ssa.GetMovesAtEnd(graph->GetInstByIndex(11)->CastToRegion());
+    ASSERT_EQ(moves.size(), 1U);
+    ASSERT_EQ(moves[0].kind, MoveKind::SWAP);
+    std::vector<Move> parallel {
+        {MoveKind::MOVE, nullptr, phi_8[0].location, phi_7[0].location},
+        {MoveKind::MOVE, nullptr, phi_7[0].location, phi_8[0].location},
+    };
+    CheckParallelMoves(parallel, moves);
+    ASSERT_EQ(ssa.GetNumSplitEdges(), 0U);
+}
+
+/*
+ * Edge from If of Start to region 9 is critical, Phi 10 is in rax for Return and
+ * its input, parameter 3, is in rsi. Move is placed in new region on the edge.
+ */
+TEST(SsaDeconstructionTest, SplitCriticalEdge) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Compare>(4).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(5).CtrlInput(0).DataInputs(4).Branches(6, 9);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(7).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Jump>(8).CtrlInput(6).JmpTo(9);
+
+    // The first input of region is Jump 8, the second one is If 5
+    ic.CreateInst<Opcode::Region>(9);
+    ic.CreateInst<Opcode::Phi>(10).CtrlInput(9).DataInputs(7, 3);
+    ic.CreateInst<Opcode::Return>(11).CtrlInput(10).DataInputs(10);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto &la = graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+
+    auto ls = LinearScanRegAlloc(la, Target::X86_64SysV());
+    ls.Run();
+    auto ssa = SsaDeconstruction(graph, la, ls.GetRegsMap(), ls.GetTarget());
+    ssa.Run();
+    ASSERT_EQ(ssa.GetNumSplitEdges(), 1U);
+    ASSERT_FALSE(graph->GetPassManager()->IsAnalysisValid<LivenessAnalyzer>());
+
+    auto if_inst = graph->GetInstByIndex(5)->CastToIf();
+    auto merge = graph->GetInstByIndex(9)->CastToRegion();
+    auto split = if_inst->GetFalseBranch();
+    ASSERT_NE(split, merge);
+    ASSERT_EQ(split->GetRegionInput(0), if_inst);
+    auto jump = split->GetLast();
+    ASSERT_EQ(jump->GetOpcode(), Opcode::Jump);
+    ASSERT_EQ(jump->CastToJump()->GetJumpTo(), merge);
+    // Index of predecessor isn't changed, so Phi takes parameter 3 from the new region
+    ASSERT_EQ(merge->GetIndexPredecessor(jump), 1U);
+
+    auto &moves = ssa.GetMovesAtEnd(split);
+    ASSERT_EQ(moves.size(), 1U);
+    ASSERT_EQ(moves[0].kind, MoveKind::MOVE);
+    ASSERT_EQ(moves[0].value, graph->GetInstByIndex(3));
+    ASSERT_STREQ(moves[0].from.name, "rsi");
+    ASSERT_STREQ(moves[0].to.name, "rax");
+    ASSERT_TRUE(ssa.GetMovesAtEnd(graph->GetInstByIndex(0)->CastToRegion()).empty());
+}
+
+/*
+ * Phi 13 and its inputs 7 and 10 don't interfere, they are coalesced into one node,
+ * so there are no moves on edges.
+ */
+TEST(GraphColoringTest, CoalescePhiInputs) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Compare>(4).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(5).CtrlInput(0).DataInputs(4).Branches(6, 9);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(7).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Jump>(8).CtrlInput(6).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(9);
+    ic.CreateInst<Opcode::Sub>(10).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Jump>(11).CtrlInput(9).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Phi>(13).CtrlInput(12).DataInputs(7, 10);
+    ic.CreateInst<Opcode::Add>(14).DataInputs(13, 2);
+    ic.CreateInst<Opcode::Return>(15).CtrlInput(13).DataInputs(14);
+    ic.CreateInst<Opcode::Jump>(16).CtrlInput(15).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto &la = graph->GetPassManager()->GetAnalysis<LivenessAnalyzer>();
+
+    auto gc = GraphColoringRegAlloc(la, Target::X86_64SysV());
+    gc.Run();
+    auto &regs_map = gc.GetRegsMap();
+    CheckNoLocationConflicts(regs_map);
+    ASSERT_EQ(gc.GetNumCoalescedMoves(), 2U);
+    ASSERT_EQ(gc.GetNumSpills(), 0U);
+    auto phi = GetValueParts(regs_map, graph->GetInstByIndex(13)->GetLinearNumber());
+    ASSERT_EQ(phi.size(), 1U);
+    ASSERT_TRUE(phi[0].location.is_reg);
+    for (auto input : {7, 10}) {
+        CheckLocationData(regs_map, graph->GetInstByIndex(input)->GetLinearNumber(), phi[0].location);
+    }
+
+    auto ssa = SsaDeconstruction(graph, la, regs_map, gc.GetTarget());
+    ssa.Run();
+    ASSERT_EQ(ssa.GetNumMoves(), 0U);
+}
+
+/*
+ * Constant and three parameters are live together and there are two registers. Constant
+ * has the smallest spill cost, it is computed again before both uses. One of parameters
+ * is on stack for all its life.
+ */
+TEST(GraphColoringTest, SpillCheapestNode) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Constant>(2).Imm(5);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(5).Imm(2);
+    ic.CreateInst<Opcode::If>(6).CtrlInput(0).DataInputs(3).Branches(7, 14);
+
+    ic.CreateInst<Opcode::Region>(7);
+    ic.CreateInst<Opcode::Add>(8).DataInputs(3, 4);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(8, 5);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(9, 2);
+    ic.CreateInst<Opcode::Return>(11).CtrlInput(7).DataInputs(10);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(14);
+    ic.CreateInst<Opcode::Return>(15).CtrlInput(14).DataInputs(2);
+    ic.CreateInst<Opcode::Jump>(16).CtrlInput(15).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto target = Target::CreateGeneric(2);
+    auto gc = GraphColoringRegAlloc(la, target);
+    gc.Run();
+    auto &regs_map = gc.GetRegsMap();
+    CheckNoLocationConflicts(regs_map);
+
+    auto constant = GetValueParts(regs_map, graph->GetInstByIndex(2)->GetLinearNumber());
+    ASSERT_EQ(constant.size(), 1U);
+    ASSERT_TRUE(constant[0].location.is_remat);
+    ASSERT_EQ(gc.GetNumRematerializations(), 2U);
+    ASSERT_EQ(gc.GetNumSpills(), 1U);
+    ASSERT_EQ(gc.GetNumStackLocations(), 1U);
+    ASSERT_EQ(gc.GetNumStackUses(), 1U);
+    for (auto inst : {8, 9, 10}) {
+        auto parts = GetValueParts(regs_map, graph->GetInstByIndex(inst)->GetLinearNumber());
+        ASSERT_TRUE(parts[0].location.is_reg);
+    }
+}
+
+/*
+ * The same constraints as for linear scan: parameter 2 is live across Call, so it isn't
+ * in caller-saved registers, other values get registers of calling convention.
+ */
+TEST(GraphColoringTest, CallingConventionSysV) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Jump>(4).CtrlInput(0).JmpTo(5);
+
+    ic.CreateInst<Opcode::Region>(5);
+    ic.CreateInst<Opcode::Add>(6).DataInputs(3, 3);
+    ic.CreateInst<Opcode::Call>(7).NameFunc("Foo").CtrlInput(5).DataInputs(6);
+    ic.CreateInst<Opcode::Add>(8).DataInputs(7, 2);
+    ic.CreateInst<Opcode::Return>(9).CtrlInput(7).DataInputs(8);
+    ic.CreateInst<Opcode::Jump>(10).CtrlInput(9).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+
+    GCM(graph).Run();
+    auto la = LivenessAnalyzer(graph);
+    la.Run();
+
+    auto gc = GraphColoringRegAlloc(la, Target::X86_64SysV());
+    gc.Run();
+    auto &regs_map = gc.GetRegsMap();
+    CheckNoLocationConflicts(regs_map);
+    auto check_reg = [&regs_map, graph](id_t inst, const char *name) {
+        auto parts = GetValueParts(regs_map, graph->GetInstByIndex(inst)->GetLinearNumber());
+        ASSERT_EQ(parts.size(), 1U);
+        ASSERT_TRUE(parts[0].location.is_reg);
+        ASSERT_STREQ(parts[0].location.name, name);
+    };
+    check_reg(2, "rbx");
+    check_reg(3, "rsi");
+    check_reg(6, "rdi");
+    check_reg(7, "rax");
+    check_reg(8, "rax");
+    ASSERT_EQ(gc.GetNumSpills(), 0U);
 }
 
 }
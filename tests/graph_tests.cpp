@@ -3,6 +3,10 @@
 #include "graph.h"
 #include "ir_constructor.h"
 #include "graph_comparator.h"
+#include "marker.h"
+#include "inst_map.h"
+
+#include <memory>
 
 namespace compiler {
 
@@ -356,4 +360,286 @@ TEST(GraphTest, TestCall) {
     ASSERT_EQ(dump_out.str(), output);
 }
 
+TEST(GraphTest, UseListsReplaceUsers) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Constant>(0).Imm(1);
+    ic.CreateInst<Opcode::Constant>(1).Imm(2);
+    ic.CreateInst<Opcode::Add>(2).DataInputs(0, 0);
+    ic.CreateInst<Opcode::Sub>(3).DataInputs(1, 0);
+    auto graph = ic.GetFinalGraph();
+    auto cnst0 = graph->GetInstByIndex(0);
+    auto cnst1 = graph->GetInstByIndex(1);
+
+    // Add uses constant twice, but it is single user
+    ASSERT_EQ(cnst0->NumDataUses(), 3);
+    ASSERT_FALSE(cnst0->HasSingleDataUser());
+    ASSERT_TRUE(cnst1->HasSingleDataUser());
+    std::vector<std::pair<id_t, id_t>> uses;
+    for (auto use : cnst0->GetDataUses()) {
+        uses.emplace_back(use->GetUser()->GetId(), use->GetIndex());
+    }
+    ASSERT_EQ(uses, (std::vector<std::pair<id_t, id_t>>{{2, 0}, {2, 1}, {3, 1}}));
+
+    cnst1->ReplaceDataUsers(cnst0);
+    ASSERT_FALSE(cnst0->HasDataUsers());
+    ASSERT_EQ(cnst1->NumDataUses(), 4);
+    ASSERT_EQ(graph->GetInstByIndex(2)->GetDataInput(1), cnst1);
+    ASSERT_EQ(graph->GetInstByIndex(3)->GetDataInput(1), cnst1);
+
+    std::ostringstream dump_out;
+    std::string output =
+    "Method: \n"
+    "Instructions:\n"
+    "   0.i64 Constant   0x1\n"
+    "   1.i64 Constant   0x2 -> v3, v2\n"
+    "   2.    Add        v1, v1\n"
+    "   3.    Sub        v1, v1\n";
+    graph->Dump(dump_out);
+    ASSERT_EQ(dump_out.str(), output);
+}
+
+TEST(GraphTest, DynamicInputsGrowth) {
+    Graph graph;
+    auto region = graph.CreateRegionInst();
+    auto phi = graph.CreatePhiInst();
+    phi->SetControlInput(region);
+
+    std::vector<ConstantInst *> constants;
+    for (uint32_t i = 0; i < 3 * DynamicInputs::INLINE_CAPACITY; i++) {
+        constants.push_back(graph.CreateConstantInst(i));
+        phi->SetDataInput(i, constants.back());
+    }
+    // Inputs moved to arena, but users still point to actual records
+    ASSERT_EQ(phi->NumDataInputs(), constants.size());
+    for (uint32_t i = 0; i < constants.size(); i++) {
+        ASSERT_EQ(phi->GetDataInputs()[i], constants[i]);
+        ASSERT_TRUE(constants[i]->HasSingleDataUser());
+        auto use = *constants[i]->GetDataUses().begin();
+        ASSERT_EQ(use->GetUser(), phi);
+        ASSERT_EQ(use->GetIndex(), i + 1);
+    }
+
+    // Inputs after deleted one are shifted
+    phi->DeleteInput(constants[1]);
+    ASSERT_FALSE(constants[1]->HasDataUsers());
+    ASSERT_EQ(phi->NumDataInputs(), constants.size() - 1);
+    ASSERT_EQ(phi->GetDataInput(1), constants[2]);
+    ASSERT_EQ((*constants[2]->GetDataUses().begin())->GetIndex(), 2);
+
+    auto new_const = graph.CreateConstantInst(100);
+    new_const->ReplaceDataUsers(constants.back());
+    ASSERT_EQ(phi->GetDataInputs()[phi->NumDataInputs() - 1], new_const);
+}
+
+TEST(GraphTest, OpcodeProperties) {
+    static_assert(HasOpcodeFlag(Opcode::Add, COMMUTATIVE) && HasOpcodeFlag(Opcode::Add, PURE));
+    static_assert(!HasOpcodeFlag(Opcode::Sub, COMMUTATIVE));
+    static_assert(HasOpcodeFlag(Opcode::Jump, TERMINATOR) && HasOpcodeFlag(Opcode::If, TERMINATOR));
+    static_assert(GetOpcodeProps(Opcode::BoundsCheck).num_inputs == 3);
+    static_assert(GetOpcodeProps(Opcode::Phi).num_inputs == DYNAMIC_INPUTS);
+
+    auto graph = Graph();
+    // BinaryOperation gets properties only with opcode
+    auto mul = graph.CreateMulInst(Type::INT64, nullptr, nullptr);
+    ASSERT_TRUE(mul->IsCommutative());
+    ASSERT_FALSE(mul->HasControlProp());
+    ASSERT_EQ(mul->NumAllInputs(), 2);
+
+    auto start = graph.CreateStartInst();
+    ASSERT_TRUE(start->IsRegion());
+    ASSERT_TRUE(start->HasControlProp());
+    ASSERT_EQ(start->NumAllInputs(), 0);
+
+    auto call = graph.CreateCallInst();
+    call->SetControlInput(start);
+    call->SetDataInput(0, mul);
+    ASSERT_EQ(call->NumAllInputs(), 2);
+    ASSERT_EQ(call->GetDataInputs()[0], mul);
+    ASSERT_FALSE(call->IsPure());
+}
+
+TEST(GraphTest, MarkerSlotsAndBitset) {
+    auto graph = Graph();
+    auto cnst0 = graph.CreateConstantInst(1);
+    auto cnst1 = graph.CreateConstantInst(2);
+
+    std::vector<std::unique_ptr<Marker>> markers;
+    for (uint32_t i = 0; i < NUM_MARKER_SLOTS; i++) {
+        markers.push_back(std::make_unique<Marker>(&graph));
+        ASSERT_FALSE(markers.back()->UsesBitset());
+    }
+    // All slots are busy
+    Marker extra(&graph);
+    ASSERT_TRUE(extra.UsesBitset());
+
+    markers[0]->SetMarker(cnst0);
+    ASSERT_TRUE(markers[0]->IsMarked(cnst0));
+    ASSERT_FALSE(markers[1]->IsMarked(cnst0));
+    ASSERT_FALSE(extra.TrySetMarker(cnst1));
+    ASSERT_TRUE(extra.TrySetMarker(cnst1));
+    ASSERT_FALSE(extra.IsMarked(cnst0));
+
+    markers[0]->Clear();
+    ASSERT_FALSE(markers[0]->IsMarked(cnst0));
+    extra.Clear();
+    ASSERT_FALSE(extra.IsMarked(cnst1));
+
+    // Inst created after marker isn't marked
+    auto cnst2 = graph.CreateConstantInst(3);
+    ASSERT_FALSE(extra.IsMarked(cnst2));
+    extra.SetMarker(cnst2);
+    ASSERT_TRUE(extra.IsMarked(cnst2));
+
+    // Released slot is reused, marks of the previous owner are outdated
+    markers[1]->SetMarker(cnst1);
+    markers[1].reset();
+    Marker reused(&graph);
+    ASSERT_FALSE(reused.UsesBitset());
+    ASSERT_FALSE(reused.IsMarked(cnst1));
+}
+
+TEST(GraphTest, InstMap) {
+    auto graph = Graph();
+    auto cnst = graph.CreateConstantInst(1);
+    auto add = graph.CreateAddInst();
+
+    InstMap<id_t> map(graph.GetNumInsts(), 7);
+    map[add] = 3;
+    ASSERT_EQ(map[cnst], 7U);
+    ASSERT_EQ(map[add->GetId()], 3U);
+
+    auto sub = graph.CreateSubInst();
+    map.Resize(graph.GetNumInsts(), 5);
+    ASSERT_EQ(map[sub], 5U);
+    ASSERT_EQ(map[add], 3U);
+}
+
+TEST(BitVectorTest, UnionCountAndSetBits) {
+    BitVector first(130);
+    BitVector second(130);
+    first.SetBit(0);
+    first.SetBit(64);
+    second.SetBit(64);
+    second.SetBit(129);
+
+    ASSERT_TRUE(first.Union(second));
+    ASSERT_FALSE(first.Union(second));
+    ASSERT_EQ(first.Count(), 3U);
+
+    std::vector<size_t> bits;
+    first.ForEachSetBit([&bits](size_t index) { bits.push_back(index); });
+    ASSERT_EQ(bits, std::vector<size_t>({0, 64, 129}));
+
+    first.ClearBit(64);
+    first.Resize(100);
+    ASSERT_EQ(first.Count(), 1U);
+}
+
+TEST(ArenaAllocatorTest, DestructorsAndStatistics) {
+    uint32_t num_destroyed = 0;
+    struct Counter {
+        Counter(uint32_t *counter): counter_(counter) {}
+        ~Counter() {
+            (*counter_)++;
+        }
+        uint32_t *counter_;
+    };
+
+    {
+        ArenaAllocator allocator;
+        for (uint32_t i = 0; i < 10; i++) {
+            allocator.New<Counter>(&num_destroyed);
+        }
+        auto array = allocator.AllocArray<uint64_t>(ArenaAllocator::CHUNK_SIZE);
+        array[ArenaAllocator::CHUNK_SIZE - 1] = 1;
+
+        ASSERT_EQ(allocator.GetNumAllocations(), 11);
+        ASSERT_EQ(allocator.GetNumChunks(), 2);
+        ASSERT_EQ(num_destroyed, 0);
+    }
+    ASSERT_EQ(num_destroyed, 10);
+}
+
+TEST(ArenaAllocatorTest, ReuseChunksBetweenGraphs) {
+    ArenaChunkPool pool;
+    for (uint32_t compilation = 0; compilation < 3; compilation++) {
+        Graph graph(&pool);
+        for (uint32_t i = 0; i < 1000; i++) {
+            graph.CreateConstantInst(i);
+        }
+        ASSERT_EQ(graph.GetAllocator()->GetNumAllocations(), 1000);
+        ASSERT_GT(graph.GetAllocator()->GetNumChunks(), 1);
+        ASSERT_EQ(pool.GetNumFreeChunks(), 0);
+    }
+    ASSERT_GT(pool.GetNumFreeChunks(), 1);
+}
+
+TEST(GraphTest, HashConsing) {
+    Graph graph;
+    auto param = graph.CreateParameterInst();
+    auto cnst = graph.CreateConstantInst(1);
+    // Disabled by default
+    ASSERT_NE(graph.CreateConstantInst(1), cnst);
+
+    graph.SetHashConsing(true);
+    ASSERT_EQ(graph.CreateConstantInst(1), cnst);
+    ASSERT_NE(graph.CreateConstantInst(2), cnst);
+    auto add = graph.CreateAddInst(Type::INT64, param, cnst);
+    ASSERT_EQ(graph.CreateAddInst(Type::INT64, param, cnst), add);
+    // Commutative
+    ASSERT_EQ(graph.CreateAddInst(Type::INT64, cnst, param), add);
+    ASSERT_NE(graph.CreateAddInst(Type::INT32, param, cnst), add);
+    auto sub = graph.CreateSubInst(Type::INT64, param, cnst);
+    ASSERT_NE(graph.CreateSubInst(Type::INT64, cnst, param), sub);
+    // Inputs are set after creation
+    ASSERT_NE(graph.CreateAddInst(), add);
+    auto num_insts = graph.GetNumInsts();
+    ASSERT_EQ(num_insts, 9U);
+    // Immediate of typed constant is normalized, so equal values are merged
+    auto max_uint32 = graph.CreateConstantInst(Type::UINT32, 0xffffffff);
+    ASSERT_EQ(max_uint32->GetImm(), -1);
+    ASSERT_EQ(graph.CreateConstantInst(Type::UINT32, -1), max_uint32);
+
+    graph.DeleteInst(sub);
+    ASSERT_NE(graph.CreateSubInst(Type::INT64, param, cnst), sub);
+    graph.SetInstsPlaced();
+    ASSERT_NE(graph.CreateConstantInst(1), cnst);
+}
+
+// Table grows and keeps all instructions
+TEST(GraphTest, HashConsingManyConstants) {
+    Graph graph;
+    std::vector<Inst *> constants;
+    for (uint32_t i = 0; i < 1000; i++) {
+        constants.push_back(graph.CreateConstantInst(i));
+    }
+    graph.SetHashConsing(true);
+    for (uint32_t i = 0; i < 1000; i++) {
+        ASSERT_EQ(graph.CreateConstantInst(i), constants[i]);
+    }
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        graph.DeleteInst(constants[i]);
+    }
+    for (uint32_t i = 0; i < 1000; i++) {
+        ASSERT_EQ(graph.CreateConstantInst(i) == constants[i], i % 2 == 1);
+    }
+    // Entries are moved, when table grows, erase finds them by id
+    for (uint32_t i = 1; i < 1000; i += 2) {
+        graph.DeleteInst(constants[i]);
+        ASSERT_NE(graph.CreateConstantInst(i), constants[i]);
+    }
+    ASSERT_EQ(graph.GetNumInsts(), 2000U);
+}
+
+// Div may be guarded by check of divisor in its branch, so equal one isn't returned
+TEST(GraphTest, HashConsingKeepsDiv) {
+    Graph graph;
+    graph.SetHashConsing(true);
+    auto dividend = graph.CreateParameterInst();
+    auto divisor = graph.CreateParameterInst();
+    auto div = graph.CreateDivInst(Type::INT64, dividend, divisor);
+    ASSERT_NE(graph.CreateDivInst(Type::INT64, dividend, divisor), div);
+    ASSERT_EQ(graph.CreateSubInst(Type::INT64, dividend, divisor), graph.CreateSubInst(Type::INT64, dividend, divisor));
+}
+
 }
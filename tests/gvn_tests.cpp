@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "graph.h"
+
+#include "ir_constructor.h"
+#include "optimizations/gvn.h"
+#include "optimizations/gcm.h"
+
+namespace compiler {
+
+// Add is computed in both branches, the only one is left and GCM places it before If
+TEST(GvnTest, EqualInstsInBranches) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Compare>(4).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(5).CtrlInput(0).DataInputs(4).Branches(6, 9);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(7).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Jump>(8).CtrlInput(6).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(9);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Mul>(11).DataInputs(10, 10);
+    ic.CreateInst<Opcode::Jump>(17).CtrlInput(9).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Phi>(13).CtrlInput(12).DataInputs(7, 11);
+    ic.CreateInst<Opcode::Return>(14).CtrlInput(13).DataInputs(13);
+    ic.CreateInst<Opcode::Jump>(15).CtrlInput(14).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    auto pm = graph->GetPassManager();
+    GVN gvn(graph);
+    gvn.Run();
+    pm->InvalidateAnalyses(GVN::PRESERVED_ANALYSES);
+
+    auto add = graph->GetInstByIndex(7);
+    auto mul = graph->GetInstByIndex(11);
+    ASSERT_EQ(gvn.GetNumRemovedInsts(), 1U);
+    ASSERT_EQ(mul->GetDataInput(0), add);
+    ASSERT_EQ(mul->GetDataInput(1), add);
+    ASSERT_FALSE(graph->GetInstByIndex(10)->HasDataUsers());
+
+    pm->RunPass<GCM>();
+    ASSERT_TRUE(add->IsPlaced());
+    ASSERT_FALSE(graph->GetInstByIndex(10)->IsPlaced());
+    // Start dominates both users
+    auto start = graph->GetStartRegion();
+    auto found = false;
+    for (auto inst = start->GetFirst(); inst != nullptr; inst = inst->GetNext()) {
+        found |= inst == add;
+    }
+    ASSERT_TRUE(found);
+}
+
+// Inputs of commutative instruction are compared in any order, immediates must be equal
+TEST(GvnTest, CommutativeAndImmediates) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Constant>(4).Imm(5);
+    ic.CreateInst<Opcode::Constant>(5).Imm(5);
+    ic.CreateInst<Opcode::Constant>(6).Imm(6);
+    ic.CreateInst<Opcode::Jump>(7).CtrlInput(0).JmpTo(8);
+
+    ic.CreateInst<Opcode::Region>(8);
+    // Equal after constants 4 and 5 are merged
+    ic.CreateInst<Opcode::Add>(9).DataInputs(2, 4);
+    ic.CreateInst<Opcode::Add>(10).DataInputs(5, 2);
+    ic.CreateInst<Opcode::Add>(11).DataInputs(2, 6);
+    ic.CreateInst<Opcode::Sub>(12).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Sub>(13).DataInputs(3, 2);
+    ic.CreateInst<Opcode::Compare>(14).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::Compare>(15).DataInputs(2, 3).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::Call>(16).CtrlInput(8).DataInputs(9, 10, 11, 12, 13, 14, 15);
+    ic.CreateInst<Opcode::Return>(17).CtrlInput(16).DataInputs(16);
+    ic.CreateInst<Opcode::Jump>(18).CtrlInput(17).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    GVN gvn(graph);
+    gvn.Run();
+
+    auto call = graph->GetInstByIndex(16);
+    ASSERT_EQ(gvn.GetNumRemovedInsts(), 2U);
+    ASSERT_EQ(call->GetDataInput(0), graph->GetInstByIndex(9));
+    ASSERT_EQ(call->GetDataInput(1), graph->GetInstByIndex(9));
+    ASSERT_EQ(call->GetDataInput(2), graph->GetInstByIndex(11));
+    ASSERT_EQ(call->GetDataInput(3), graph->GetInstByIndex(12));
+    ASSERT_EQ(call->GetDataInput(4), graph->GetInstByIndex(13));
+    ASSERT_EQ(call->GetDataInput(5), graph->GetInstByIndex(14));
+    ASSERT_EQ(call->GetDataInput(6), graph->GetInstByIndex(15));
+    ASSERT_EQ(graph->GetInstByIndex(9)->GetDataInput(1), graph->GetInstByIndex(4));
+}
+
+// Each Div is guarded by check of divisor, merged Div would be placed above both checks
+TEST(GvnTest, GuardedDivsAreNotMerged) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Parameter>(3).Imm(1);
+    ic.CreateInst<Opcode::Parameter>(4).Imm(2);
+    ic.CreateInst<Opcode::Constant>(5).Imm(0);
+    ic.CreateInst<Opcode::Compare>(6).DataInputs(4, 5).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(7).CtrlInput(0).DataInputs(6).Branches(8, 18);
+
+    ic.CreateInst<Opcode::Region>(8);
+    ic.CreateInst<Opcode::Compare>(9).DataInputs(3, 5).CC(ConditionCode::NE);
+    ic.CreateInst<Opcode::If>(10).CtrlInput(8).DataInputs(9).Branches(11, 15);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Div>(12).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Return>(13).CtrlInput(11).DataInputs(12);
+    ic.CreateInst<Opcode::Jump>(14).CtrlInput(13).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(15);
+    ic.CreateInst<Opcode::Return>(16).CtrlInput(15).DataInputs(5);
+    ic.CreateInst<Opcode::Jump>(17).CtrlInput(16).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(18);
+    ic.CreateInst<Opcode::Compare>(19).DataInputs(3, 5).CC(ConditionCode::NE);
+    ic.CreateInst<Opcode::If>(20).CtrlInput(18).DataInputs(19).Branches(21, 25);
+
+    ic.CreateInst<Opcode::Region>(21);
+    ic.CreateInst<Opcode::Div>(22).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Return>(23).CtrlInput(21).DataInputs(22);
+    ic.CreateInst<Opcode::Jump>(24).CtrlInput(23).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(25);
+    ic.CreateInst<Opcode::Return>(26).CtrlInput(25).DataInputs(5);
+    ic.CreateInst<Opcode::Jump>(27).CtrlInput(26).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    auto pm = graph->GetPassManager();
+    GVN gvn(graph);
+    gvn.Run();
+    pm->InvalidateAnalyses(GVN::PRESERVED_ANALYSES);
+
+    // Only checks of divisor are merged
+    ASSERT_EQ(gvn.GetNumRemovedInsts(), 1U);
+    ASSERT_FALSE(graph->GetInstByIndex(19)->HasDataUsers());
+    ASSERT_EQ(graph->GetInstByIndex(23)->GetDataInput(0), graph->GetInstByIndex(22));
+
+    pm->RunPass<GCM>();
+    for (auto [div, region] : {std::pair {12, 11}, std::pair {22, 21}}) {
+        auto found = false;
+        for (auto inst = graph->GetInstByIndex(region)->CastToRegion()->GetFirst(); inst != nullptr;
+             inst = inst->GetNext()) {
+            found |= inst == graph->GetInstByIndex(div);
+        }
+        ASSERT_TRUE(found);
+    }
+}
+
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include "graph.h"
+#include "ir_constructor.h"
+#include "graph_comparator.h"
+#include "pass_manager.h"
+#include "optimizations/checks_elimination.h"
+#include "optimizations/peepholes.h"
+#include "optimizations/gcm.h"
+#include "optimizations/analysis/rpo.h"
+#include "optimizations/analysis/domtree.h"
+#include "optimizations/analysis/loop_analysis.h"
+#include "optimizations/analysis/linear_order.h"
+#include "optimizations/analysis/liveness_analyzer.h"
+#include "optimizations/reg_alloc.h"
+
+namespace compiler {
+
+Graph *CreateGraphWithChecks(IrConstructor &ic) {
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Jump>(3).CtrlInput(0).JmpTo(4);
+
+    ic.CreateInst<Opcode::Region>(4);
+    ic.CreateInst<Opcode::NullCheck>(5).DataInputs(2).CtrlInput(4);
+    ic.CreateInst<Opcode::Compare>(6).DataInputs(5, 5).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::Jump>(10).CtrlInput(5).JmpTo(11);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::NullCheck>(7).DataInputs(2).CtrlInput(11);
+    ic.CreateInst<Opcode::Return>(8).DataInputs(7).CtrlInput(7);
+    ic.CreateInst<Opcode::Jump>(9).CtrlInput(8).JmpTo(1);
+    ic.CreateInst<Opcode::End>(1);
+    return ic.GetFinalGraph();
+}
+
+uint32_t NumRuns(Graph *graph, AnalysisId id) {
+    return graph->GetPassManager()->GetNumAnalysisRuns(id);
+}
+
+TEST(PassManagerTest, CachedAnalyses) {
+    auto ic = IrConstructor();
+    auto graph = CreateGraphWithChecks(ic);
+    auto pm = graph->GetPassManager();
+
+    // Liveness requests whole chain of analyses, each of them is run once
+    pm->RunPass<GCM>();
+    pm->GetAnalysis<LivenessAnalyzer>();
+    pm->GetAnalysis<LinearOrder>();
+    pm->GetAnalysis<DomTree>();
+    ASSERT_EQ(NumRuns(graph, AnalysisId::RPO_REGIONS), 1);
+    ASSERT_EQ(NumRuns(graph, AnalysisId::DOM_TREE), 1);
+    ASSERT_EQ(NumRuns(graph, AnalysisId::LOOPS), 1);
+    ASSERT_EQ(NumRuns(graph, AnalysisId::LINEAR_ORDER), 1);
+    ASSERT_EQ(NumRuns(graph, AnalysisId::LIVENESS), 1);
+    ASSERT_TRUE(pm->IsAnalysisValid<LivenessAnalyzer>());
+}
+
+TEST(PassManagerTest, InvalidationByPasses) {
+    auto ic = IrConstructor();
+    auto graph = CreateGraphWithChecks(ic);
+    auto pm = graph->GetPassManager();
+
+    pm->GetAnalysis<LoopAnalysis>();
+    pm->GetAnalysis<RpoInsts>();
+    pm->RunPass<ChecksElimination>();
+    // Dom tree is reused by checks elimination, RPO of instructions is changed by it
+    ASSERT_EQ(NumRuns(graph, AnalysisId::DOM_TREE), 1);
+    ASSERT_TRUE(pm->IsAnalysisValid<LoopAnalysis>());
+    ASSERT_FALSE(pm->IsAnalysisValid<RpoInsts>());
+
+    // Dependent analysis isn't valid without its dependencies
+    pm->InvalidateAnalyses(ANALYSIS_BIT(LOOPS));
+    ASSERT_FALSE(pm->IsAnalysisValid<RpoRegions>());
+    ASSERT_FALSE(pm->IsAnalysisValid<LoopAnalysis>());
+
+    // Loops can be found again
+    pm->GetAnalysis<LoopAnalysis>();
+    ASSERT_EQ(NumRuns(graph, AnalysisId::LOOPS), 2);
+    ASSERT_EQ(graph->GetNumLoops(), 0);
+    ASSERT_EQ(graph->GetRootLoop()->GetBody().size(), 4);
+}
+
+TEST(PassManagerTest, Pipeline) {
+    auto ic = IrConstructor();
+    auto graph = CreateGraphWithChecks(ic);
+    auto pm = graph->GetPassManager();
+
+    ASSERT_FALSE(pm->RunPipeline("checks_elimination,unknown_pass"));
+    // Nothing was run
+    ASSERT_EQ(NumRuns(graph, AnalysisId::DOM_TREE), 0);
+
+    ASSERT_TRUE(pm->RunPipeline("checks_elimination,peepholes,gcm"));
+    ASSERT_TRUE(graph->IsInstsPlaced());
+    ASSERT_EQ(graph->GetInstByIndex(8)->GetDataInput(0), graph->GetInstByIndex(5));
+    ASSERT_EQ(NumRuns(graph, AnalysisId::RPO_REGIONS), 1);
+    ASSERT_EQ(NumRuns(graph, AnalysisId::RPO_INSTS), 2);
+}
+
+TEST(PassManagerTest, RegAllocInPipeline) {
+    auto ic = IrConstructor();
+    auto graph = CreateGraphWithChecks(ic);
+    auto pm = graph->GetPassManager();
+    ASSERT_EQ(pm->GetRegAllocKind(), RegAllocKind::LINEAR_SCAN);
+
+    ASSERT_FALSE(pm->RunPipeline("gcm,regalloc=unknown"));
+    ASSERT_FALSE(pm->RunPipeline("gcm,unknown=graph_coloring"));
+    ASSERT_FALSE(graph->IsInstsPlaced());
+
+    ASSERT_TRUE(pm->RunPipeline("checks_elimination,regalloc=graph_coloring,gcm"));
+    ASSERT_EQ(pm->GetRegAllocKind(), RegAllocKind::GRAPH_COLORING);
+    ASSERT_STREQ(GetRegAllocName(pm->GetRegAllocKind()), "graph_coloring");
+
+    RegAlloc regalloc(graph, Target::X86_64SysV());
+    regalloc.Run();
+    ASSERT_EQ(regalloc.GetKind(), RegAllocKind::GRAPH_COLORING);
+    ASSERT_EQ(regalloc.GetNumSpills(), 0U);
+    // Parameter is in its register
+    auto &regs_map = regalloc.GetRegsMap();
+    auto param = std::find_if(regs_map.begin(), regs_map.end(), [graph](const RegMap &map) {
+        return map.interval.GetLinearNumber() == graph->GetInstByIndex(2)->GetLinearNumber();
+    });
+    ASSERT_NE(param, regs_map.end());
+    ASSERT_STREQ(param->location.name, "rdi");
+}
+
+}
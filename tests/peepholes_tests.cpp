@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <array>
+#include <limits>
 #include <ostream>
 #include "graph.h"
 
@@ -13,6 +15,7 @@
 #include "optimizations/analysis/liveness_analyzer.h"
 #include "optimizations/linear_scan.h"
 #include "optimizations/peepholes.h"
+#include "optimizations/constant_folding.h"
 
 namespace compiler {
 
@@ -134,7 +137,31 @@ TEST(PeepholesTest, SubSub) {
     GraphComparator(true_graph, graph).Compare();
 }
 
+// The new constant isn't created, if it is already in graph
+TEST(PeepholesTest, SubSubHashConsing) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::End>(1);
+    ic.CreateInst<Opcode::Parameter>(2);
+    ic.CreateInst<Opcode::Constant>(3).Imm(10);
+    ic.CreateInst<Opcode::Constant>(4).Imm(15);
+    ic.CreateInst<Opcode::Constant>(9).Imm(25);
+    ic.CreateInst<Opcode::Sub>(5).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Sub>(6).DataInputs(5, 4);
+    ic.CreateInst<Opcode::Call>(10).CtrlInput(0).DataInputs(6, 9);
+    ic.CreateInst<Opcode::Return>(7).CtrlInput(10).DataInputs(10);
+    ic.CreateInst<Opcode::Jump>(8).CtrlInput(7).JmpTo(1);
+
+    auto graph = ic.GetFinalGraph();
+    graph->SetHashConsing(true);
+    auto num_insts = graph->GetNumInsts();
+    auto ph = Peepholes(graph);
+    ph.Run();
 
+    ASSERT_EQ(graph->GetNumInsts(), num_insts);
+    ASSERT_EQ(graph->GetInstByIndex(6)->GetDataInput(1), graph->GetInstByIndex(9));
+    ASSERT_EQ(graph->GetInstByIndex(6)->GetDataInput(0), graph->GetInstByIndex(2));
+}
 
 TEST(ConstFoldingTest, Sub) {
     // Before
@@ -253,6 +280,89 @@ TEST(ConstFoldingTest, Or) {
     GraphComparator(true_graph, graph).Compare();
 }
 
+// Values are wrapped and extended by type of instruction
+TEST(ConstFoldingTest, TypedEvaluation) {
+    ImmType result = 0;
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Add, Type::INT32, 0x7fffffff, 1, &result));
+    ASSERT_EQ(result, -0x80000000LL);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Add, Type::UINT32, 0xffffffff, 2, &result));
+    ASSERT_EQ(result, 1);
+    // UINT32 is extended by sign too, so equal values have one form
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Sub, Type::UINT32, 0, 1, &result));
+    ASSERT_EQ(result, -1);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Shl, Type::UINT32, 1, 31, &result));
+    ASSERT_EQ(result, -0x80000000LL);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Mul, Type::INT64, std::numeric_limits<ImmType>::max(), 2, &result));
+    ASSERT_EQ(result, -2);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Div, Type::INT32, -7, 2, &result));
+    ASSERT_EQ(result, -3);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Div, Type::UINT32, -8, 2, &result));
+    ASSERT_EQ(result, 0x7ffffffc);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Div, Type::INT64, std::numeric_limits<ImmType>::min(), -1, &result));
+    ASSERT_EQ(result, std::numeric_limits<ImmType>::min());
+    ASSERT_FALSE(EvaluateBinaryOp(Opcode::Div, Type::INT64, 1, 0, &result));
+    // Shift is masked by width of type
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Shl, Type::INT32, 1, 33, &result));
+    ASSERT_EQ(result, 2);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Shl, Type::INT64, 1, 33, &result));
+    ASSERT_EQ(result, 0x200000000);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Shr, Type::INT32, -8, 1, &result));
+    ASSERT_EQ(result, -4);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::Shr, Type::UINT32, -8, 1, &result));
+    ASSERT_EQ(result, 0x7ffffffc);
+    ASSERT_TRUE(EvaluateBinaryOp(Opcode::And, Type::BOOL, 1, 0, &result));
+    ASSERT_EQ(result, 0);
+    ASSERT_FALSE(EvaluateBinaryOp(Opcode::Add, Type::BOOL, 1, 1, &result));
+    ASSERT_FALSE(EvaluateBinaryOp(Opcode::Add, Type::REFERENCE, 1, 1, &result));
+
+    ASSERT_TRUE(EvaluateCompare(ConditionCode::LT, Type::INT64, -1, 1, &result));
+    ASSERT_EQ(result, 1);
+    ASSERT_TRUE(EvaluateCompare(ConditionCode::LT, Type::UINT64, -1, 1, &result));
+    ASSERT_EQ(result, 0);
+    // Values are truncated to 32 bits
+    ASSERT_TRUE(EvaluateCompare(ConditionCode::EQ, Type::INT32, 0x100000001, 1, &result));
+    ASSERT_EQ(result, 1);
+}
+
+// All arithmetic is folded, Compare of constants becomes BOOL constant
+TEST(ConstFoldingTest, FoldChain) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Constant>(7).Imm(6);
+    ic.CreateInst<Opcode::Constant>(8).Imm(4);
+
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Jump>(2).CtrlInput(0).JmpTo(3);
+
+    ic.CreateInst<Opcode::Region>(3);
+    ic.CreateInst<Opcode::Add>(9).DataInputs(7, 8);
+    ic.CreateInst<Opcode::Mul>(10).DataInputs(9, 8);
+    ic.CreateInst<Opcode::Div>(11).DataInputs(10, 7);
+    ic.CreateInst<Opcode::And>(12).DataInputs(11, 7);
+    ic.CreateInst<Opcode::Shr>(13).DataInputs(12, 8);
+    ic.CreateInst<Opcode::Compare>(14).DataInputs(11, 7).CC(ConditionCode::GE);
+    ic.CreateInst<Opcode::Call>(15).CtrlInput(3).DataInputs(11, 12, 13, 14);
+    ic.CreateInst<Opcode::Return>(5).CtrlInput(15).DataInputs(15);
+    ic.CreateInst<Opcode::Jump>(6).CtrlInput(5).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+    auto graph = ic.GetFinalGraph();
+    for (id_t i = 9; i <= 13; i++) {
+        graph->GetInstByIndex(i)->SetType(Type::INT32);
+    }
+    auto ph = Peepholes(graph);
+    ph.Run();
+
+    auto call = graph->GetInstByIndex(15);
+    std::array<ImmType, 4> expected {6, 6, 0, 1};
+    for (id_t i = 0; i < expected.size(); i++) {
+        auto input = call->GetDataInput(i);
+        ASSERT_TRUE(input->IsConst());
+        ASSERT_EQ(input->CastToConstant()->GetImm(), expected[i]);
+    }
+    ASSERT_EQ(call->GetDataInput(0)->GetType(), Type::INT32);
+    ASSERT_EQ(call->GetDataInput(3)->GetType(), Type::BOOL);
+}
+
 TEST(PeepholesTest, OrZero) {
     // Before
     auto ic = IrConstructor();
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "graph.h"
+
+#include "ir_constructor.h"
+#include "optimizations/sccp.h"
+#include "optimizations/gcm.h"
+
+namespace compiler {
+
+// Compare of constants is folded, false branch is removed with its instructions
+TEST(SccpTest, FoldConstantIf) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Constant>(3).Imm(1);
+    ic.CreateInst<Opcode::Constant>(4).Imm(2);
+    ic.CreateInst<Opcode::Compare>(5).DataInputs(3, 4).CC(ConditionCode::LT);
+    ic.CreateInst<Opcode::If>(16).CtrlInput(0).DataInputs(5).Branches(6, 9);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(7).DataInputs(2, 3);
+    ic.CreateInst<Opcode::Jump>(8).CtrlInput(6).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(9);
+    ic.CreateInst<Opcode::Mul>(10).DataInputs(2, 2);
+    ic.CreateInst<Opcode::Jump>(11).CtrlInput(9).JmpTo(12);
+
+    ic.CreateInst<Opcode::Region>(12);
+    ic.CreateInst<Opcode::Phi>(13).CtrlInput(12).DataInputs(7, 10);
+    ic.CreateInst<Opcode::Return>(14).CtrlInput(13).DataInputs(13);
+    ic.CreateInst<Opcode::Jump>(15).CtrlInput(14).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    auto pm = graph->GetPassManager();
+    SCCP sccp(graph);
+    sccp.Run();
+    pm->InvalidateAnalyses(SCCP::PRESERVED_ANALYSES);
+
+    ASSERT_EQ(sccp.GetNumFoldedBranches(), 1U);
+    ASSERT_EQ(sccp.GetNumRemovedRegions(), 1U);
+    ASSERT_EQ(graph->GetInstByIndex(16), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(5), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(9), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(10), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(11), nullptr);
+    // Phi with one input is removed
+    ASSERT_EQ(graph->GetInstByIndex(13), nullptr);
+    auto region = graph->GetInstByIndex(12)->CastToRegion();
+    ASSERT_EQ(region->NumRegionInputs(), 1U);
+    ASSERT_EQ(region->GetControlUser(), graph->GetInstByIndex(14));
+    ASSERT_EQ(graph->GetInstByIndex(14)->GetDataInput(0), graph->GetInstByIndex(7));
+    auto jump = graph->GetStartRegion()->GetControlUser();
+    ASSERT_EQ(jump->GetOpcode(), Opcode::Jump);
+    ASSERT_EQ(jump->GetControlUser(), graph->GetInstByIndex(6));
+
+    pm->RunPass<GCM>();
+    ASSERT_TRUE(graph->GetInstByIndex(7)->IsPlaced());
+    // Removed region isn't dumped
+    std::stringstream dump;
+    graph->DumpPlacedInsts(dump);
+    ASSERT_EQ(dump.str().find("9.    Region"), std::string::npos);
+    ASSERT_NE(dump.str().find("6.    Region"), std::string::npos);
+}
+
+// Value doesn't change in loop, so Phi of header is constant
+TEST(SccpTest, ConstantPhiInLoop) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Constant>(3).Imm(5);
+    ic.CreateInst<Opcode::Constant>(4).Imm(0);
+    ic.CreateInst<Opcode::Jump>(5).CtrlInput(0).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(6);
+    ic.CreateInst<Opcode::Add>(10);
+    ic.CreateInst<Opcode::Phi>(7).CtrlInput(6).DataInputs(3, 10);
+    ic.GetInst(10);
+    ic.DataInputs(7, 4);
+    ic.CreateInst<Opcode::Compare>(8).DataInputs(2, 4).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(9).CtrlInput(7).DataInputs(8).Branches(11, 14);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Jump>(12).CtrlInput(11).JmpTo(6);
+
+    ic.CreateInst<Opcode::Region>(14);
+    ic.CreateInst<Opcode::Return>(15).CtrlInput(14).DataInputs(7);
+    ic.CreateInst<Opcode::Jump>(16).CtrlInput(15).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    SCCP sccp(graph);
+    sccp.Run();
+
+    ASSERT_EQ(sccp.GetNumFoldedBranches(), 0U);
+    ASSERT_EQ(sccp.GetNumRemovedRegions(), 0U);
+    ASSERT_EQ(graph->GetInstByIndex(7), nullptr);
+    auto value = graph->GetInstByIndex(15)->GetDataInput(0);
+    ASSERT_TRUE(value->IsConst());
+    ASSERT_EQ(value->CastToConstant()->GetImm(), 5);
+    // Add was used only by Phi
+    ASSERT_EQ(graph->GetInstByIndex(10), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(6)->GetControlUser(), graph->GetInstByIndex(9));
+    ASSERT_EQ(graph->GetInstByIndex(6)->CastToRegion()->NumRegionInputs(), 2U);
+}
+
+// Both branches give the same constant, so the next If is folded by value of Phi
+TEST(SccpTest, ConditionalConstantThroughPhi) {
+    auto ic = IrConstructor();
+    ic.CreateInst<Opcode::Start>(0);
+    ic.CreateInst<Opcode::Parameter>(2).Imm(0);
+    ic.CreateInst<Opcode::Constant>(3).Imm(0);
+    ic.CreateInst<Opcode::Constant>(4).Imm(1);
+    ic.CreateInst<Opcode::Compare>(5).DataInputs(2, 3).CC(ConditionCode::EQ);
+    ic.CreateInst<Opcode::If>(6).CtrlInput(0).DataInputs(5).Branches(7, 9);
+
+    ic.CreateInst<Opcode::Region>(7);
+    ic.CreateInst<Opcode::Jump>(8).CtrlInput(7).JmpTo(11);
+
+    ic.CreateInst<Opcode::Region>(9);
+    ic.CreateInst<Opcode::Jump>(10).CtrlInput(9).JmpTo(11);
+
+    ic.CreateInst<Opcode::Region>(11);
+    ic.CreateInst<Opcode::Phi>(12).CtrlInput(11).DataInputs(4, 4);
+    ic.CreateInst<Opcode::Compare>(13).DataInputs(12, 3).CC(ConditionCode::NE);
+    ic.CreateInst<Opcode::If>(14).CtrlInput(12).DataInputs(13).Branches(15, 18);
+
+    ic.CreateInst<Opcode::Region>(15);
+    ic.CreateInst<Opcode::Return>(16).CtrlInput(15).DataInputs(12);
+    ic.CreateInst<Opcode::Jump>(17).CtrlInput(16).JmpTo(1);
+
+    ic.CreateInst<Opcode::Region>(18);
+    ic.CreateInst<Opcode::Return>(19).CtrlInput(18).DataInputs(2);
+    ic.CreateInst<Opcode::Jump>(20).CtrlInput(19).JmpTo(1);
+
+    ic.CreateInst<Opcode::End>(1);
+
+    auto graph = ic.GetFinalGraph();
+    SCCP sccp(graph);
+    sccp.Run();
+
+    ASSERT_EQ(sccp.GetNumFoldedBranches(), 1U);
+    ASSERT_EQ(sccp.GetNumRemovedRegions(), 1U);
+    ASSERT_NE(graph->GetInstByIndex(6), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(14), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(19), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(12), nullptr);
+    ASSERT_EQ(graph->GetInstByIndex(1)->CastToRegion()->NumRegionInputs(), 1U);
+    auto value = graph->GetInstByIndex(16)->GetDataInput(0);
+    ASSERT_TRUE(value->IsConst());
+    ASSERT_EQ(value->CastToConstant()->GetImm(), 1);
+}
+
+}